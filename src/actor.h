@@ -503,8 +503,6 @@ struct FBlockNode
 
 	static FBlockNode *Create (AActor *who, int x, int y);
 	void Release ();
-
-	static FBlockNode *FreeBlocks;
 };
 
 class FDecalBase;
@@ -951,6 +949,11 @@ public:
 	// a linked list of sectors where this object appears
 	struct msecnode_t	*touching_sectorlist;				// phares 3/14/98
 
+	// Area around the actor where P_CreateSecNodeList found no lines of any
+	// other sector than SecNodeSector. NULL if the last rebuild didn't.
+	fixed_t			SecNodeBox[4];
+	sector_t		*SecNodeSector;
+
 	TObjPtr<AInventory>	Inventory;		// [RH] This actor's inventory
 	DWORD			InventoryID;	// A unique ID to keep track of inventory items
 
@@ -34,7 +34,12 @@
 ** It was, but the results were not as good as I would like, so I didn't
 ** actually use it. But I did keep the code around in case I ever felt like
 ** revisiting the problem. I never did, so now it's relegated to the mists
-** of SVN history, and this is just a thin wrapper around BestColor().
+** of SVN history.
+**
+** This one divides the RGB cube into a grid and keeps, for every cell, the
+** list of palette entries that could possibly be the closest match to any
+** color inside it. Pick() only has to search that short list, and since the
+** lists are kept in palette order, it returns exactly what BestColor() would.
 **
 */
 
@@ -42,16 +47,25 @@
 #include <string.h>
 
 #include "doomtype.h"
+#include "templates.h"
 #include "colormatcher.h"
 #include "v_palette.h"
+#include "x86.h"
+#include "c_dispatch.h"
+#include "stats.h"
+#include "v_video.h"
+#include "r_data/colormaps.h"
 
 FColorMatcher::FColorMatcher ()
 {
 	Pal = NULL;
+	Exhaustive = false;
+	GridValid = false;
 }
 
 FColorMatcher::FColorMatcher (const DWORD *palette)
 {
+	Exhaustive = false;
 	SetPalette (palette);
 }
 
@@ -63,18 +77,222 @@ FColorMatcher::FColorMatcher (const FColorMatcher &other)
 FColorMatcher &FColorMatcher::operator= (const FColorMatcher &other)
 {
 	Pal = other.Pal;
+	Exhaustive = other.Exhaustive;
+	GridValid = other.GridValid;
+	LastTieWins = other.LastTieWins;
+	CellStart = other.CellStart;
+	Candidates = other.Candidates;
 	return *this;
 }
 
 void FColorMatcher::SetPalette (const DWORD *palette)
 {
 	Pal = (const PalEntry *)palette;
+	GridValid = false;
 }
 
+//==========================================================================
+//
+// FColorMatcher :: BuildGrid
+//
+// For each cell, find the smallest distance within which some palette
+// entry is guaranteed to lie from every point of the cell. Any entry that
+// comes closer than that to the cell somewhere is a candidate. Everything
+// else is always beaten by that entry and can be skipped.
+//
+//==========================================================================
+
+void FColorMatcher::BuildGrid ()
+{
+	// Use the same range and tie-breaking rule as BestColor(Pal, r, g, b).
+	// The MMX version considers entries 1-255 and prefers the last of equally
+	// close colors. The C version considers 1-254 and prefers the first.
+	int first = 1, last;
+
+#ifdef X86_ASM
+	if (CPU.bMMX)
+	{
+		last = 255;
+		LastTieWins = true;
+	}
+	else
+#endif
+	{
+		last = 254;
+		LastTieWins = false;
+	}
+
+	int mindist[256];
+
+	CellStart.Resize (NUM_CELLS + 1);
+	Candidates.Clear ();
+
+	for (int cell = 0; cell < NUM_CELLS; ++cell)
+	{
+		int lo[3], hi[3];
+		int bound = INT_MAX;
+
+		lo[0] = (cell / (GRID_SIZE * GRID_SIZE)) << CELL_SHIFT;
+		lo[1] = ((cell / GRID_SIZE) % GRID_SIZE) << CELL_SHIFT;
+		lo[2] = (cell % GRID_SIZE) << CELL_SHIFT;
+		for (int i = 0; i < 3; ++i)
+		{
+			hi[i] = lo[i] + (1 << CELL_SHIFT) - 1;
+		}
+
+		for (int color = first; color <= last; ++color)
+		{
+			int comp[3] = { Pal[color].r, Pal[color].g, Pal[color].b };
+			int nearest = 0, farthest = 0;
+
+			for (int i = 0; i < 3; ++i)
+			{
+				int v = comp[i];
+				int dnear = v < lo[i] ? lo[i] - v : v > hi[i] ? v - hi[i] : 0;
+				int dfar = MAX (v - lo[i], hi[i] - v);
+				nearest += dnear * dnear;
+				farthest += dfar * dfar;
+			}
+			mindist[color] = nearest;
+			if (farthest < bound)
+			{
+				bound = farthest;
+			}
+		}
+
+		CellStart[cell] = Candidates.Size();
+		for (int color = first; color <= last; ++color)
+		{
+			if (mindist[color] <= bound)
+			{
+				Candidates.Push ((BYTE)color);
+			}
+		}
+	}
+	CellStart[NUM_CELLS] = Candidates.Size();
+	Candidates.ShrinkToFit ();
+	GridValid = true;
+}
+
+//==========================================================================
+//
+// FColorMatcher :: Pick
+//
+//==========================================================================
+
 BYTE FColorMatcher::Pick (int r, int g, int b)
 {
 	if (Pal == NULL)
 		return 1;
 
-	return (BYTE)BestColor ((uint32 *)Pal, r, g, b);
+	// Components outside the grid go to the exhaustive search.
+	if (Exhaustive || (unsigned)(r | g | b) > 255)
+	{
+		return (BYTE)BestColor ((uint32 *)Pal, r, g, b);
+	}
+	if (!GridValid)
+	{
+		BuildGrid ();
+	}
+
+	int cell = (((r >> CELL_SHIFT) * GRID_SIZE) + (g >> CELL_SHIFT)) * GRID_SIZE + (b >> CELL_SHIFT);
+	const BYTE *cand = &Candidates[CellStart[cell]];
+	int count = CellStart[cell+1] - CellStart[cell];
+	int bestcolor = cand[0];
+	int bestdist = 257*257+257*257+257*257;
+
+	for (int i = 0; i < count; ++i)
+	{
+		int color = cand[i];
+		int x = r - Pal[color].r;
+		int y = g - Pal[color].g;
+		int z = b - Pal[color].b;
+		int dist = x*x + y*y + z*z;
+		if (dist < bestdist || (dist == bestdist && LastTieWins))
+		{
+			if (dist == 0)
+				return color;
+
+			bestdist = dist;
+			bestcolor = color;
+		}
+	}
+	return bestcolor;
+}
+
+//==========================================================================
+//
+// CCMD colormatchbench
+//
+// Times the exhaustive search against the grid for the RGB555 blending
+// table built at startup and for rebuilding every dynamic colormap, and
+// checks that both give the same results.
+//
+//==========================================================================
+
+CCMD (colormatchbench)
+{
+	static BYTE slow[32*32*32];
+	FColorMatcher matcher ((DWORD *)GPalette.BaseColors);
+	cycle_t buildtime, slowtime, fasttime;
+	int r, g, b, i, mismatches;
+
+	buildtime.Reset();
+	buildtime.Clock();
+	matcher.Pick (0, 0, 0);
+	buildtime.Unclock();
+
+	slowtime.Reset();
+	slowtime.Clock();
+	for (i = 0, r = 0; r < 32; r++)
+		for (g = 0; g < 32; g++)
+			for (b = 0; b < 32; b++)
+				slow[i++] = (BYTE)BestColor ((uint32 *)GPalette.BaseColors, (r<<3)|(r>>2), (g<<3)|(g>>2), (b<<3)|(b>>2));
+	slowtime.Unclock();
+
+	fasttime.Reset();
+	fasttime.Clock();
+	for (i = mismatches = 0, r = 0; r < 32; r++)
+		for (g = 0; g < 32; g++)
+			for (b = 0; b < 32; b++)
+				mismatches += slow[i++] != matcher.Pick ((r<<3)|(r>>2), (g<<3)|(g>>2), (b<<3)|(b>>2));
+	fasttime.Unclock();
+
+	Printf ("Grid built in %.3f ms\n", buildtime.TimeMS());
+	Printf ("RGB555 table: %.3f ms exhaustive, %.3f ms grid, %d mismatches\n",
+		slowtime.TimeMS(), fasttime.TimeMS(), mismatches);
+
+	if (NormalLight.Maps != NULL)
+	{
+		FDynamicColormap *cm;
+		int count = 0;
+
+		ColorMatcher.SetExhaustive (true);
+		slowtime.Reset();
+		slowtime.Clock();
+		for (cm = &NormalLight; cm != NULL; cm = cm->Next)
+		{
+			if (cm->Maps != NULL)
+			{
+				cm->BuildLights ();
+				count++;
+			}
+		}
+		slowtime.Unclock();
+		ColorMatcher.SetExhaustive (false);
+
+		fasttime.Reset();
+		fasttime.Clock();
+		for (cm = &NormalLight; cm != NULL; cm = cm->Next)
+		{
+			if (cm->Maps != NULL)
+			{
+				cm->BuildLights ();
+			}
+		}
+		fasttime.Unclock();
+
+		Printf ("%d colormaps: %.3f ms exhaustive, %.3f ms grid\n",
+			count, slowtime.TimeMS(), fasttime.TimeMS());
+	}
 }
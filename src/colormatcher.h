@@ -50,8 +50,25 @@ public:
 
 	FColorMatcher &operator= (const FColorMatcher &other);
 
+	// For benchmarking: bypass the grid and search the whole palette.
+	void SetExhaustive (bool on) { Exhaustive = on; }
+
 private:
+	enum
+	{
+		CELL_SHIFT = 4,
+		GRID_SIZE = 256 >> CELL_SHIFT,
+		NUM_CELLS = GRID_SIZE * GRID_SIZE * GRID_SIZE
+	};
+
+	void BuildGrid ();
+
 	const PalEntry *Pal;
+	bool Exhaustive;
+	bool GridValid;
+	bool LastTieWins;
+	TArray<DWORD> CellStart;	// NUM_CELLS+1 offsets into Candidates
+	TArray<BYTE> Candidates;	// Palette entries that can win inside each cell
 };
 
 extern FColorMatcher ColorMatcher;
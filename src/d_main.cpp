@@ -75,6 +75,7 @@
 #include "p_setup.h"
 #include "r_utility.h"
 #include "r_sky.h"
+#include "r_data/colormaps.h"
 #include "d_main.h"
 #include "d_dehacked.h"
 #include "cmdlib.h"
@@ -96,6 +97,7 @@
 #include "sbarinfo.h"
 #include "d_net.h"
 #include "g_level.h"
+#include "g_benchmark.h"
 #include "d_event.h"
 #include "d_netinf.h"
 #include "v_palette.h"
@@ -879,6 +881,14 @@ void D_Display ()
 		GSnd->DrawWaveDebug(snd_drawoutput);
 	}
 
+	// A status bar that only redraws what changed has to be redrawn in full
+	// after anything else may have been drawn over it.
+	if (wipe || menuactive != MENU_Off || ConsoleState != c_up || chatmodeon ||
+		paused || pauseext || snd_drawoutput)
+	{
+		ST_SetNeedRefresh();
+	}
+
 	if (!wipe || NoWipe < 0)
 	{
 		NetUpdate ();			// send out any new accumulation
@@ -921,6 +931,10 @@ void D_Display ()
 		GSnd->SetSfxPaused(false, 1);
 	}
 
+	// Only now are camera textures and player sprites done with this
+	// frame's light tables.
+	R_TrimColormapCache ();
+
 	cycles.Unclock();
 	FrameCycles = cycles;
 }
@@ -2464,6 +2478,9 @@ void D_DoomMain (void)
 		// about to begin the game.
 		FBaseCVar::EnableNoSet ();
 
+		// Startup is over, so most of the lumps it needed have been located.
+		Wads.SaveDirectoryCaches ();
+
 		delete iwad_man;	// now we won't need this anymore
 
 		// [RH] Run any saved commands from the command line or autoexec.cfg now.
@@ -2519,6 +2536,13 @@ void D_DoomMain (void)
 				D_DoomLoop ();	// never returns
 			}
 
+			v = Args->CheckValue ("-benchmark");
+			if (v)
+			{
+				G_Benchmark (v);
+				D_DoomLoop ();	// never returns
+			}
+
 			if (gameaction != ga_loadgame && gameaction != ga_loadgamehidecon)
 			{
 				if (autostart || netgame)
@@ -135,6 +135,8 @@ extern DThinker *NextToThink;
 
 // PUBLIC DATA DEFINITIONS -------------------------------------------------
 
+cycle_t GCCycles;
+
 namespace GC
 {
 size_t AllocBytes;
@@ -442,6 +444,7 @@ void Step()
 {
 	size_t lim = (GCSTEPSIZE/100) * StepMul;
 	size_t olim;
+	GCCycles.Clock();
 	if (lim == 0)
 	{
 		lim = (~(size_t)0) / 2;		// no limit
@@ -470,6 +473,7 @@ void Step()
 		SetThreshold();
 	}
 	StepCount++;
+	GCCycles.Unclock();
 }
 
 //==========================================================================
@@ -482,6 +486,7 @@ void Step()
 
 void FullGC()
 {
+	GCCycles.Clock();
 	if (State <= GCS_Propagate)
 	{
 		// Reset sweep mark to sweep all elements (returning them to white)
@@ -501,6 +506,7 @@ void FullGC()
 		SingleStep();
 	}
 	SetThreshold();
+	GCCycles.Unclock();
 }
 
 //==========================================================================
@@ -41,7 +41,7 @@
 #include "farchive.h"
 
 
-static cycle_t ThinkCycles;
+cycle_t ThinkCycles;
 extern cycle_t BotSupportCycles;
 extern int BotWTG;
 
@@ -35,6 +35,11 @@
 
 #ifdef _WIN32
 #define USE_WINDOWS_DWORD
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <io.h>
+#else
+#include <sys/mman.h>
 #endif
 #include "LzmaDec.h"
 
@@ -544,3 +549,48 @@ char *MemoryReader::Gets(char *strbuf, int len)
 {
 	return GetsFromBuffer(bufptr, strbuf, len);
 }
+
+//==========================================================================
+//
+// MappedFileReader
+//
+// The mapping is copy-on-write, so code that changes a cached lump in
+// place does not change the file.
+//
+//==========================================================================
+
+MappedFileReader::MappedFileReader (const char *filename)
+: FileReader (filename), MapBase(NULL)
+{
+	if (Length <= 0)
+	{
+		return;
+	}
+#ifdef _WIN32
+	HANDLE mapping = CreateFileMapping ((HANDLE)_get_osfhandle (_fileno (File)), NULL, PAGE_WRITECOPY, 0, 0, NULL);
+	if (mapping != NULL)
+	{
+		MapBase = (const char *)MapViewOfFile (mapping, FILE_MAP_COPY, 0, 0, 0);
+		// The view keeps the mapping alive.
+		CloseHandle (mapping);
+	}
+#else
+	void *base = mmap (NULL, Length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno (File), 0);
+	if (base != MAP_FAILED)
+	{
+		MapBase = (const char *)base;
+	}
+#endif
+}
+
+MappedFileReader::~MappedFileReader ()
+{
+	if (MapBase != NULL)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile (MapBase);
+#else
+		munmap ((void *)MapBase, Length);
+#endif
+	}
+}
@@ -336,6 +336,22 @@ protected:
 	const char * bufptr;
 };
 
+// Maps the whole file into memory so that uncompressed lumps can be used
+// in place instead of being copied. Reading and seeking still go through
+// the FILE, so streaming from the file works as before. If the file cannot
+// be mapped, this behaves like a plain FileReader.
+class MappedFileReader : public FileReader
+{
+public:
+	MappedFileReader (const char *filename);
+	~MappedFileReader ();
+
+	virtual const char *GetBuffer() const { return MapBase; }
+
+private:
+	const char *MapBase;
+};
+
 
 
 #endif
@@ -2285,6 +2285,7 @@ void FParser::SF_SetLineBlocking(void)
 			{
 				lines[i].flags = (lines[i].flags & ~(ML_BLOCKING|ML_BLOCKEVERYTHING)) | blocking;
 			}
+			P_ClearSightMemo ();
 		}
 	}
 }
@@ -0,0 +1,397 @@
+/*
+** g_benchmark.cpp
+** Headless demo benchmarking with per-subsystem timing reports
+**
+** -benchmark <demo> plays a demo back like -timedemo -nodraw, but with
+** sound disabled, no window and no renderer, and samples the playsim's
+** cycle counters after every tic. When the demo ends, a JSON report with
+** per-tic histograms for each subsystem is written to the file given by
+** -benchreport (benchmark.json by default) and the engine quits.
+**
+** The benchmark console command does the same from a running game, but
+** returns to the console when the demo ends.
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 The GZ3Doom developers
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "doomtype.h"
+#include "doomstat.h"
+#include "stats.h"
+#include "m_argv.h"
+#include "i_system.h"
+#include "c_dispatch.h"
+#include "g_game.h"
+#include "g_level.h"
+#include "g_benchmark.h"
+#include "r_renderer.h"
+#include "v_text.h"
+#include "tarray.h"
+
+EXTERN_CVAR (Int, vid_renderer)
+
+extern cycle_t ThinkCycles, SightCycles, TryMoveCycles, ACSCycles, GCCycles;
+extern FString defdemoname;
+extern bool timingdemo;
+
+void G_DeferedPlayDemo (const char *name);
+
+bool benchmarking;
+
+// Histogram bucket i counts tics that took less than 2^i microseconds
+// (and at least 2^(i-1) for i > 0). The last bucket takes everything else.
+enum { NUM_BENCH_BUCKETS = 24 };
+
+struct FBenchSeries
+{
+	const char *Name;
+	cycle_t *Counter;
+	TArray<float> Samples;		// per-tic time in milliseconds
+	double Total;
+	double Max;
+	unsigned int Histogram[NUM_BENCH_BUCKETS];
+
+	void Reset()
+	{
+		Samples.Clear();
+		Total = Max = 0;
+		memset(Histogram, 0, sizeof(Histogram));
+	}
+
+	void Add(double ms)
+	{
+		double us = ms * 1000.;
+		int bucket = 0;
+		while (bucket < NUM_BENCH_BUCKETS - 1 && us >= double(1 << bucket))
+		{
+			bucket++;
+		}
+		Histogram[bucket]++;
+		Samples.Push(float(ms));
+		Total += ms;
+		if (ms > Max) Max = ms;
+	}
+};
+
+static cycle_t TicCycles;
+static cycle_t RunCycles;
+
+enum
+{
+	BENCH_Tic,
+	BENCH_Think,
+	BENCH_Sight,
+	BENCH_TryMove,
+	BENCH_ACS,
+	BENCH_GC,
+
+	NUM_BENCH_SERIES
+};
+
+static FBenchSeries BenchSeries[NUM_BENCH_SERIES] =
+{
+	{ "tic",		&TicCycles },
+	{ "thinkers",	&ThinkCycles },
+	{ "sight",		&SightCycles },
+	{ "trymove",	&TryMoveCycles },
+	{ "acs",		&ACSCycles },
+	{ "gc",			&GCCycles },
+};
+
+static int BenchTics;
+static FString BenchMap;
+static FString BenchReport;
+static bool BenchNoDrawers, BenchNoBlit;
+
+//==========================================================================
+//
+// FNullRenderer
+//
+// Used instead of a real renderer when running headless, so that neither
+// the software nor the GL renderer has to be set up. Nothing is ever
+// drawn while benchmarking. The level is still built with the nodes the
+// selected renderer would ask for, so the playsim does the same work.
+//
+//==========================================================================
+
+struct FNullRenderer : public FRenderer
+{
+	bool UsesColormap() const { return false; }
+	void PrecacheTexture(FTexture *tex, int cache) {}
+	void RenderView(player_t *player) {}
+	void WriteSavePic (player_t *player, FILE *file, int width, int height) {}
+	int GetMaxViewPitch(bool down) { return 90; }
+	void ClearBuffer(int color) {}
+	void Init() {}
+	void RenderTextureView (FCanvasTexture *tex, AActor *viewpoint, int fov) {}
+	sector_t *FakeFlat(sector_t *sec, sector_t *tempsec, int *floorlightlevel, int *ceilinglightlevel, bool back)
+	{
+		return sec;
+	}
+	bool RequireGLNodes() { return vid_renderer == 1; }
+};
+
+FRenderer *G_CreateNullRenderer ()
+{
+	return new FNullRenderer;
+}
+
+//==========================================================================
+//
+// G_Benchmark
+//
+// Sets up a timedemo run of the given demo that draws nothing. The report
+// goes to the given file, or to -benchreport if there is none.
+//
+//==========================================================================
+
+void G_Benchmark (const char *name, const char *report)
+{
+	if (report == NULL)
+	{
+		report = Args->CheckValue("-benchreport");
+	}
+	BenchReport = report != NULL ? report : "benchmark.json";
+	BenchNoDrawers = nodrawers;
+	BenchNoBlit = noblit;
+
+	nodrawers = true;
+	noblit = true;
+	timingdemo = true;
+	singletics = true;
+	benchmarking = true;
+
+	BenchTics = 0;
+	BenchMap = "";
+	RunCycles.Reset();
+	for (int i = 0; i < NUM_BENCH_SERIES; ++i)
+	{
+		BenchSeries[i].Reset();
+	}
+	G_DeferedPlayDemo (name);
+}
+
+CCMD (benchmark)
+{
+	if (netgame)
+	{
+		Printf("End your current netgame first!\n");
+		return;
+	}
+	if (demorecording)
+	{
+		Printf("End your current demo first!\n");
+		return;
+	}
+	if (argv.argc() > 1)
+	{
+		G_Benchmark (argv[1], argv.argc() > 2 ? argv[2] : NULL);
+		singledemo = true;
+	}
+	else
+	{
+		Printf ("Usage: benchmark <demo> [report file]\n");
+	}
+}
+
+//==========================================================================
+//
+// G_BenchmarkTicStart
+//
+// Called from P_Ticker before a tic is run. The thinker and sight counters
+// are reset by their owners every tic, the others are reset here.
+//
+//==========================================================================
+
+void G_BenchmarkTicStart ()
+{
+	if (BenchTics == 0)
+	{
+		RunCycles.Clock();
+		BenchMap = level.MapName;
+	}
+	TryMoveCycles.Reset();
+	ACSCycles.Reset();
+	GCCycles.Reset();
+	TicCycles.Reset();
+	TicCycles.Clock();
+}
+
+//==========================================================================
+//
+// G_BenchmarkTicEnd
+//
+//==========================================================================
+
+void G_BenchmarkTicEnd ()
+{
+	TicCycles.Unclock();
+	for (int i = 0; i < NUM_BENCH_SERIES; ++i)
+	{
+		BenchSeries[i].Add(BenchSeries[i].Counter->TimeMS());
+	}
+	BenchTics++;
+}
+
+//==========================================================================
+//
+// Report writing
+//
+//==========================================================================
+
+static int STACK_ARGS benchsortfunc (const void *a, const void *b)
+{
+	float fa = *(const float *)a, fb = *(const float *)b;
+	return fa < fb ? -1 : fa > fb ? 1 : 0;
+}
+
+static double Percentile (const TArray<float> &sorted, double pct)
+{
+	if (sorted.Size() == 0) return 0;
+	unsigned int index = unsigned((sorted.Size() - 1) * pct / 100. + 0.5);
+	return sorted[index];
+}
+
+static void WriteJSONString (FILE *f, const char *str)
+{
+	fputc('"', f);
+	for (; *str != 0; ++str)
+	{
+		if (*str == '"' || *str == '\\') fputc('\\', f);
+		if ((unsigned char)*str >= ' ') fputc(*str, f);
+	}
+	fputc('"', f);
+}
+
+static void WriteSeries (FILE *f, FBenchSeries &series, bool last)
+{
+	TArray<float> sorted(series.Samples);
+	if (sorted.Size() > 0)
+	{
+		qsort(&sorted[0], sorted.Size(), sizeof(float), benchsortfunc);
+	}
+
+	fprintf(f, "\t\t\"%s\": {\n", series.Name);
+	fprintf(f, "\t\t\t\"total_ms\": %.4f,\n", series.Total);
+	fprintf(f, "\t\t\t\"mean_ms\": %.4f,\n", sorted.Size() > 0 ? series.Total / sorted.Size() : 0.);
+	fprintf(f, "\t\t\t\"max_ms\": %.4f,\n", series.Max);
+	fprintf(f, "\t\t\t\"p50_ms\": %.4f,\n", Percentile(sorted, 50));
+	fprintf(f, "\t\t\t\"p95_ms\": %.4f,\n", Percentile(sorted, 95));
+	fprintf(f, "\t\t\t\"p99_ms\": %.4f,\n", Percentile(sorted, 99));
+	fprintf(f, "\t\t\t\"histogram\": [");
+	for (int i = 0; i < NUM_BENCH_BUCKETS; ++i)
+	{
+		fprintf(f, "%s%u", i > 0 ? ", " : "", series.Histogram[i]);
+	}
+	fprintf(f, "]\n\t\t}%s\n", last ? "" : ",");
+}
+
+static bool WriteReport (const char *filename, double realms)
+{
+	FILE *f = fopen(filename, "w");
+	if (f == NULL)
+	{
+		return false;
+	}
+	fprintf(f, "{\n\t\"version\": 1,\n\t\"demo\": ");
+	WriteJSONString(f, defdemoname);
+	fprintf(f, ",\n\t\"map\": ");
+	WriteJSONString(f, BenchMap);
+	fprintf(f, ",\n\t\"gametics\": %d,\n", BenchTics);
+	fprintf(f, "\t\"realtime_ms\": %.3f,\n", realms);
+	fprintf(f, "\t\"histogram_bounds_us\": [");
+	for (int i = 0; i < NUM_BENCH_BUCKETS - 1; ++i)
+	{
+		fprintf(f, "%s%d", i > 0 ? ", " : "", 1 << i);
+	}
+	fprintf(f, "],\n\t\"subsystems\": {\n");
+	for (int i = 0; i < NUM_BENCH_SERIES; ++i)
+	{
+		WriteSeries(f, BenchSeries[i], i == NUM_BENCH_SERIES - 1);
+	}
+	fprintf(f, "\t}\n}\n");
+	fclose(f);
+	return true;
+}
+
+//==========================================================================
+//
+// G_BenchmarkFinish
+//
+// Called from G_CheckDemoStatus after the benchmarked demo has been shut
+// down. Prints the results and writes the report. From the console, the
+// game then drops back to the console like after any other demo. With
+// -benchmark, it quits.
+//
+//==========================================================================
+
+void G_BenchmarkFinish ()
+{
+	bool headless = !!Args->CheckParm("-benchmark");
+
+	benchmarking = false;
+	nodrawers = BenchNoDrawers;
+	noblit = BenchNoBlit;
+
+	if (BenchTics > 0)
+	{
+		RunCycles.Unclock();
+	}
+	double realms = RunCycles.TimeMS();
+
+	Printf ("Benchmarked %d gametics in %.1f ms (%.1f tics/sec)\n", BenchTics, realms,
+		realms > 0 ? BenchTics * 1000. / realms : 0.);
+	for (int i = 0; i < NUM_BENCH_SERIES; ++i)
+	{
+		Printf ("  %-10s %10.2f ms total, %.4f ms max\n", BenchSeries[i].Name,
+			BenchSeries[i].Total, BenchSeries[i].Max);
+	}
+
+	if (!WriteReport(BenchReport, realms))
+	{
+		if (headless)
+		{
+			I_FatalError ("Could not write benchmark report %s", BenchReport.GetChars());
+		}
+		Printf (TEXTCOLOR_RED "Could not write benchmark report %s\n", BenchReport.GetChars());
+		return;
+	}
+	Printf ("Benchmark report written to %s\n", BenchReport.GetChars());
+
+	if (headless)
+	{
+		// Playback has already been torn down, so leave through the
+		// regular quit command.
+		C_DoCommand ("quit");
+	}
+}
@@ -264,8 +264,10 @@ DEFINE_ACTION_FUNCTION(AActor, A_FireShotgun)
 
 	angle_t pitch = P_BulletSlope (self);
 
+	P_BeginTraceBatch ();
 	for (i=0 ; i<7 ; i++)
 		P_GunShot (self, false, PClass::FindClass(NAME_BulletPuff), pitch);
+	P_EndTraceBatch ();
 }
 
 //
@@ -296,6 +298,7 @@ DEFINE_ACTION_FUNCTION(AActor, A_FireShotgun2)
 
 	angle_t pitch = P_BulletSlope (self);
 		
+	P_BeginTraceBatch ();
 	for (i=0 ; i<20 ; i++)
 	{
 		damage = 5*(pr_fireshotgun2()%3+1);
@@ -314,6 +317,7 @@ DEFINE_ACTION_FUNCTION(AActor, A_FireShotgun2)
 					  pitch + (pr_fireshotgun2.Random2() * 332063), damage,
 					  NAME_Hitscan, NAME_BulletPuff);
 	}
+	P_EndTraceBatch ();
 }
 
 DEFINE_ACTION_FUNCTION(AActor, A_OpenShotgun2)
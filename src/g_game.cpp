@@ -64,6 +64,7 @@
 #include "r_sky.h"
 #include "g_game.h"
 #include "g_level.h"
+#include "g_benchmark.h"
 #include "b_bot.h"			//Added by MC:
 #include "sbar.h"
 #include "m_swap.h"
@@ -2754,7 +2755,11 @@ bool G_CheckDemoStatus (void)
 		}
 		if (singledemo || timingdemo)
 		{
-			if (timingdemo)
+			if (benchmarking)
+			{
+				G_BenchmarkFinish ();
+			}
+			else if (timingdemo)
 			{
 				// Trying to get back to a stable state after timing a demo
 				// seems to cause problems. I don't feel like fixing that
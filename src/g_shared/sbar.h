@@ -361,6 +361,7 @@ public:
 	virtual void BlendView (float blend[4]);
 	virtual void NewGame ();
 	virtual void ScreenSizeChanged ();
+	virtual void Invalidate (int left, int top, int right, int bottom);
 	virtual void MultiplayerChanged ();
 	virtual void SetInteger (int pname, int param);
 	virtual void ShowPop (int popnum);
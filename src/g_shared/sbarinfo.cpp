@@ -57,6 +57,7 @@
 #include "p_acs.h"
 #include "gstrings.h"
 #include "version.h"
+#include "stats.h"
 
 #define ARTIFLASH_OFFSET (statusBar->invBarOffset+6)
 enum
@@ -953,6 +954,164 @@ inline void adjustRelCenter(bool relX, bool relY, const double &x, const double
 		outY = y;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//
+// Status bar elements
+//
+// Everything the status bar draws goes through an SBarElement. When
+// st_incremental is on, elements at status bar coordinates are recorded
+// instead of drawn and compared with the ones from the frame before. Only
+// the rectangles that changed are drawn again; the rest of the bar is left
+// as it is in the frame buffer.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+CVAR(Bool, st_incremental, false, CVAR_ARCHIVE)
+
+static int SBarElementsDrawn, SBarElementsReused;
+
+struct SBarRect
+{
+	int Left, Top, Right, Bottom;
+
+	bool Intersects(const SBarRect &other) const
+	{
+		return Left < other.Right && other.Left < Right && Top < other.Bottom && other.Top < Bottom;
+	}
+};
+
+struct SBarElement
+{
+	enum
+	{
+		SBE_Clear			= 1,	// Clear the clip rectangle to black
+		SBE_CenterBottom	= 2,
+		SBE_AlphaMap		= 4,
+		SBE_Volatile		= 8,	// Not part of the bar, drawn again every frame
+	};
+
+	FTexture *Texture;
+	FRemapTable *Translation;
+	double X, Y, W, H;
+	SBarRect Clip;
+	DWORD Overlay;
+	DWORD FillColor;
+	int Alpha;
+	int Flags;
+
+	SBarElement(FTexture *texture, double x, double y, double w, double h, int alpha)
+		: Texture(texture), Translation(NULL), X(x), Y(y), W(w), H(h),
+		  Overlay(0), FillColor(~0u), Alpha(alpha), Flags(0)
+	{
+		Clip.Left = Clip.Top = 0;
+		Clip.Right = Clip.Bottom = INT_MAX;
+	}
+
+	bool operator== (const SBarElement &other) const
+	{
+		return Texture == other.Texture && Translation == other.Translation &&
+			X == other.X && Y == other.Y && W == other.W && H == other.H &&
+			Clip.Left == other.Clip.Left && Clip.Top == other.Clip.Top &&
+			Clip.Right == other.Clip.Right && Clip.Bottom == other.Clip.Bottom &&
+			Overlay == other.Overlay && FillColor == other.FillColor &&
+			Alpha == other.Alpha && Flags == other.Flags &&
+			!Texture->bWarped && !Texture->bHasCanvas;
+	}
+
+	// Returns the screen area this element can touch.
+	SBarRect GetBounds() const
+	{
+		if (Flags & SBE_Clear)
+		{
+			return Clip;
+		}
+
+		double left, top;
+		if (Flags & SBE_CenterBottom)
+		{
+			left = X - W / 2;
+			top = Y - H;
+		}
+		else
+		{
+			left = X - Texture->GetScaledLeftOffsetDouble() * W / Texture->GetScaledWidthDouble();
+			top = Y - Texture->GetScaledTopOffsetDouble() * H / Texture->GetScaledHeightDouble();
+		}
+
+		SBarRect bounds;
+		bounds.Left = MAX(Clip.Left, int(floor(left)) - 1);
+		bounds.Top = MAX(Clip.Top, int(floor(top)) - 1);
+		bounds.Right = MIN(Clip.Right, int(ceil(left + W)) + 1);
+		bounds.Bottom = MIN(Clip.Bottom, int(ceil(top + H)) + 1);
+		return bounds;
+	}
+
+	// Draws the part of the element inside rect.
+	void Draw(const SBarRect &rect) const
+	{
+		int left = MAX(Clip.Left, rect.Left);
+		int top = MAX(Clip.Top, rect.Top);
+		int right = MIN(Clip.Right, rect.Right);
+		int bottom = MIN(Clip.Bottom, rect.Bottom);
+
+		if (Flags & SBE_Clear)
+		{
+			if (left < right && top < bottom)
+			{
+				screen->Clear(left, top, right, bottom, GPalette.BlackIndex, 0);
+			}
+			return;
+		}
+		screen->DrawTexture(Texture, X, Y,
+			DTA_DestWidthF, W,
+			DTA_DestHeightF, H,
+			DTA_ClipLeft, left,
+			DTA_ClipTop, top,
+			DTA_ClipRight, right,
+			DTA_ClipBottom, bottom,
+			DTA_Translation, Translation,
+			DTA_ColorOverlay, Overlay,
+			DTA_CenterBottomOffset, (Flags & SBE_CenterBottom) != 0,
+			DTA_Alpha, Alpha,
+			DTA_AlphaChannel, (Flags & SBE_AlphaMap) != 0,
+			DTA_FillColor, FillColor,
+			TAG_DONE);
+	}
+};
+
+// Adds a changed area to a list of rectangles that do not overlap, so that
+// nothing is drawn twice when several of them are redrawn.
+static void AddDirtyRect(TArray<SBarRect> &rects, SBarRect rect)
+{
+	if (rect.Left >= rect.Right || rect.Top >= rect.Bottom)
+		return;
+
+	for (unsigned int i = 0; i < rects.Size(); )
+	{
+		if (rects[i].Intersects(rect))
+		{
+			rect.Left = MIN(rect.Left, rects[i].Left);
+			rect.Top = MIN(rect.Top, rects[i].Top);
+			rect.Right = MAX(rect.Right, rects[i].Right);
+			rect.Bottom = MAX(rect.Bottom, rects[i].Bottom);
+			rects.Delete(i);
+			i = 0;
+		}
+		else
+		{
+			i++;
+		}
+	}
+	rects.Push(rect);
+}
+
+ADD_STAT(sbar)
+{
+	FString out;
+	out.Format("%d status bar elements drawn, %d reused", SBarElementsDrawn, SBarElementsReused);
+	return out;
+}
+
 class DSBarInfo : public DBaseStatusBar
 {
 	DECLARE_CLASS(DSBarInfo, DBaseStatusBar)
@@ -961,7 +1120,8 @@ public:
 	DSBarInfo (SBarInfo *script=NULL) : DBaseStatusBar(script->height, script->resW, script->resH),
 		ammo1(NULL), ammo2(NULL), ammocount1(0), ammocount2(0), armor(NULL),
 		pendingPopup(POP_None), currentPopup(POP_None), lastHud(-1),
-		scalingWasForced(false), lastInventoryBar(NULL), lastPopup(NULL)
+		scalingWasForced(false), lastInventoryBar(NULL), lastPopup(NULL),
+		recording(false), retained(false)
 	{
 		this->script = script;
 
@@ -993,6 +1153,19 @@ public:
 		Images.Uninit();
 	}
 
+	void Invalidate(int left, int top, int right, int bottom)
+	{
+		if (retained)
+		{
+			SBarRect rect = { left, top, right, bottom };
+			AddDirtyRect(pendingDirty, rect);
+		}
+		else
+		{
+			Super::Invalidate(left, top, right, bottom);
+		}
+	}
+
 	void ScreenSizeChanged()
 	{
 		Super::ScreenSizeChanged();
@@ -1002,6 +1175,14 @@ public:
 	void Draw (EHudState state)
 	{
 		DBaseStatusBar::Draw(state);
+
+		// The bar can only be left in place if it is drawn into the same
+		// buffer every frame.
+		SBarElementsDrawn = SBarElementsReused = 0;
+		recording = st_incremental && state == HUD_StatusBar &&
+			!screen->Accel2D && screen->GetPageCount() == 1;
+		elements.Clear();
+
 		if (script->cleanX <= 0)
 		{ // Calculate cleanX and cleanY
 			ScreenSizeChanged();
@@ -1102,6 +1283,131 @@ public:
 
 		// Reset hud_scale
 		hud_scale = oldhud_scale;
+
+		if (recording)
+		{
+			recording = false;
+			DrawElements(!retained || SB_state != 0);
+			if (SB_state != 0)
+			{
+				SB_state--;
+			}
+			retained = true;
+		}
+		else
+		{
+			retained = false;
+		}
+	}
+
+	// Draws an element now, or records it to be composited at the end of
+	// the frame. Elements that are not part of the status bar are recorded
+	// too, so that they stay in the same order with the bar's, but they are
+	// drawn again every frame.
+	void DrawElement(const SBarElement &element, bool barElement) const
+	{
+		if (recording)
+		{
+			SBarElement &recorded = elements[elements.Push(element)];
+			if (!barElement)
+			{
+				recorded.Flags |= SBarElement::SBE_Volatile;
+			}
+		}
+		else
+		{
+			static const SBarRect everything = { INT_MIN, INT_MIN, INT_MAX, INT_MAX };
+			element.Draw(everything);
+			SBarElementsDrawn++;
+		}
+	}
+
+	// Draws the recorded elements that differ from the last frame's, along
+	// with everything else in the areas they cover.
+	void DrawElements(bool full)
+	{
+		static const SBarRect everything = { INT_MIN, INT_MIN, INT_MAX, INT_MAX };
+		TArray<SBarRect> dirty;
+		unsigned int i, j;
+
+		if (!full)
+		{
+			// Start with whatever was drawn over the bar last frame.
+			for (i = 0; i < pendingDirty.Size(); ++i)
+			{
+				AddDirtyRect(dirty, pendingDirty[i]);
+			}
+			for (i = 0; i < MAX(elements.Size(), lastElements.Size()); ++i)
+			{
+				bool hasnew = i < elements.Size();
+				bool hasold = i < lastElements.Size();
+				if (hasnew && hasold && elements[i] == lastElements[i] &&
+					!(elements[i].Flags & SBarElement::SBE_Volatile))
+				{
+					continue;
+				}
+				if (hasnew) AddDirtyRect(dirty, elements[i].GetBounds());
+				if (hasold) AddDirtyRect(dirty, lastElements[i].GetBounds());
+			}
+
+			// Parts of the bar above ST_Y (such as Heretic's and Hexen's
+			// bar tops) are drawn over by the view every frame.
+			for (i = 0; i < elements.Size(); ++i)
+			{
+				SBarRect bounds = elements[i].GetBounds();
+				if (bounds.Top < ::ST_Y)
+				{
+					bounds.Bottom = MIN(bounds.Bottom, ::ST_Y);
+					AddDirtyRect(dirty, bounds);
+				}
+			}
+
+			// Whatever was under the changed parts of the bar has to be put
+			// back first, or transparent parts would keep the old pixels.
+			bool filled = false;
+			for (i = 0; i < dirty.Size(); ++i)
+			{
+				int top = MAX(dirty[i].Top, ::ST_Y);
+				int left = MAX(dirty[i].Left, 0);
+				int right = MIN(dirty[i].Right, SCREENWIDTH);
+				int bottom = MIN(dirty[i].Bottom, SCREENHEIGHT);
+
+				if (left < right && top < bottom)
+				{
+					V_DrawBorder(left, top, right, bottom);
+					filled = true;
+				}
+			}
+			if (filled)
+			{
+				RefreshBackground();
+			}
+		}
+
+		for (i = 0; i < elements.Size(); ++i)
+		{
+			if (full)
+			{
+				elements[i].Draw(everything);
+				SBarElementsDrawn++;
+				continue;
+			}
+
+			SBarRect bounds = elements[i].GetBounds();
+			bool drawn = false;
+			for (j = 0; j < dirty.Size(); ++j)
+			{
+				if (dirty[j].Intersects(bounds))
+				{
+					elements[i].Draw(dirty[j]);
+					drawn = true;
+				}
+			}
+			if (drawn) SBarElementsDrawn++;
+			else SBarElementsReused++;
+		}
+		lastElements = elements;
+		pendingDirty.Clear();
 	}
 
 	void NewGame ()
@@ -1231,43 +1537,24 @@ public:
 				dcb += 200 - script->resH;
 			}
 
+			SBarElement element(texture, dx, dy, w, h, alpha);
 			if(clearDontDraw)
-				screen->Clear(static_cast<int>(MAX<double>(dx, dcx)), static_cast<int>(MAX<double>(dy, dcy)), static_cast<int>(MIN<double>(dcr,w+MAX<double>(dx, dcx))), static_cast<int>(MIN<double>(dcb,MAX<double>(dy, dcy)+h)), GPalette.BlackIndex, 0);
+			{
+				element.Flags = SBarElement::SBE_Clear;
+				element.Clip.Left = static_cast<int>(MAX<double>(dx, dcx));
+				element.Clip.Top = static_cast<int>(MAX<double>(dy, dcy));
+				element.Clip.Right = static_cast<int>(MIN<double>(dcr,w+MAX<double>(dx, dcx)));
+				element.Clip.Bottom = static_cast<int>(MIN<double>(dcb,MAX<double>(dy, dcy)+h));
+			}
 			else
 			{
-				if(alphaMap)
-				{
-					screen->DrawTexture(texture, dx, dy,
-						DTA_DestWidthF, w,
-						DTA_DestHeightF, h,
-						DTA_ClipLeft, static_cast<int>(dcx),
-						DTA_ClipTop, static_cast<int>(dcy),
-						DTA_ClipRight, static_cast<int>(MIN<double>(INT_MAX, dcr)),
-						DTA_ClipBottom, static_cast<int>(MIN<double>(INT_MAX, dcb)),
-						DTA_Translation, translate ? GetTranslation() : 0,
-						DTA_ColorOverlay, dim ? DIM_OVERLAY : 0,
-						DTA_CenterBottomOffset, (offsetflags & SBarInfoCommand::CENTER_BOTTOM) == SBarInfoCommand::CENTER_BOTTOM,
-						DTA_Alpha, alpha,
-						DTA_AlphaChannel, alphaMap,
-						DTA_FillColor, 0,
-						TAG_DONE);
-				}
-				else
-				{
-					screen->DrawTexture(texture, dx, dy,
-						DTA_DestWidthF, w,
-						DTA_DestHeightF, h,
-						DTA_ClipLeft, static_cast<int>(dcx),
-						DTA_ClipTop, static_cast<int>(dcy),
-						DTA_ClipRight, static_cast<int>(MIN<double>(INT_MAX, dcr)),
-						DTA_ClipBottom, static_cast<int>(MIN<double>(INT_MAX, dcb)),
-						DTA_Translation, translate ? GetTranslation() : 0,
-						DTA_ColorOverlay, dim ? DIM_OVERLAY : 0,
-						DTA_CenterBottomOffset, (offsetflags & SBarInfoCommand::CENTER_BOTTOM) == SBarInfoCommand::CENTER_BOTTOM,
-						DTA_Alpha, alpha,
-						TAG_DONE);
-				}
+				element.Clip.Left = static_cast<int>(dcx);
+				element.Clip.Top = static_cast<int>(dcy);
+				element.Clip.Right = static_cast<int>(MIN<double>(INT_MAX, dcr));
+				element.Clip.Bottom = static_cast<int>(MIN<double>(INT_MAX, dcb));
+				SetElementStyle(element, translate, dim, offsetflags, alphaMap);
 			}
+			DrawElement(element, true);
 		}
 		else
 		{
@@ -1308,43 +1595,37 @@ public:
 				rcb = cb == 0 ? INT_MAX : ry+h-((((double) cb/FRACUNIT) + texture->GetScaledTopOffsetDouble())*yScale);
 			}
 
+			SBarElement element(texture, rx, ry, w, h, alpha);
 			if(clearDontDraw)
-				screen->Clear(static_cast<int>(rcx), static_cast<int>(rcy), static_cast<int>(MIN<double>(rcr, rcx+w)), static_cast<int>(MIN<double>(rcb, rcy+h)), GPalette.BlackIndex, 0);
+			{
+				element.Flags = SBarElement::SBE_Clear;
+				element.Clip.Left = static_cast<int>(rcx);
+				element.Clip.Top = static_cast<int>(rcy);
+				element.Clip.Right = static_cast<int>(MIN<double>(rcr, rcx+w));
+				element.Clip.Bottom = static_cast<int>(MIN<double>(rcb, rcy+h));
+			}
 			else
 			{
-				if(alphaMap)
-				{
-					screen->DrawTexture(texture, rx, ry,
-						DTA_DestWidthF, w,
-						DTA_DestHeightF, h,
-						DTA_ClipLeft, static_cast<int>(rcx),
-						DTA_ClipTop, static_cast<int>(rcy),
-						DTA_ClipRight, static_cast<int>(rcr),
-						DTA_ClipBottom, static_cast<int>(rcb),
-						DTA_Translation, translate ? GetTranslation() : 0,
-						DTA_ColorOverlay, dim ? DIM_OVERLAY : 0,
-						DTA_CenterBottomOffset, (offsetflags & SBarInfoCommand::CENTER_BOTTOM) == SBarInfoCommand::CENTER_BOTTOM,
-						DTA_Alpha, alpha,
-						DTA_AlphaChannel, alphaMap,
-						DTA_FillColor, 0,
-						TAG_DONE);
-				}
-				else
-				{
-					screen->DrawTexture(texture, rx, ry,
-						DTA_DestWidthF, w,
-						DTA_DestHeightF, h,
-						DTA_ClipLeft, static_cast<int>(rcx),
-						DTA_ClipTop, static_cast<int>(rcy),
-						DTA_ClipRight, static_cast<int>(rcr),
-						DTA_ClipBottom, static_cast<int>(rcb),
-						DTA_Translation, translate ? GetTranslation() : 0,
-						DTA_ColorOverlay, dim ? DIM_OVERLAY : 0,
-						DTA_CenterBottomOffset, (offsetflags & SBarInfoCommand::CENTER_BOTTOM) == SBarInfoCommand::CENTER_BOTTOM,
-						DTA_Alpha, alpha,
-						TAG_DONE);
-				}
+				element.Clip.Left = static_cast<int>(rcx);
+				element.Clip.Top = static_cast<int>(rcy);
+				element.Clip.Right = static_cast<int>(rcr);
+				element.Clip.Bottom = static_cast<int>(rcb);
+				SetElementStyle(element, translate, dim, offsetflags, alphaMap);
 			}
+			DrawElement(element, false);
+		}
+	}
+
+	void SetElementStyle(SBarElement &element, bool translate, bool dim, int offsetflags, bool alphaMap) const
+	{
+		element.Translation = translate ? GetTranslation() : NULL;
+		element.Overlay = dim ? DIM_OVERLAY : 0;
+		if((offsetflags & SBarInfoCommand::CENTER_BOTTOM) == SBarInfoCommand::CENTER_BOTTOM)
+			element.Flags |= SBarElement::SBE_CenterBottom;
+		if(alphaMap)
+		{
+			element.Flags |= SBarElement::SBE_AlphaMap;
+			element.FillColor = 0;
 		}
 	}
 
@@ -1461,19 +1742,13 @@ public:
 				int salpha = fixed_t(((double) alpha / (double) FRACUNIT) * ((double) HR_SHADOW / (double) FRACUNIT) * FRACUNIT);
 				double srx = rx + (shadowX*xScale);
 				double sry = ry + (shadowY*yScale);
-				screen->DrawTexture(character, srx, sry,
-					DTA_DestWidthF, rw,
-					DTA_DestHeightF, rh,
-					DTA_Alpha, salpha,
-					DTA_FillColor, 0,
-					TAG_DONE);
+				SBarElement shadow(character, srx, sry, rw, rh, salpha);
+				shadow.FillColor = 0;
+				DrawElement(shadow, !fullScreenOffsets);
 			}
-			screen->DrawTexture(character, rx, ry,
-				DTA_DestWidthF, rw,
-				DTA_DestHeightF, rh,
-				DTA_Translation, remap,
-				DTA_Alpha, alpha,
-				TAG_DONE);
+			SBarElement element(character, rx, ry, rw, rh, alpha);
+			element.Translation = remap;
+			DrawElement(element, !fullScreenOffsets);
 			if(script->spacingCharacter == '\0')
 				ax += width + spacing - (character->LeftOffset+1);
 			else //width gets changed at the call to GetChar()
@@ -1503,6 +1778,12 @@ private:
 	bool scalingWasForced;
 	SBarInfoMainBlock *lastInventoryBar;
 	SBarInfoMainBlock *lastPopup;
+
+	mutable TArray<SBarElement> elements;
+	TArray<SBarElement> lastElements;
+	TArray<SBarRect> pendingDirty;
+	bool recording;		// Status bar elements are being recorded
+	bool retained;		// The last frame's elements are still on the screen
 };
 
 IMPLEMENT_POINTY_CLASS(DSBarInfo)
@@ -1228,6 +1228,12 @@ void DBaseStatusBar::DrawMessages (int layer, int bottom)
 	{
 		visibility |= viewactive ? HUDMSG_NotWithOverlayMap : HUDMSG_NotWithFullMap;
 	}
+	if (msg != NULL)
+	{
+		// Messages can be anywhere, and they move and fade, so the bar has
+		// to be redrawn as long as there are any.
+		Invalidate (0, ::ST_Y, SCREENWIDTH, SCREENHEIGHT);
+	}
 	while (msg)
 	{
 		DHUDMessage *next = msg->Next;
@@ -1430,6 +1436,8 @@ void DBaseStatusBar::DrawLog ()
 
 	if (CPlayer->LogText && *CPlayer->LogText)
 	{
+		Invalidate (0, ::ST_Y, SCREENWIDTH, SCREENHEIGHT);
+
 		// This uses the same scaling as regular HUD messages
 		switch (con_scaletext)
 		{
@@ -1535,6 +1543,7 @@ void DBaseStatusBar::DrawTopStuff (EHudState state)
 
 	if (noisedebug)
 	{
+		Invalidate (0, ::ST_Y, SCREENWIDTH, SCREENHEIGHT);
 		S_NoiseDebug ();
 	}
 }
@@ -1702,6 +1711,20 @@ void DBaseStatusBar::Serialize (FArchive &arc)
 	}
 }
 
+//---------------------------------------------------------------------------
+//
+// Invalidate
+//
+// Something was drawn over part of the screen. A status bar that can
+// redraw just that area should override this.
+//
+//---------------------------------------------------------------------------
+
+void DBaseStatusBar::Invalidate (int left, int top, int right, int bottom)
+{
+	ST_SetNeedRefresh();
+}
+
 void DBaseStatusBar::ScreenSizeChanged ()
 {
 	st_scale.Callback ();
@@ -35,6 +35,8 @@
 #define __MEMARENA_H
 
 #include "zstring.h"
+#include "tarray.h"
+#include "m_alloc.h"
 
 // A general purpose arena.
 class FMemArena
@@ -85,5 +87,118 @@ private:
 	void *Alloc(size_t size) { return NULL; }	// No access to FMemArena::Alloc for outsiders.
 };
 
+// A pool of fixed-size nodes for structures that are allocated and freed
+// all the time. Nodes are handed out in order from cache line aligned
+// slabs, and freed nodes go on a free list to be reused first. Memory is
+// only given back to the system by FreeAll. Nodes are not constructed, so
+// this is only meant for plain structures.
+template<class T, int NODESPERSLAB = 1024>
+class TNodePool
+{
+	enum { CACHELINE = 64 };
+
+	struct FreeNode
+	{
+		FreeNode *Next;
+	};
+	struct Slab
+	{
+		void *Memory;
+		T *Nodes;
+	};
+
+	TArray<Slab> Slabs;
+	FreeNode *FreeList;
+	unsigned CurSlab;		// slab nodes are currently being carved from
+	int NextNew;			// first unused node in the current slab
+	int Live, Peak;
+
+public:
+	TNodePool()
+	{
+		FreeList = NULL;
+		CurSlab = 0;
+		NextNew = 0;
+		Live = Peak = 0;
+	}
+	~TNodePool()
+	{
+		FreeAll();
+	}
+
+	T *Alloc()
+	{
+		T *node;
+
+		if (FreeList != NULL)
+		{
+			node = (T *)FreeList;
+			FreeList = FreeList->Next;
+		}
+		else
+		{
+			if (NextNew == NODESPERSLAB)
+			{
+				CurSlab++;
+				NextNew = 0;
+			}
+			if (CurSlab == Slabs.Size())
+			{
+				Slab slab;
+				slab.Memory = M_Malloc(NODESPERSLAB * sizeof(T) + CACHELINE - 1);
+				slab.Nodes = (T *)(((size_t)slab.Memory + CACHELINE - 1) & ~(size_t)(CACHELINE - 1));
+				Slabs.Push(slab);
+			}
+			node = &Slabs[CurSlab].Nodes[NextNew++];
+		}
+		if (++Live > Peak)
+		{
+			Peak = Live;
+		}
+		return node;
+	}
+
+	void Release(T *node)
+	{
+		FreeNode *free = (FreeNode *)node;
+		free->Next = FreeList;
+		FreeList = free;
+		Live--;
+	}
+
+	// Starts handing out nodes from the beginning of the first slab again,
+	// so that the next batch of allocations is laid out contiguously. Only
+	// possible when no nodes are in use.
+	bool Reset()
+	{
+		if (Live != 0)
+		{
+			return false;
+		}
+		FreeList = NULL;
+		CurSlab = 0;
+		NextNew = 0;
+		return true;
+	}
+
+	// Frees all the slabs. Must only be called when no nodes are in use.
+	void FreeAll()
+	{
+		for (unsigned i = 0; i < Slabs.Size(); ++i)
+		{
+			M_Free(Slabs[i].Memory);
+		}
+		Slabs.Clear();
+		FreeList = NULL;
+		CurSlab = 0;
+		NextNew = 0;
+		Live = 0;
+	}
+
+	int LiveCount() const { return Live; }
+	int PeakCount() const { return Peak; }
+	int Capacity() const { return Slabs.Size() * NODESPERSLAB; }
+};
+
 
 #endif
\ No newline at end of file
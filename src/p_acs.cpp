@@ -77,11 +77,14 @@
 #include "decallib.h"
 
 #include "g_shared/a_pickups.h"
+#include "stats.h"
 
 extern FILE *Logfile;
 
 FRandom pr_acs ("ACS");
 
+cycle_t ACSCycles;
+
 // I imagine this much stack space is probably overkill, but it could
 // potentially get used with recursive functions.
 #define STACK_SIZE 4096
@@ -2974,12 +2977,14 @@ void DACSThinker::Tick ()
 {
 	DLevelScript *script = Scripts;
 
+	ACSCycles.Clock();
 	while (script)
 	{
 		DLevelScript *next = script->next;
 		script->RunScript ();
 		script = next;
 	}
+	ACSCycles.Unclock();
 
 //	GlobalACSStrings.Clear();
 
@@ -5695,6 +5700,7 @@ doplaysound:			if (funcIndex == ACSF_PlayActorSound)
 				{
 					lines[line].activation = args[1];
 				}
+				P_ClearSightMemo ();
 			}
 			break;
 
@@ -7424,6 +7430,7 @@ scriptwait:
 			{
 				activationline->special = 0;
 				DPrintf("Cleared line special on line %d\n", (int)(activationline - lines));
+				P_ClearSightMemo ();
 			}
 			break;
 
@@ -8001,6 +8008,7 @@ scriptwait:
 						break;
 					}
 				}
+				P_ClearSightMemo ();
 
 				sp -= 2;
 			}
@@ -8047,6 +8055,7 @@ scriptwait:
 					DPrintf("Set special on line %d (id %d) to %d(%d,%d,%d,%d,%d)\n",
 						linenum, STACK(7), specnum, arg0, STACK(4), STACK(3), STACK(2), STACK(1));
 				}
+				P_ClearSightMemo ();
 				sp -= 7;
 			}
 			break;
@@ -3498,7 +3498,11 @@ int P_ExecuteSpecial(int			num,
 {
 	if (num >= 0 && num <= 255)
 	{
-		return LineSpecials[num](line, activator, backSide, arg1, arg2, arg3, arg4, arg5);
+		int res = LineSpecials[num](line, activator, backSide, arg1, arg2, arg3, arg4, arg5);
+
+		// The special may have changed anything that blocks sight.
+		P_ClearSightMemo ();
+		return res;
 	}
 	return 0;
 }
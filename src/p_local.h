@@ -31,6 +31,7 @@
 #include "d_player.h"
 
 #include "a_morph.h"
+#include "memarena.h"
 
 #include <stdlib.h>
 
@@ -264,6 +265,45 @@ void	P_LineOpening (FLineOpening &open, AActor *thing, const line_t *linedef, fi
 
 class FBoundingBox;
 struct polyblock_t;
+struct FPolyObj;
+
+//==========================================================================
+//
+// FQueryContext
+//
+// Remembers which lines and polyobjects a blockmap query has already
+// visited. Queries keep this here instead of stamping the global
+// validcount into the level data, so they only write to their own
+// context and queries with separate contexts don't get in each other's
+// way. MainQueryContext is the one used by the game thread.
+//
+//==========================================================================
+
+class FQueryContext
+{
+	TArray<DWORD> LineStamps;
+	TArray<DWORD> PolyStamps;
+	DWORD Stamp;
+
+public:
+	FQueryContext() : Stamp(0) {}
+
+	// Forgets everything visited so far.
+	void NewQuery();
+
+	// These return true the first time something is visited by the
+	// current query.
+	bool VisitLine(const line_t *ld)
+	{
+		DWORD &stamp = LineStamps[int(ld - lines)];
+		if (stamp == Stamp) return false;
+		stamp = Stamp;
+		return true;
+	}
+	bool VisitPolyobj(const FPolyObj *po);
+};
+
+extern FQueryContext MainQueryContext;
 
 class FBlockLinesIterator
 {
@@ -274,12 +314,13 @@ class FBlockLinesIterator
 	polyblock_t *polyLink;
 	int polyIndex;
 	int *list;
+	FQueryContext *context;
 
 	void StartBlock(int x, int y);
 
 public:
-	FBlockLinesIterator(int minx, int miny, int maxx, int maxy, bool keepvalidcount = false);
-	FBlockLinesIterator(const FBoundingBox &box);
+	FBlockLinesIterator(int minx, int miny, int maxx, int maxy, bool keepvalidcount = false, FQueryContext *context = &MainQueryContext);
+	FBlockLinesIterator(const FBoundingBox &box, FQueryContext *context = &MainQueryContext);
 	line_t *Next();
 	void Reset() { StartBlock(minx, miny); }
 };
@@ -293,6 +334,9 @@ class FBlockThingsIterator
 
 	FBlockNode *block;
 
+	bool filter;
+	fixed_t filterx, filtery, filterradius;
+
 	int Buckets[32];
 
 	struct HashEntry
@@ -321,25 +365,91 @@ public:
 	FBlockThingsIterator(const FBoundingBox &box);
 	AActor *Next(bool centeronly = false);
 	void Reset() { StartBlock(minx, miny); }
+
+	// Only return actors whose box overlaps the given one, judging by
+	// their current position and radius.
+	void SetFilter(fixed_t x, fixed_t y, fixed_t radius)
+	{
+		filter = true;
+		filterx = x;
+		filtery = y;
+		filterradius = radius;
+	}
+};
+
+//==========================================================================
+//
+// FPackedBlockLines
+//
+// Copies of the vertices of the lines in blockmap blocks, packed so that
+// many traces through the same blocks can test all of a block's lines in
+// one go without touching the lines themselves. Blocks are packed the
+// first time they are asked for. Polyobject lines are never included.
+//
+//==========================================================================
+
+class FPackedBlockLines
+{
+	TArray<int> BlockStart;		// first packed line of each block, -1 if not packed
+	TArray<int> BlockCount;
+	TArray<int> BlocksUsed;
+	TArray<int> LineNums;
+	TArray<fixed_t> X1, Y1, X2, Y2;
+	TArray<BYTE> Crossed;
+
+public:
+	// Returns the number of lines in the block. linenums is set to their
+	// line numbers, and crossed to a flag for each telling whether its
+	// vertices are on different sides of the trace, judged by
+	// P_PointOnDivlineSide.
+	int Classify(int block, const divline_t &trace, const int *&linenums, const BYTE *&crossed);
+	void Clear();
 };
 
 class FPathTraverse
 {
 	static TArray<intercept_t> intercepts;
 
+	TArray<intercept_t> *buffer;
 	divline_t trace;
-	unsigned int intercept_index;
-	unsigned int intercept_count;
+	unsigned int intercept_index;	// first intercept of this traversal in buffer
+	unsigned int next_index;		// next intercept to be returned by Next()
 	fixed_t maxfrac;
-	unsigned int count;
-
+	FQueryContext *context;
+	FBlockThingsIterator btit;		// one list of checked actors for the entire operation
+
+	// The state of the blockmap walk, so that lazy traversals can resume it
+	int ptflags;
+	bool compatible;
+	bool walking;
+	int count;
+	int mapx, mapy;
+	int mapxstep, mapystep;
+	int xt2, yt2;
+	fixed_t xstep, ystep;
+	fixed_t xintercept, yintercept;
+	double safefrac;				// all intercepts closer than this have been found
+
+	void WalkStep();
+	void UpdateSafeFrac();
+	void AddIntercept(const intercept_t &in);
+	void AddLineIntercept(line_t *ld);
 	void AddLineIntercepts(int bx, int by);
+	void AddPackedLineIntercepts(int bx, int by);
 	void AddThingIntercepts(int bx, int by, FBlockThingsIterator &it, bool compatible);
 public:
 
 	intercept_t *Next();
 
-	FPathTraverse(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2, int flags);
+	// Collects the intercepts from all blocks a lazy traversal has not
+	// reached yet. Call it before doing anything that changes the map.
+	void Finish();
+
+	// buffer is where the intercepts are collected. It is used like a
+	// stack, so traversals can be nested, and defaults to one that is
+	// shared by everything.
+	FPathTraverse(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2, int flags, FQueryContext *context = &MainQueryContext,
+		TArray<intercept_t> *buffer = NULL);
 	~FPathTraverse();
 	const divline_t &Trace() const { return trace; }
 };
@@ -349,6 +459,14 @@ public:
 #define PT_ADDTHINGS	2
 #define PT_COMPATIBLE	4
 #define PT_DELTA		8		// x2,y2 is passed as a delta, not as an endpoint
+#define PT_LAZY			16		// Walk the blockmap only as far as Next() needs to. Callers must
+								// call Finish() before they change the map while traversing.
+
+// Traces between these calls share packed copies of the blockmap lines
+// they pass. Meant for sets of traces that go the same way, like the
+// pellets of a shotgun blast.
+void P_BeginTraceBatch ();
+void P_EndTraceBatch ();
 
 AActor *P_BlockmapSearch (AActor *mo, int distance, AActor *(*check)(AActor*, int, void *), void *params = NULL);
 AActor *P_RoughMonsterSearch (AActor *mo, int distance, bool onlyseekable=false);
@@ -430,6 +548,7 @@ enum ESightFlags
 };
 
 void	P_ResetSightCounters (bool full);
+void	P_ClearSightMemo ();
 bool	P_TalkFacing (AActor *player);
 void	P_UseLines (player_t* player);
 bool	P_UsePuzzleItem (AActor *actor, int itemType);
@@ -538,6 +657,32 @@ extern fixed_t			bmaporgx;
 extern fixed_t			bmaporgy;		// origin of block map
 extern FBlockNode**		blocklinks; 	// for thing chains
 
+extern TNodePool<FBlockNode>	BlockNodePool;
+extern TNodePool<msecnode_t>	SecnodePool;
+
+// Coarse blocks group COARSEBLOCKSIZE x COARSEBLOCKSIZE blocks. Each has
+// one bit per block, set while that block's thing chain is non-empty, so
+// long-range searches can skip empty parts of the map quickly.
+#define COARSEBLOCKSHIFT		3
+#define COARSEBLOCKSIZE			(1 << COARSEBLOCKSHIFT)
+#define COARSEBLOCKMASK			(COARSEBLOCKSIZE - 1)
+
+extern QWORD*			coarseblocks;
+extern int				coarsebmapwidth;
+extern int				coarsebmapheight;
+
+inline QWORD &P_CoarseBlock (int x, int y)
+{
+	return coarseblocks[(y >> COARSEBLOCKSHIFT)*coarsebmapwidth + (x >> COARSEBLOCKSHIFT)];
+}
+
+inline QWORD P_CoarseBlockBit (int x, int y)
+{
+	return QWORD(1) << (((y & COARSEBLOCKMASK) << COARSEBLOCKSHIFT) + (x & COARSEBLOCKMASK));
+}
+
+bool P_BlocksOccupied (int x1, int y1, int x2, int y2);
+
 
 
 //
@@ -52,6 +52,7 @@
 #include "p_conversation.h"
 #include "r_data/r_translate.h"
 #include "g_level.h"
+#include "stats.h"
 
 CVAR(Bool, cl_bloodsplats, true, CVAR_ARCHIVE)
 CVAR(Int, sv_smartaim, 0, CVAR_ARCHIVE | CVAR_SERVERINFO)
@@ -67,6 +68,9 @@ static FRandom pr_checkthing("CheckThing");
 static FRandom pr_lineattack("LineAttack");
 static FRandom pr_crunch("DoCrunch");
 
+cycle_t TryMoveCycles;
+static int TryMoveDepth;
+
 // keep track of special lines as they are hit,
 // but don't process them until the move is proven valid
 TArray<line_t *> spechit;
@@ -321,7 +325,6 @@ void P_FindFloorCeiling(AActor *actor, int flags)
 
 	tmf.touchmidtex = false;
 	tmf.abovemidtex = false;
-	validcount++;
 
 	FBlockLinesIterator it(box);
 	line_t *ld;
@@ -1427,7 +1430,6 @@ bool P_CheckPosition(AActor *thing, fixed_t x, fixed_t y, FCheckPosition &tm, bo
 	}
 #endif
 
-	validcount++;
 	spechit.Clear();
 
 	if ((thing->flags & MF_NOCLIP) && !(thing->flags & MF_SKULLFLY))
@@ -1447,6 +1449,8 @@ bool P_CheckPosition(AActor *thing, fixed_t x, fixed_t y, FCheckPosition &tm, bo
 	{
 		FBlockThingsIterator it2(box);
 		AActor *th;
+		// PIT_CheckThing ignores everything outside this box anyway
+		it2.SetFilter(x, y, thing->radius);
 		while ((th = it2.Next()))
 		{
 			if (!PIT_CheckThing(th, tm))
@@ -1495,17 +1499,6 @@ bool P_CheckPosition(AActor *thing, fixed_t x, fixed_t y, FCheckPosition &tm, bo
 
 	// check lines
 
-	// [RH] We need to increment validcount again, because a function above may
-	// have already set some lines to equal the current validcount.
-	//
-	// Specifically, when DehackedPickup spawns a new item in its TryPickup()
-	// function, that new actor will set the lines around it to match validcount
-	// when it links itself into the world. If we just leave validcount alone,
-	// that will give the player the freedom to walk through walls at will near
-	// a pickup they cannot get, because their validcount will prevent them from
-	// being considered for collision with the player.
-	validcount++;
-
 	thing->BlockingMobj = NULL;
 	thing->height = realheight;
 	if (actorsonly || (thing->flags & MF_NOCLIP))
@@ -1790,11 +1783,25 @@ static void CheckForPushSpecial(line_t *line, int side, AActor *mobj, bool windo
 //
 //==========================================================================
 
+static bool P_DoTryMove(AActor *thing, fixed_t x, fixed_t y,
+	int dropoff, const secplane_t *onfloor, FCheckPosition &tm, bool missileCheck);
+
 bool P_TryMove(AActor *thing, fixed_t x, fixed_t y,
 	int dropoff, // killough 3/15/98: allow dropoff as option
 	const secplane_t *onfloor, // [RH] Let P_TryMove keep the thing on the floor
 	FCheckPosition &tm,
 	bool missileCheck)	// [GZ] Fired missiles ignore the drop-off test
+{
+	// Line specials triggered by the move can move other actors,
+	// so only the outermost call gets timed.
+	if (TryMoveDepth++ == 0) TryMoveCycles.Clock();
+	bool res = P_DoTryMove(thing, x, y, dropoff, onfloor, tm, missileCheck);
+	if (--TryMoveDepth == 0) TryMoveCycles.Unclock();
+	return res;
+}
+
+static bool P_DoTryMove(AActor *thing, fixed_t x, fixed_t y,
+	int dropoff, const secplane_t *onfloor, FCheckPosition &tm, bool missileCheck)
 {
 	fixed_t 	oldx;
 	fixed_t 	oldy;
@@ -5386,6 +5393,9 @@ bool P_ChangeSector(sector_t *sector, int crunch, int amt, int floorOrCeil, bool
 	void(*iterator2)(AActor *, FChangePosition *) = NULL;
 	msecnode_t *n;
 
+	// Every moving floor and ceiling comes through here.
+	P_ClearSightMemo ();
+
 	cpos.nofit = false;
 	cpos.crushchange = crunch;
 	cpos.moveamt = abs(amt);
@@ -5540,9 +5550,10 @@ bool P_ChangeSector(sector_t *sector, int crunch, int amt, int floorOrCeil, bool
 // phares 3/21/98
 //
 // Maintain a freelist of msecnode_t's to reduce memory allocs and frees.
+// The pool keeps the freelist now.
 //=============================================================================
 
-msecnode_t *headsecnode = NULL;
+TNodePool<msecnode_t> SecnodePool;
 
 //=============================================================================
 //
@@ -5555,18 +5566,7 @@ msecnode_t *headsecnode = NULL;
 
 msecnode_t *P_GetSecnode()
 {
-	msecnode_t *node;
-
-	if (headsecnode)
-	{
-		node = headsecnode;
-		headsecnode = headsecnode->m_snext;
-	}
-	else
-	{
-		node = (msecnode_t *)M_Malloc(sizeof(*node));
-	}
-	return node;
+	return SecnodePool.Alloc();
 }
 
 //=============================================================================
@@ -5579,8 +5579,7 @@ msecnode_t *P_GetSecnode()
 
 void P_PutSecnode(msecnode_t *node)
 {
-	node->m_snext = headsecnode;
-	headsecnode = node;
+	SecnodePool.Release(node);
 }
 
 //=============================================================================
@@ -5720,6 +5719,41 @@ void P_DelSeclist(msecnode_t *node)
 		node = P_DelSecnode(node);
 }
 
+//=============================================================================
+//
+// P_BoxHasOnlySector
+//
+// Returns true if every line crossing the box belongs to the given
+// sector on all of its sides. This looks at more lines than the sector
+// list itself, so it uses its own query context to leave the lines that
+// MainQueryContext considers visited as they are.
+//
+//=============================================================================
+
+static FQueryContext SecNodeQueryContext;
+
+static bool P_BoxHasOnlySector(const FBoundingBox &box, sector_t *sec)
+{
+	FBlockLinesIterator it(box, &SecNodeQueryContext);
+	line_t *ld;
+
+	while ((ld = it.Next()))
+	{
+		if (box.Right() <= ld->bbox[BOXLEFT] ||
+			box.Left() >= ld->bbox[BOXRIGHT] ||
+			box.Top() <= ld->bbox[BOXBOTTOM] ||
+			box.Bottom() >= ld->bbox[BOXTOP])
+			continue;
+
+		if (box.BoxOnLineSide(ld) != -1)
+			continue;
+
+		if (ld->frontsector != sec || (ld->backsector != NULL && ld->backsector != sec))
+			return false;
+	}
+	return true;
+}
+
 //=============================================================================
 // phares 3/14/98
 //
@@ -5727,11 +5761,46 @@ void P_DelSeclist(msecnode_t *node)
 //
 // Alters/creates the sector_list that shows what sectors the object resides in
 //
+// If all lines around the actor only belong to its own sector, the area
+// where that is true is remembered. As long as the actor stays inside it,
+// its sector list can only consist of that one sector, and neither the
+// lines nor the sector nodes need to be looked at again. The blockmap is
+// still walked to mark its lines visited, exactly as a rebuild would.
+// Polyobjects can move into that area, so this is disabled for maps that
+// have any.
+//
 //=============================================================================
 
+#define SECNODE_MARGIN		(64*FRACUNIT)
+
+static int SecNodeRebuilds, SecNodeSkips;
+
 void P_CreateSecNodeList(AActor *thing, fixed_t x, fixed_t y)
 {
 	msecnode_t *node;
+	bool onlyown = true;
+
+	if (thing->SecNodeSector != NULL && thing->SecNodeSector == thing->Sector &&
+		sector_list != NULL && sector_list->m_tnext == NULL && sector_list->m_sector == thing->Sector &&
+		thing->x - thing->radius >= thing->SecNodeBox[BOXLEFT] &&
+		thing->x + thing->radius <= thing->SecNodeBox[BOXRIGHT] &&
+		thing->y - thing->radius >= thing->SecNodeBox[BOXBOTTOM] &&
+		thing->y + thing->radius <= thing->SecNodeBox[BOXTOP])
+	{
+		// A line iterator this was called from shares MainQueryContext, so
+		// mark the same lines visited that the search would have.
+		FBoundingBox box(thing->x, thing->y, thing->radius);
+		FBlockLinesIterator it(box);
+
+		while (it.Next())
+		{
+		}
+		sector_list->m_thing = thing;
+		SecNodeSkips++;
+		return;
+	}
+	SecNodeRebuilds++;
+	thing->SecNodeSector = NULL;
 
 	// First, clear out the existing m_thing fields. As each node is
 	// added or verified as needed, m_thing will be set properly. When
@@ -5768,6 +5837,10 @@ void P_CreateSecNodeList(AActor *thing, fixed_t x, fixed_t y)
 		// will be attached to the Thing's AActor at touching_sectorlist.
 
 		sector_list = P_AddSecnode(ld->frontsector, thing, sector_list);
+		if (ld->frontsector != thing->Sector || (ld->backsector != NULL && ld->backsector != thing->Sector))
+		{
+			onlyown = false;
+		}
 
 		// Don't assume all lines are 2-sided, since some Things
 		// like MT_TFOG are allowed regardless of whether their radius takes
@@ -5801,6 +5874,29 @@ void P_CreateSecNodeList(AActor *thing, fixed_t x, fixed_t y)
 			node = node->m_tnext;
 		}
 	}
+
+	if (onlyown && po_NumPolyobjs == 0)
+	{
+		FBoundingBox cachebox(thing->x, thing->y, thing->radius + SECNODE_MARGIN);
+
+		if (P_BoxHasOnlySector(cachebox, thing->Sector))
+		{
+			thing->SecNodeSector = thing->Sector;
+			thing->SecNodeBox[BOXLEFT] = cachebox.Left();
+			thing->SecNodeBox[BOXRIGHT] = cachebox.Right();
+			thing->SecNodeBox[BOXBOTTOM] = cachebox.Bottom();
+			thing->SecNodeBox[BOXTOP] = cachebox.Top();
+		}
+	}
+}
+
+ADD_STAT (secnodes)
+{
+	FString out;
+	int total = SecNodeRebuilds + SecNodeSkips;
+	out.Format ("sector lists rebuilt %d, skipped %d (%.1f%%)", SecNodeRebuilds, SecNodeSkips,
+		total > 0 ? SecNodeSkips * 100. / total : 0.);
+	return out;
 }
 
 //==========================================================================
@@ -27,6 +27,7 @@
 
 
 #include <stdlib.h>
+#include <float.h>
 
 
 #include "m_bbox.h"
@@ -40,6 +41,7 @@
 #include "r_state.h"
 #include "templates.h"
 #include "po_man.h"
+#include "x86.h"
 
 static AActor *RoughBlockCheck (AActor *mo, int index, void *);
 
@@ -299,6 +301,12 @@ void AActor::UnlinkFromWorld ()
 				block->NextActor->PrevActor = block->PrevActor;
 			}
 			*(block->PrevActor) = block->NextActor;
+			if (blocklinks[block->BlockIndex] == NULL)
+			{
+				int x = block->BlockIndex % bmapwidth;
+				int y = block->BlockIndex / bmapwidth;
+				P_CoarseBlock (x, y) &= ~P_CoarseBlockBit (x, y);
+			}
 			FBlockNode *next = block->NextBlock;
 			block->Release ();
 			block = next;
@@ -407,6 +415,7 @@ void AActor::LinkToWorld (sector_t *sec)
 					}
 					node->PrevActor = link;
 					*link = node;
+					P_CoarseBlock (x, y) |= P_CoarseBlockBit (x, y);
 
 					// Link in to actor
 					node->PrevBlock = alink;
@@ -594,21 +603,12 @@ void AActor::SetOrigin (fixed_t ix, fixed_t iy, fixed_t iz)
 	P_FindFloorCeiling(this, FFCF_ONLYSPAWNPOS);
 }
 
-FBlockNode *FBlockNode::FreeBlocks = NULL;
+TNodePool<FBlockNode> BlockNodePool;
 
 FBlockNode *FBlockNode::Create (AActor *who, int x, int y)
 {
-	FBlockNode *block;
+	FBlockNode *block = BlockNodePool.Alloc();
 
-	if (FreeBlocks != NULL)
-	{
-		block = FreeBlocks;
-		FreeBlocks = block->NextBlock;
-	}
-	else
-	{
-		block = new FBlockNode;
-	}
 	block->BlockIndex = x + y*bmapwidth;
 	block->Me = who;
 	block->NextActor = NULL;
@@ -620,8 +620,7 @@ FBlockNode *FBlockNode::Create (AActor *who, int x, int y)
 
 void FBlockNode::Release ()
 {
-	NextBlock = FreeBlocks;
-	FreeBlocks = this;
+	BlockNodePool.Release(this);
 }
 
 //
@@ -633,6 +632,50 @@ void FBlockNode::Release ()
 //
 
 
+//===========================================================================
+//
+// FQueryContext
+//
+//===========================================================================
+
+FQueryContext MainQueryContext;
+
+//===========================================================================
+//
+// FQueryContext :: NewQuery
+//
+// Stamps only ever grow, so entries left over from an earlier level
+// can't match. The arrays need to be cleared only when the stamp wraps
+// or when they are resized.
+//
+//===========================================================================
+
+void FQueryContext::NewQuery()
+{
+	if (++Stamp == 0 || LineStamps.Size() != (unsigned)numlines || PolyStamps.Size() != (unsigned)po_NumPolyobjs)
+	{
+		LineStamps.Resize(numlines);
+		PolyStamps.Resize(po_NumPolyobjs);
+		if (numlines > 0) memset(&LineStamps[0], 0, numlines * sizeof(DWORD));
+		if (po_NumPolyobjs > 0) memset(&PolyStamps[0], 0, po_NumPolyobjs * sizeof(DWORD));
+		if (Stamp == 0) Stamp = 1;
+	}
+}
+
+//===========================================================================
+//
+// FQueryContext :: VisitPolyobj
+//
+//===========================================================================
+
+bool FQueryContext::VisitPolyobj(const FPolyObj *po)
+{
+	DWORD &stamp = PolyStamps[int(po - polyobjs)];
+	if (stamp == Stamp) return false;
+	stamp = Stamp;
+	return true;
+}
+
 //===========================================================================
 //
 // FBlockLinesIterator
@@ -640,9 +683,10 @@ void FBlockNode::Release ()
 //===========================================================================
 extern polyblock_t **PolyBlockMap;
 
-FBlockLinesIterator::FBlockLinesIterator(int _minx, int _miny, int _maxx, int _maxy, bool keepvalidcount)
+FBlockLinesIterator::FBlockLinesIterator(int _minx, int _miny, int _maxx, int _maxy, bool keepvalidcount, FQueryContext *_context)
 {
-	if (!keepvalidcount) validcount++;
+	context = _context;
+	if (!keepvalidcount) context->NewQuery();
 	minx = _minx;
 	maxx = _maxx;
 	miny = _miny;
@@ -650,9 +694,10 @@ FBlockLinesIterator::FBlockLinesIterator(int _minx, int _miny, int _maxx, int _m
 	Reset();
 }
 
-FBlockLinesIterator::FBlockLinesIterator(const FBoundingBox &box)
+FBlockLinesIterator::FBlockLinesIterator(const FBoundingBox &box, FQueryContext *_context)
 {
-	validcount++;
+	context = _context;
+	context->NewQuery();
 	maxy = GetSafeBlockY(box.Top() - bmaporgy);
 	miny = GetSafeBlockY(box.Bottom() - bmaporgy);
 	maxx = GetSafeBlockX(box.Right() - bmaporgx);
@@ -706,12 +751,11 @@ line_t *FBlockLinesIterator::Next()
 			{
 				if (polyIndex == 0)
 				{
-					if (polyLink->polyobj->validcount == validcount)
+					if (!context->VisitPolyobj(polyLink->polyobj))
 					{
 						polyLink = polyLink->next;
 						continue;
 					}
-					polyLink->polyobj->validcount = validcount;
 				}
 
 				line_t *ld = polyLink->polyobj->Linedefs[polyIndex];
@@ -722,13 +766,12 @@ line_t *FBlockLinesIterator::Next()
 					polyIndex = 0;
 				}
 
-				if (ld->validcount == validcount)
+				if (!context->VisitLine(ld))
 				{
 					continue;
 				}
 				else
 				{
-					ld->validcount = validcount;
 					return ld;
 				}
 			}
@@ -742,9 +785,8 @@ line_t *FBlockLinesIterator::Next()
 				line_t *ld = &lines[*list];
 
 				list++;
-				if (ld->validcount != validcount)
+				if (context->VisitLine(ld))
 				{
-					ld->validcount = validcount;
 					return ld;
 				}
 			}
@@ -768,6 +810,7 @@ line_t *FBlockLinesIterator::Next()
 FBlockThingsIterator::FBlockThingsIterator()
 : DynHash(0)
 {
+	filter = false;
 	minx = maxx = 0;
 	miny = maxy = 0;
 	ClearHash();
@@ -777,6 +820,7 @@ FBlockThingsIterator::FBlockThingsIterator()
 FBlockThingsIterator::FBlockThingsIterator(int _minx, int _miny, int _maxx, int _maxy)
 : DynHash(0)
 {
+	filter = false;
 	minx = _minx;
 	maxx = _maxx;
 	miny = _miny;
@@ -788,6 +832,7 @@ FBlockThingsIterator::FBlockThingsIterator(int _minx, int _miny, int _maxx, int
 FBlockThingsIterator::FBlockThingsIterator(const FBoundingBox &box)
 : DynHash(0)
 {
+	filter = false;
 	maxy = GetSafeBlockY(box.Top() - bmaporgy);
 	miny = GetSafeBlockY(box.Bottom() - bmaporgy);
 	maxx = GetSafeBlockX(box.Right() - bmaporgx);
@@ -861,6 +906,14 @@ AActor *FBlockThingsIterator::Next(bool centeronly)
 			int i;
 
 			block = block->NextActor;
+			if (filter)
+			{
+				fixed_t blockdist = me->radius + filterradius;
+				if (abs(me->x - filterx) >= blockdist || abs(me->y - filtery) >= blockdist)
+				{
+					continue;
+				}
+			}
 			// Don't recheck things that were already checked
 			if (mynode->NextBlock == NULL && mynode->PrevBlock == &me->BlockNode)
 			{ // This actor doesn't span blocks, so we know it can only ever be checked once.
@@ -918,10 +971,28 @@ AActor *FBlockThingsIterator::Next(bool centeronly)
 			}
 		}
 
-		if (++curx > maxx)
+		// Move on to the next block with things in it, skipping
+		// whole coarse blocks when they are empty.
+		for (;;)
 		{
-			curx = minx;
-			if (++cury > maxy) return NULL;
+			if (++curx > maxx)
+			{
+				curx = minx;
+				if (++cury > maxy) return NULL;
+			}
+			if (curx >= 0 && cury >= 0 && curx < bmapwidth && cury < bmapheight)
+			{
+				QWORD mask = P_CoarseBlock(curx, cury);
+
+				if (mask & P_CoarseBlockBit(curx, cury))
+				{
+					break;
+				}
+				if (mask == 0)
+				{
+					curx = MIN(maxx, curx | COARSEBLOCKMASK);
+				}
+			}
 		}
 		StartBlock(curx, cury);
 	}
@@ -936,6 +1007,147 @@ AActor *FBlockThingsIterator::Next(bool centeronly)
 
 TArray<intercept_t> FPathTraverse::intercepts(128);
 
+// Packed blockmap lines shared by the traces of a batch
+static int TraceBatchDepth;
+static FPackedBlockLines TracePackedLines;
+
+void P_ClassifyLinesSSE2 (fixed_t tx, fixed_t ty, fixed_t tdx, fixed_t tdy,
+	const fixed_t *x1, const fixed_t *y1, const fixed_t *x2, const fixed_t *y2, int count, BYTE *crossed);
+
+//==========================================================================
+//
+// P_ClassifyLines
+//
+// Sets crossed[i] for every packed line whose vertices lie on different
+// sides of the trace, using the same test as P_PointOnDivlineSide.
+//
+//==========================================================================
+
+static void P_ClassifyLinesC (fixed_t tx, fixed_t ty, fixed_t tdx, fixed_t tdy,
+	const fixed_t *x1, const fixed_t *y1, const fixed_t *x2, const fixed_t *y2, int count, BYTE *crossed)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		crossed[i] = (DMulScale32 (y1[i] - ty, tdx, tx - x1[i], tdy) > 0) !=
+					 (DMulScale32 (y2[i] - ty, tdx, tx - x2[i], tdy) > 0);
+	}
+}
+
+static inline void P_ClassifyLines (fixed_t tx, fixed_t ty, fixed_t tdx, fixed_t tdy,
+	const fixed_t *x1, const fixed_t *y1, const fixed_t *x2, const fixed_t *y2, int count, BYTE *crossed)
+{
+#ifdef DISABLE_SSE
+	P_ClassifyLinesC (tx, ty, tdx, tdy, x1, y1, x2, y2, count, crossed);
+#elif defined(__SSE2__) || defined(_M_X64)
+	P_ClassifyLinesSSE2 (tx, ty, tdx, tdy, x1, y1, x2, y2, count, crossed);
+#else
+	if (CPU.bSSE2)
+		P_ClassifyLinesSSE2 (tx, ty, tdx, tdy, x1, y1, x2, y2, count, crossed);
+	else
+		P_ClassifyLinesC (tx, ty, tdx, tdy, x1, y1, x2, y2, count, crossed);
+#endif
+}
+
+//===========================================================================
+//
+// FPackedBlockLines :: Classify
+//
+// The lines of a block are copied out of the blockmap the first time it
+// is looked at, so that they can be tested several at a time.
+//
+//===========================================================================
+
+int FPackedBlockLines::Classify(int block, const divline_t &trace, const int *&linenums, const BYTE *&crossed)
+{
+	int numblocks = bmapwidth * bmapheight;
+
+	if ((int)BlockStart.Size() != numblocks)
+	{
+		Clear();
+		BlockStart.Resize(numblocks);
+		BlockCount.Resize(numblocks);
+		for (int i = 0; i < numblocks; ++i)
+		{
+			BlockStart[i] = -1;
+		}
+	}
+
+	int start = BlockStart[block];
+	if (start < 0)
+	{
+		start = BlockStart[block] = LineNums.Size();
+		BlocksUsed.Push(block);
+		for (int *list = blockmaplump + blockmap[block] + 1; *list != -1; list++)
+		{
+			line_t *ld = &lines[*list];
+			LineNums.Push(*list);
+			X1.Push(ld->v1->x);
+			Y1.Push(ld->v1->y);
+			X2.Push(ld->v2->x);
+			Y2.Push(ld->v2->y);
+		}
+		BlockCount[block] = LineNums.Size() - start;
+	}
+
+	int count = BlockCount[block];
+	if (count == 0)
+	{
+		return 0;
+	}
+	if ((int)Crossed.Size() < count)
+	{
+		Crossed.Resize(count);
+	}
+	P_ClassifyLines (trace.x, trace.y, trace.dx, trace.dy, &X1[start], &Y1[start],
+		&X2[start], &Y2[start], count, &Crossed[0]);
+	linenums = &LineNums[start];
+	crossed = &Crossed[0];
+	return count;
+}
+
+//===========================================================================
+//
+// FPackedBlockLines :: Clear
+//
+//===========================================================================
+
+void FPackedBlockLines::Clear()
+{
+	for (unsigned i = 0; i < BlocksUsed.Size(); ++i)
+	{
+		BlockStart[BlocksUsed[i]] = -1;
+	}
+	BlocksUsed.Clear();
+	LineNums.Clear();
+	X1.Clear();
+	Y1.Clear();
+	X2.Clear();
+	Y2.Clear();
+}
+
+//===========================================================================
+//
+// P_BeginTraceBatch
+//
+// Traces started between this and P_EndTraceBatch share the packed lines
+// of the blocks they pass through. Only the map's lines are shared, so
+// the world may change between the traces as usual.
+//
+//===========================================================================
+
+void P_BeginTraceBatch()
+{
+	TraceBatchDepth++;
+}
+
+void P_EndTraceBatch()
+{
+	if (TraceBatchDepth > 0 && --TraceBatchDepth == 0)
+	{
+		TracePackedLines.Clear();
+	}
+}
+
 
 //===========================================================================
 //
@@ -951,21 +1163,27 @@ TArray<intercept_t> FPathTraverse::intercepts(128);
 
 void FPathTraverse::AddLineIntercepts(int bx, int by)
 {
-	FBlockLinesIterator it(bx, by, bx, by, true);
+	// avoid precision problems with two routines
+	bool longtrace = trace.dx > FRACUNIT*16
+			 || trace.dy > FRACUNIT*16
+			 || trace.dx < -FRACUNIT*16
+			 || trace.dy < -FRACUNIT*16;
+
+	if (longtrace && TraceBatchDepth > 0 && bx >= 0 && by >= 0 && bx < bmapwidth && by < bmapheight)
+	{
+		AddPackedLineIntercepts(bx, by);
+		return;
+	}
+
+	FBlockLinesIterator it(bx, by, bx, by, true, context);
 	line_t *ld;
 
 	while ((ld = it.Next()))
 	{
 		int 				s1;
 		int 				s2;
-		fixed_t 			frac;
-		divline_t			dl;
 
-		// avoid precision problems with two routines
-		if ( trace.dx > FRACUNIT*16
-			 || trace.dy > FRACUNIT*16
-			 || trace.dx < -FRACUNIT*16
-			 || trace.dy < -FRACUNIT*16)
+		if (longtrace)
 		{
 			s1 = P_PointOnDivlineSide (ld->v1->x, ld->v1->y, &trace);
 			s2 = P_PointOnDivlineSide (ld->v2->x, ld->v2->y, &trace);
@@ -977,21 +1195,111 @@ void FPathTraverse::AddLineIntercepts(int bx, int by)
 		}
 		
 		if (s1 == s2) continue;	// line isn't crossed
+
+		AddLineIntercept(ld);
+	}
+}
+
+//===========================================================================
+//
+// FPathTraverse :: AddPackedLineIntercepts
+//
+// Same as AddLineIntercepts, but takes the lines of the block from the
+// packed copies shared by a trace batch. Only the lines that are crossed
+// are marked as visited, which makes no difference because the others
+// would just be skipped again.
+//
+//===========================================================================
+
+void FPathTraverse::AddPackedLineIntercepts(int bx, int by)
+{
+	int offset = by*bmapwidth + bx;
+	const int *linenums;
+	const BYTE *crossed;
+	int count;
+
+	// Polyobjects can move, so their lines are not in the packed copies.
+	for (polyblock_t *polyLink = PolyBlockMap ? PolyBlockMap[offset] : NULL; polyLink != NULL; polyLink = polyLink->next)
+	{
+		if (polyLink->polyobj != NULL && context->VisitPolyobj(polyLink->polyobj))
+		{
+			for (unsigned i = 0; i < polyLink->polyobj->Linedefs.Size(); i++)
+			{
+				line_t *ld = polyLink->polyobj->Linedefs[i];
+
+				if (context->VisitLine(ld) &&
+					P_PointOnDivlineSide (ld->v1->x, ld->v1->y, &trace) != P_PointOnDivlineSide (ld->v2->x, ld->v2->y, &trace))
+				{
+					AddLineIntercept(ld);
+				}
+			}
+		}
+	}
+
+	count = TracePackedLines.Classify(offset, trace, linenums, crossed);
+	for (int i = 0; i < count; ++i)
+	{
+		if (crossed[i])
+		{
+			line_t *ld = &lines[linenums[i]];
+
+			if (context->VisitLine(ld))
+			{
+				AddLineIntercept(ld);
+			}
+		}
+	}
+}
+
+//===========================================================================
+//
+// FPathTraverse :: AddLineIntercept
+//
+// Adds an intercept for a line that is known to be crossed.
+//
+//===========================================================================
+
+void FPathTraverse::AddLineIntercept(line_t *ld)
+{
+	fixed_t 			frac;
+	divline_t			dl;
+
+	// hit the line
+	P_MakeDivline (ld, &dl);
+	frac = P_InterceptVector (&trace, &dl);
+
+	if (frac < 0) return;	// behind source
 		
-		// hit the line
-		P_MakeDivline (ld, &dl);
-		frac = P_InterceptVector (&trace, &dl);
+	intercept_t newintercept;
 
-		if (frac < 0) continue;	// behind source
-			
-		intercept_t newintercept;
+	newintercept.frac = frac;
+	newintercept.isaline = true;
+	newintercept.done = false;
+	newintercept.d.line = ld;
+	AddIntercept (newintercept);
+}
+
+//===========================================================================
+//
+// FPathTraverse :: AddIntercept
+//
+// Keeps the intercepts that Next() hasn't returned yet sorted by distance.
+// Intercepts at the same distance stay in the order they were found in,
+// so they come out in the same order as with the old linear search.
+//
+//===========================================================================
 
-		newintercept.frac = frac;
-		newintercept.isaline = true;
-		newintercept.done = false;
-		newintercept.d.line = ld;
-		intercepts.Push (newintercept);
+void FPathTraverse::AddIntercept(const intercept_t &in)
+{
+	TArray<intercept_t> &list = *buffer;
+	unsigned int pos = list.Push (in);
+
+	while (pos > next_index && list[pos - 1].frac > in.frac)
+	{
+		list[pos] = list[pos - 1];
+		pos--;
 	}
+	list[pos] = in;
 }
 
 
@@ -1073,7 +1381,7 @@ void FPathTraverse::AddThingIntercepts (int bx, int by, FBlockThingsIterator &it
 						newintercept.isaline = false;
 						newintercept.done = false;
 						newintercept.d.thing = thing;
-						intercepts.Push (newintercept);
+						AddIntercept (newintercept);
 						continue;
 					}
 				}
@@ -1088,7 +1396,7 @@ void FPathTraverse::AddThingIntercepts (int bx, int by, FBlockThingsIterator &it
 				newintercept.isaline = false;
 				newintercept.done = false;
 				newintercept.d.thing = thing;
-				intercepts.Push (newintercept);
+				AddIntercept (newintercept);
 			}
 		}
 		else
@@ -1138,7 +1446,7 @@ void FPathTraverse::AddThingIntercepts (int bx, int by, FBlockThingsIterator &it
 					newintercept.isaline = false;
 					newintercept.done = false;
 					newintercept.d.thing = thing;
-					intercepts.Push (newintercept);
+					AddIntercept (newintercept);
 				}
 			}
 		}
@@ -1154,24 +1462,151 @@ void FPathTraverse::AddThingIntercepts (int bx, int by, FBlockThingsIterator &it
 
 intercept_t *FPathTraverse::Next()
 {
-	intercept_t *in = NULL;
+	TArray<intercept_t> &list = *buffer;
 
-	fixed_t dist = FIXED_MAX;
-	for (unsigned scanpos = intercept_index; scanpos < intercepts.Size (); scanpos++)
+	// A lazy traversal walks on only while the closest intercept found so
+	// far could still be beaten by one in the blocks ahead.
+	while (walking && safefrac <= maxfrac &&
+		(next_index == list.Size() || list[next_index].frac >= safefrac))
 	{
-		intercept_t *scan = &intercepts[scanpos];
-		if (scan->frac < dist && !scan->done)
-		{
-			dist = scan->frac;
-			in = scan;
-		}
+		WalkStep();
 	}
-	
-	if (dist > maxfrac || in == NULL) return NULL;	// checked everything in range			
+
+	if (next_index == list.Size() || list[next_index].frac > maxfrac)
+	{
+		return NULL;	// checked everything in range
+	}
+	intercept_t *in = &list[next_index++];
 	in->done = true;
 	return in;
 }
 
+//===========================================================================
+//
+// FPathTraverse :: WalkStep
+//
+// Collects the intercepts in the current block and moves on to the next.
+//
+//===========================================================================
+
+void FPathTraverse::WalkStep()
+{
+	if (ptflags & PT_ADDLINES)
+	{
+		AddLineIntercepts(mapx, mapy);
+	}
+	
+	if (ptflags & PT_ADDTHINGS)
+	{
+		AddThingIntercepts(mapx, mapy, btit, compatible);
+	}
+			
+	if (mapx == xt2 && mapy == yt2)
+	{
+		walking = false;
+		return;
+	}
+
+	if (ptflags & PT_LAZY)
+	{
+		UpdateSafeFrac();
+	}
+
+	// [RH] Handle corner cases properly instead of pretending they don't exist.
+	switch ((((yintercept >> FRACBITS) == mapy) << 1) | ((xintercept >> FRACBITS) == mapx))
+	{
+	case 0:		// neither xintercept nor yintercept match!
+		count = 100;	// Stop traversing, because somebody screwed up.
+		break;
+
+	case 1:		// xintercept matches
+		xintercept += xstep;
+		mapy += mapystep;
+		break;
+
+	case 2:		// yintercept matches
+		yintercept += ystep;
+		mapx += mapxstep;
+		break;
+
+	case 3:		// xintercept and yintercept both match
+		// The trace is exiting a block through its corner. Not only does the block
+		// being entered need to be checked (which will happen when this loop
+		// continues), but the other two blocks adjacent to the corner also need to
+		// be checked.
+		if (!compatible)
+		{
+			if (ptflags & PT_ADDLINES)
+			{
+				AddLineIntercepts(mapx + mapxstep, mapy);
+				AddLineIntercepts(mapx, mapy + mapystep);
+			}
+			
+			if (ptflags & PT_ADDTHINGS)
+			{
+				AddThingIntercepts(mapx + mapxstep, mapy, btit, false);
+				AddThingIntercepts(mapx, mapy + mapystep, btit, false);
+			}
+			xintercept += xstep;
+			yintercept += ystep;
+			mapx += mapxstep;
+			mapy += mapystep;
+		}
+		else
+		{
+			count = 100; //	Doom originally did not handle this case so do the same in compatibility mode.
+		}
+		break;
+	}
+
+	// Count is present to prevent a round off error
+	// from skipping the break statement.
+	if (++count >= 100)
+	{
+		walking = false;
+	}
+}
+
+//===========================================================================
+//
+// FPathTraverse :: UpdateSafeFrac
+//
+// The walk moves through the columns (or rows, whichever the trace is
+// longer in) of the blockmap in order, so once it has been in one, all
+// the columns before it have been done. A line is listed in every block
+// it passes through, so every intercept up to where the trace enters the
+// current column has been found. Stopping a column earlier than that
+// leaves some room for blockmaps that are off by a bit.
+//
+//===========================================================================
+
+void FPathTraverse::UpdateSafeFrac()
+{
+	double start, delta;
+	int column, step;
+
+	if (abs(trace.dx) >= abs(trace.dy))
+	{
+		column = mapx;
+		step = mapxstep;
+		start = double(trace.x) - bmaporgx;
+		delta = trace.dx;
+	}
+	else
+	{
+		column = mapy;
+		step = mapystep;
+		start = double(trace.y) - bmaporgy;
+		delta = trace.dy;
+	}
+	if (step != 0)
+	{
+		column -= step;
+		double edge = double(step > 0 ? column : column + 1) * MAPBLOCKSIZE;
+		safefrac = MAX(safefrac, (edge - start) / delta * FRACUNIT);
+	}
+}
+
 //===========================================================================
 //
 // FPathTraverse
@@ -1179,30 +1614,19 @@ intercept_t *FPathTraverse::Next()
 //
 //===========================================================================
 
-FPathTraverse::FPathTraverse (fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2, int flags)
+FPathTraverse::FPathTraverse (fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2, int flags, FQueryContext *_context,
+	TArray<intercept_t> *_buffer)
 {
-	fixed_t 	xt1, xt2;
-	fixed_t 	yt1, yt2;
+	fixed_t 	xt1;
+	fixed_t 	yt1;
 	long long	_x1, _x2, _y1, _y2;
 	
-	fixed_t 	xstep;
-	fixed_t 	ystep;
-	
 	fixed_t 	partialx, partialy;
 	
-	fixed_t 	xintercept;
-	fixed_t 	yintercept;
-	
-	int 		mapx;
-	int 		mapy;
-	
-	int 		mapxstep;
-	int 		mapystep;
-
-	int 		count;
-				
-	validcount++;
-	intercept_index = intercepts.Size();
+	buffer = _buffer != NULL ? _buffer : &intercepts;
+	context = _context;
+	context->NewQuery();
+	intercept_index = next_index = buffer->Size();
 		
 	if ( ((x1-bmaporgx)&(MAPBLOCKSIZE-1)) == 0)
 		x1 += FRACUNIT; // don't side exactly on a line
@@ -1312,88 +1736,100 @@ FPathTraverse::FPathTraverse (fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2, in
 	}
 
 	// Step through map blocks.
-	// Count is present to prevent a round off error
-	// from skipping the break statement.
 	mapx = xt1;
 	mapy = yt1;
+	count = 0;
+	walking = true;
+	safefrac = -FLT_MAX;
+	maxfrac = FRACUNIT;
 
-	bool compatible = (flags & PT_COMPATIBLE) && (i_compatflags & COMPATF_HITSCAN);
-		
-	// we want to use one list of checked actors for the entire operation
-	FBlockThingsIterator btit;
-	for (count = 0 ; count < 100 ; count++)
+	compatible = (flags & PT_COMPATIBLE) && (i_compatflags & COMPATF_HITSCAN);
+	if (compatible)
 	{
-		if (flags & PT_ADDLINES)
-		{
-			AddLineIntercepts(mapx, mapy);
-		}
-		
-		if (flags & PT_ADDTHINGS)
-		{
-			AddThingIntercepts(mapx, mapy, btit, compatible);
-		}
-				
-		if (mapx == xt2 && mapy == yt2)
+		// Things are only found in the block their center is in, which
+		// may be far from where the trace hits them.
+		flags &= ~PT_LAZY;
+	}
+	ptflags = flags;
+
+	if (!(flags & PT_LAZY))
+	{
+		while (walking)
 		{
-			break;
+			WalkStep();
 		}
+	}
+}
 
-		// [RH] Handle corner cases properly instead of pretending they don't exist.
-		switch ((((yintercept >> FRACBITS) == mapy) << 1) | ((xintercept >> FRACBITS) == mapx))
-		{
-		case 0:		// neither xintercept nor yintercept match!
-			count = 100;	// Stop traversing, because somebody screwed up.
-			break;
+FPathTraverse::~FPathTraverse()
+{
+	buffer->Resize(intercept_index);
+}
 
-		case 1:		// xintercept matches
-			xintercept += xstep;
-			mapy += mapystep;
-			break;
+//===========================================================================
+//
+// FPathTraverse :: Finish
+//
+// Walks the rest of the blockmap, so that what gets returned from here on
+// is what an eager traversal would have found before the map changed.
+//
+//===========================================================================
 
-		case 2:		// yintercept matches
-			yintercept += ystep;
-			mapx += mapxstep;
-			break;
-
-		case 3:		// xintercept and yintercept both match
-			// The trace is exiting a block through its corner. Not only does the block
-			// being entered need to be checked (which will happen when this loop
-			// continues), but the other two blocks adjacent to the corner also need to
-			// be checked.
-			if (!compatible)
+void FPathTraverse::Finish()
+{
+	while (walking)
+	{
+		WalkStep();
+	}
+}
+
+
+//===========================================================================
+//
+// P_BlocksOccupied
+//
+// Returns true if any block in the given range has things linked into
+// it. Checks one coarse block at a time, so large empty areas are cheap.
+//
+//===========================================================================
+
+bool P_BlocksOccupied (int x1, int y1, int x2, int y2)
+{
+	x1 = MAX (x1, 0);
+	y1 = MAX (y1, 0);
+	x2 = MIN (x2, bmapwidth - 1);
+	y2 = MIN (y2, bmapheight - 1);
+
+	for (int cy = y1 >> COARSEBLOCKSHIFT; cy <= y2 >> COARSEBLOCKSHIFT; ++cy)
+	{
+		int by = cy << COARSEBLOCKSHIFT;
+		int ly = MAX (y1 - by, 0);
+		int hy = MIN (y2 - by, COARSEBLOCKMASK);
+
+		for (int cx = x1 >> COARSEBLOCKSHIFT; cx <= x2 >> COARSEBLOCKSHIFT; ++cx)
+		{
+			QWORD mask = coarseblocks[cy*coarsebmapwidth + cx];
+
+			if (mask != 0)
 			{
-				if (flags & PT_ADDLINES)
-				{
-					AddLineIntercepts(mapx + mapxstep, mapy);
-					AddLineIntercepts(mapx, mapy + mapystep);
-				}
-				
-				if (flags & PT_ADDTHINGS)
+				int bx = cx << COARSEBLOCKSHIFT;
+				int lx = MAX (x1 - bx, 0);
+				int hx = MIN (x2 - bx, COARSEBLOCKMASK);
+				QWORD rowbits = (0xFF << lx) & (0xFF >> (COARSEBLOCKMASK - hx));
+
+				for (int y = ly; y <= hy; ++y)
 				{
-					AddThingIntercepts(mapx + mapxstep, mapy, btit, false);
-					AddThingIntercepts(mapx, mapy + mapystep, btit, false);
+					if ((mask >> (y << COARSEBLOCKSHIFT)) & rowbits)
+					{
+						return true;
+					}
 				}
-				xintercept += xstep;
-				yintercept += ystep;
-				mapx += mapxstep;
-				mapy += mapystep;
 			}
-			else
-			{
-				count = 100; //	Doom originally did not handle this case so do the same in compatibility mode.
-			}
-			break;
 		}
 	}
-	maxfrac = FRACUNIT;
+	return false;
 }
 
-FPathTraverse::~FPathTraverse()
-{
-	intercepts.Resize(intercept_index);
-}
-
-
 //===========================================================================
 //
 // P_RoughMonsterSearch
@@ -1422,7 +1858,6 @@ AActor *P_BlockmapSearch (AActor *mo, int distance, AActor *(*check)(AActor*, in
 
 	startX = GetSafeBlockX(mo->x-bmaporgx);
 	startY = GetSafeBlockY(mo->y-bmaporgy);
-	validcount++;
 	
 	if (startX >= 0 && startX < bmapwidth && startY >= 0 && startY < bmapheight)
 	{
@@ -1455,6 +1890,15 @@ AActor *P_BlockmapSearch (AActor *mo, int distance, AActor *(*check)(AActor*, in
 		{
 			secondStop = bmapheight-1;
 		}
+
+		// Don't trace the ring if there are no things in any of its blocks
+		if (!P_BlocksOccupied (blockX, blockY, firstStop, blockY) &&
+			!P_BlocksOccupied (blockX, secondStop, firstStop, secondStop) &&
+			!P_BlocksOccupied (blockX, blockY, blockX, secondStop) &&
+			!P_BlocksOccupied (firstStop, blockY, firstStop, secondStop))
+		{
+			continue;
+		}
 		thirdStop = secondStop*bmapwidth+blockX;
 		secondStop = secondStop*bmapwidth+firstStop;
 		firstStop += blockY*bmapwidth;
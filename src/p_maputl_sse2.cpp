@@ -0,0 +1,76 @@
+#ifndef DISABLE_SSE
+
+#include <emmintrin.h>
+#include "doomtype.h"
+#include "m_fixed.h"
+
+// SSE2 version of P_ClassifyLines in p_maputl.cpp. This file is
+// explicitly compiled with SSE2 enabled, but the other files are not.
+//
+// The side tests are done with doubles, which are exact enough to decide
+// everything that isn't right next to the trace. Those few get the exact
+// fixed point test, so the results are identical to the C version.
+
+#define SIDE_SPLIT	4294967296.		// DMulScale32(...) > 0 means the sum is >= 1<<32
+#define SIDE_MARGIN	65536.			// much larger than the rounding error of the doubles
+
+static inline int ExactSide (fixed_t x, fixed_t y, fixed_t tx, fixed_t ty, fixed_t tdx, fixed_t tdy)
+{
+	return DMulScale32 (y - ty, tdx, tx - x, tdy) > 0;
+}
+
+static inline int Sides4 (__m128i x, __m128i y, __m128i tx, __m128i ty, __m128d tdx, __m128d tdy, int &unsure)
+{
+	const __m128d split = _mm_set1_pd (SIDE_SPLIT);
+	const __m128d hi = _mm_set1_pd (SIDE_MARGIN);
+	const __m128d lo = _mm_set1_pd (-SIDE_MARGIN);
+
+	// Integer subtraction first, so that overflows wrap like they do
+	// in the fixed point version.
+	__m128i a = _mm_sub_epi32 (y, ty);
+	__m128i c = _mm_sub_epi32 (tx, x);
+
+	__m128d s0 = _mm_sub_pd (_mm_add_pd (_mm_mul_pd (_mm_cvtepi32_pd (a), tdx),
+		_mm_mul_pd (_mm_cvtepi32_pd (c), tdy)), split);
+	a = _mm_shuffle_epi32 (a, _MM_SHUFFLE(1,0,3,2));
+	c = _mm_shuffle_epi32 (c, _MM_SHUFFLE(1,0,3,2));
+	__m128d s1 = _mm_sub_pd (_mm_add_pd (_mm_mul_pd (_mm_cvtepi32_pd (a), tdx),
+		_mm_mul_pd (_mm_cvtepi32_pd (c), tdy)), split);
+
+	int front = _mm_movemask_pd (_mm_cmpgt_pd (s0, hi)) | (_mm_movemask_pd (_mm_cmpgt_pd (s1, hi)) << 2);
+	int back = _mm_movemask_pd (_mm_cmplt_pd (s0, lo)) | (_mm_movemask_pd (_mm_cmplt_pd (s1, lo)) << 2);
+	unsure = ~(front | back) & 15;
+	return front;
+}
+
+void P_ClassifyLinesSSE2 (fixed_t tx, fixed_t ty, fixed_t tdx, fixed_t tdy,
+	const fixed_t *x1, const fixed_t *y1, const fixed_t *x2, const fixed_t *y2, int count, BYTE *crossed)
+{
+	__m128i vtx = _mm_set1_epi32 (tx);
+	__m128i vty = _mm_set1_epi32 (ty);
+	__m128d vtdx = _mm_set1_pd (double(tdx));
+	__m128d vtdy = _mm_set1_pd (double(tdy));
+	int i;
+
+	for (i = 0; i + 4 <= count; i += 4)
+	{
+		int unsure1, unsure2;
+		int side1 = Sides4 (_mm_loadu_si128 ((const __m128i *)&x1[i]), _mm_loadu_si128 ((const __m128i *)&y1[i]),
+			vtx, vty, vtdx, vtdy, unsure1);
+		int side2 = Sides4 (_mm_loadu_si128 ((const __m128i *)&x2[i]), _mm_loadu_si128 ((const __m128i *)&y2[i]),
+			vtx, vty, vtdx, vtdy, unsure2);
+
+		for (int j = 0; j < 4; ++j)
+		{
+			int s1 = (unsure1 & (1 << j)) ? ExactSide (x1[i+j], y1[i+j], tx, ty, tdx, tdy) : (side1 >> j) & 1;
+			int s2 = (unsure2 & (1 << j)) ? ExactSide (x2[i+j], y2[i+j], tx, ty, tdx, tdy) : (side2 >> j) & 1;
+			crossed[i+j] = s1 != s2;
+		}
+	}
+	for (; i < count; ++i)
+	{
+		crossed[i] = ExactSide (x1[i], y1[i], tx, ty, tdx, tdy) != ExactSide (x2[i], y2[i], tx, ty, tdx, tdy);
+	}
+}
+
+#endif
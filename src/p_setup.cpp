@@ -70,6 +70,7 @@
 #include "r_data/colormaps.h"
 
 #include "fragglescript/t_fs.h"
+#include "w_prefetch.h"
 
 #define MISSING_TEXTURE_WARN_LIMIT		20
 
@@ -170,6 +171,9 @@ int				bmapnegx;		// min negs of block map before wrapping
 int				bmapnegy;
 
 FBlockNode**	blocklinks;		// for thing chains
+QWORD*			coarseblocks;	// which blocks of each coarse block have thing chains
+int				coarsebmapwidth;
+int				coarsebmapheight;
 
 
 // REJECT
@@ -244,6 +248,50 @@ static int GetMapIndex(const char *mapname, int lastindex, const char *lumpname,
 	return -1;	// End of map reached
 }
 
+//===========================================================================
+//
+// P_PrefetchMapData
+//
+// Gives the prefetch threads the lumps P_OpenMapData is about to read so
+// that a map packed into a Zip is already unpacked while the previous
+// level is being torn down. Uses the same lookup as P_OpenMapData.
+//
+//===========================================================================
+
+static void P_PrefetchMapData(const char *mapname)
+{
+	TArray<int> lumps;
+	FString fmt;
+	int lump_name = -1;
+
+	if (!strnicmp(mapname, "file:", 5))
+	{
+		return;
+	}
+	if (strlen(mapname) <= 8) lump_name = Wads.CheckNumForName(mapname);
+	fmt.Format("maps/%s.wad", mapname);
+	int lump_wad = Wads.CheckNumForFullName(fmt);
+	fmt.Format("maps/%s.map", mapname);
+	int lump_map = Wads.CheckNumForFullName(fmt);
+
+	if (lump_name > lump_wad && lump_name > lump_map && lump_name != -1)
+	{
+		int lumpfile = Wads.GetLumpFile(lump_name);
+
+		lumps.Push(lump_name);
+		for (int i = lump_name + 1; i < Wads.GetNumLumps() && Wads.GetLumpFile(i) == lumpfile; i++)
+		{
+			lumps.Push(i);
+			if (Wads.CheckLumpName(i, "ENDMAP") || lumps.Size() > ML_MAX + 4) break;
+		}
+	}
+	else
+	{
+		lumps.Push(lump_wad > lump_map ? lump_wad : lump_map);
+	}
+	W_PrefetchLumps(lumps);
+}
+
 //===========================================================================
 //
 // Opens a map for reading
@@ -3042,6 +3090,12 @@ void P_LoadBlockMap (MapData * map)
 	blocklinks = new FBlockNode *[count];
 	memset (blocklinks, 0, count*sizeof(*blocklinks));
 	blockmap = blockmaplump+4;
+
+	coarsebmapwidth = (bmapwidth + COARSEBLOCKMASK) >> COARSEBLOCKSHIFT;
+	coarsebmapheight = (bmapheight + COARSEBLOCKMASK) >> COARSEBLOCKSHIFT;
+	count = coarsebmapwidth*coarsebmapheight;
+	coarseblocks = new QWORD[count];
+	memset (coarseblocks, 0, count*sizeof(*coarseblocks));
 }
 
 
@@ -3466,6 +3520,11 @@ void P_FreeLevelData ()
 		delete[] blocklinks;
 		blocklinks = NULL;
 	}
+	if (coarseblocks != NULL)
+	{
+		delete[] coarseblocks;
+		coarseblocks = NULL;
+	}
 	if (PolyBlockMap != NULL)
 	{
 		for (int i = bmapwidth*bmapheight-1; i >= 0; --i)
@@ -3503,6 +3562,11 @@ void P_FreeLevelData ()
 		zones = NULL;
 	}
 	numzones = 0;
+	// All actors are gone now, so the next level can start filling the
+	// node pools from the front again. Skipped if a travelling player's
+	// sector list is still holding on to some nodes.
+	BlockNodePool.Reset();
+	SecnodePool.Reset();
 	P_FreeStrifeConversations ();
 	if (level.Scrolls != NULL)
 	{
@@ -3512,34 +3576,22 @@ void P_FreeLevelData ()
 	P_ClearUDMFKeys();
 }
 
-extern msecnode_t *headsecnode;
-
 void P_FreeExtraLevelData()
 {
 	// Free all blocknodes and msecnodes.
 	// *NEVER* call this function without calling
 	// P_FreeLevelData() first, or they might not all be freed.
-	{
-		FBlockNode *node = FBlockNode::FreeBlocks;
-		while (node != NULL)
-		{
-			FBlockNode *next = node->NextBlock;
-			delete node;
-			node = next;
-		}
-		FBlockNode::FreeBlocks = NULL;
-	}
-	{
-		msecnode_t *node = headsecnode;
+	BlockNodePool.FreeAll();
+	SecnodePool.FreeAll();
+}
 
-		while (node != NULL)
-		{
-			msecnode_t *next = node->m_snext;
-			M_Free (node);
-			node = next;
-		}
-		headsecnode = NULL;
-	}
+ADD_STAT (nodepools)
+{
+	FString out;
+	out.Format ("blocknodes %d (peak %d, pool %d)  secnodes %d (peak %d, pool %d)",
+		BlockNodePool.LiveCount(), BlockNodePool.PeakCount(), BlockNodePool.Capacity(),
+		SecnodePool.LiveCount(), SecnodePool.PeakCount(), SecnodePool.Capacity());
+	return out;
 }
 
 //
@@ -3565,6 +3617,8 @@ void P_SetupLevel (const char *lumpname, int position)
 		times[i].Reset();
 	}
 
+	P_PrefetchMapData(lumpname);
+
 	level.maptype = MAPTYPE_UNKNOWN;
 	wminfo.partime = 180;
 
@@ -3971,6 +4025,7 @@ void P_SetupLevel (const char *lumpname, int position)
 
 	times[13].Clock();
 	P_FloodZones ();
+	P_ClearSightMemo ();
 	times[13].Unclock();
 
 	if (hasglnodes)
@@ -4022,6 +4077,7 @@ void P_SetupLevel (const char *lumpname, int position)
 		delete[] buildthings;
 	}
 	delete map;
+	W_StopPrefetch();
 	if (oldvertextable != NULL)
 	{
 		delete[] oldvertextable;
@@ -39,8 +39,8 @@ This uses specialized forms of the maputils routines for optimized performance
 */
 
 // Performance meters
-static int sightcounts[6];
-static cycle_t SightCycles;
+static int sightcounts[8];
+cycle_t SightCycles;
 static cycle_t MaxSightCycles;
 
 static TArray<intercept_t> intercepts (128);
@@ -57,6 +57,7 @@ class SightCheck
 	int Flags;
 	divline_t trace;
 	int myseethrough;
+	FQueryContext *Context;
 
 	bool PTR_SightTraverse (intercept_t *in);
 	bool P_SightCheckLine (line_t *ld);
@@ -66,8 +67,9 @@ class SightCheck
 public:
 	bool P_SightPathTraverse (fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2);
 
-	SightCheck(const AActor * t1, const AActor * t2, int flags)
+	SightCheck(const AActor * t1, const AActor * t2, int flags, FQueryContext *context = &MainQueryContext)
 	{
+		Context = context;
 		lastztop = lastzbottom = sightzstart = t1->z + t1->height - (t1->height>>2);
 		lastsector = t1->Sector;
 		sightthing=t1;
@@ -238,11 +240,10 @@ bool SightCheck::P_SightCheckLine (line_t *ld)
 {
 	divline_t dl;
 
-	if (ld->validcount == validcount)
+	if (!Context->VisitLine (ld))
 	{
 		return true;
 	}
-	ld->validcount = validcount;
 	if (P_PointOnDivlineSide (ld->v1->x, ld->v1->y, &trace) ==
 		P_PointOnDivlineSide (ld->v2->x, ld->v2->y, &trace))
 	{
@@ -321,9 +322,8 @@ bool SightCheck::P_SightBlockLinesIterator (int x, int y)
 	{
 		if (polyLink->polyobj)
 		{ // only check non-empty links
-			if (polyLink->polyobj->validcount != validcount)
+			if (Context->VisitPolyobj (polyLink->polyobj))
 			{
-				polyLink->polyobj->validcount = validcount;
 				for (i = 0; i < polyLink->polyobj->Linedefs.Size(); i++)
 				{
 					if (!P_SightCheckLine (polyLink->polyobj->Linedefs[i]))
@@ -450,7 +450,7 @@ bool SightCheck::P_SightPathTraverse (fixed_t x1, fixed_t y1, fixed_t x2, fixed_
 	int mapx, mapy, mapxstep, mapystep;
 	int count;
 
-	validcount++;
+	Context->NewQuery ();
 	intercepts.Clear ();
 
 #ifdef _3DFLOORS
@@ -637,6 +637,50 @@ sightcounts[2]++;
 	return P_SightTraverseIntercepts ( );
 }
 
+//==========================================================================
+//
+// Sight memo
+//
+// Remembers the results of the last traces so that repeated checks for
+// the same pair at the same positions don't walk the blockmap again. It is
+// cleared at the start of every tic and after anything that changes what
+// blocks sight: executed specials, moving floors and ceilings (through
+// P_ChangeSector), polyobjects, and line flags, activations and specials
+// set by scripts.
+//
+//==========================================================================
+
+struct FSightMemo
+{
+	const AActor *t1, *t2;
+	fixed_t x1, y1, z1, height1;
+	fixed_t x2, y2, z2, height2;
+	int flags;
+	int stamp;
+	bool result;
+};
+
+enum { SIGHTMEMO_SIZE = 256 };
+
+static FSightMemo SightMemo[SIGHTMEMO_SIZE];
+static int SightMemoStamp = 1;
+
+void P_ClearSightMemo ()
+{
+	SightMemoStamp++;
+}
+
+static FSightMemo *P_FindSightMemo (const AActor *t1, const AActor *t2, int flags, bool &found)
+{
+	size_t hash = ((size_t)t1 >> 4) ^ ((size_t)t2 >> 2) ^ (size_t)flags;
+	FSightMemo *memo = &SightMemo[(hash ^ (hash >> 8)) % SIGHTMEMO_SIZE];
+
+	found = memo->stamp == SightMemoStamp && memo->t1 == t1 && memo->t2 == t2 && memo->flags == flags &&
+		memo->x1 == t1->x && memo->y1 == t1->y && memo->z1 == t1->z && memo->height1 == t1->height &&
+		memo->x2 == t2->x && memo->y2 == t2->y && memo->z2 == t2->z && memo->height2 == t2->height;
+	return memo;
+}
+
 /*
 =====================
 =
@@ -716,10 +760,36 @@ sightcounts[0]++;
 	// An unobstructed LOS is possible.
 	// Now look from eyes of t1 to any part of t2.
 
-	validcount++;
 	{
-		SightCheck s(t1, t2, flags);
-		res = s.P_SightPathTraverse (t1->x, t1->y, t2->x, t2->y);
+		bool found;
+		FSightMemo *memo = P_FindSightMemo(t1, t2, flags, found);
+
+		if (found)
+		{
+sightcounts[6]++;
+			res = memo->result;
+			goto done;
+		}
+sightcounts[7]++;
+
+		{
+			SightCheck s(t1, t2, flags);
+			res = s.P_SightPathTraverse (t1->x, t1->y, t2->x, t2->y);
+		}
+
+		memo->t1 = t1;
+		memo->t2 = t2;
+		memo->flags = flags;
+		memo->x1 = t1->x;
+		memo->y1 = t1->y;
+		memo->z1 = t1->z;
+		memo->height1 = t1->height;
+		memo->x2 = t2->x;
+		memo->y2 = t2->y;
+		memo->z2 = t2->z;
+		memo->height2 = t2->height;
+		memo->stamp = SightMemoStamp;
+		memo->result = res;
 	}
 
 done:
@@ -730,9 +800,10 @@ done:
 ADD_STAT (sight)
 {
 	FString out;
-	out.Format ("%04.1f ms (%04.1f max), %5d %2d%4d%4d%4d%4d\n",
+	out.Format ("%04.1f ms (%04.1f max), %5d %2d%4d%4d%4d%4d, memo %d/%d\n",
 		SightCycles.TimeMS(), MaxSightCycles.TimeMS(),
-		sightcounts[3], sightcounts[0], sightcounts[1], sightcounts[2], sightcounts[4], sightcounts[5]);
+		sightcounts[3], sightcounts[0], sightcounts[1], sightcounts[2], sightcounts[4], sightcounts[5],
+		sightcounts[6], sightcounts[6] + sightcounts[7]);
 	return out;
 }
 
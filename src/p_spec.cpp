@@ -249,6 +249,7 @@ bool P_ActivateLine (line_t *line, AActor *mo, int side, int activationType)
 	if (!repeat && buttonSuccess)
 	{ // clear the special on non-retriggerable lines
 		line->special = 0;
+		P_ClearSightMemo ();
 	}
 
 	if (buttonSuccess)
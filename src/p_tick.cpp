@@ -32,6 +32,7 @@
 #include "r_data/r_interpolate.h"
 #include "i_sound.h"
 #include "g_level.h"
+#include "g_benchmark.h"
 
 extern gamestate_t wipegamestate;
 
@@ -84,6 +85,11 @@ void P_Ticker (void)
 	if (paused || P_CheckTickerPaused())
 		return;
 
+	if (benchmarking)
+	{
+		G_BenchmarkTicStart ();
+	}
+
 	P_NewPspriteTick();
 
 	// [RH] Frozen mode is only changed every 4 tics, to make it work with A_Tracer().
@@ -109,6 +115,7 @@ void P_Ticker (void)
 		S_ResumeSound (false);
 
 	P_ResetSightCounters (false);
+	P_ClearSightMemo ();	// sight results are only kept for one tic
 
 	// Since things will be moving, it's okay to interpolate them in the renderer.
 	r_NoInterpolate = false;
@@ -138,4 +145,9 @@ void P_Ticker (void)
 	level.time++;
 	level.maptime++;
 	level.totaltime++;
+
+	if (benchmarking)
+	{
+		G_BenchmarkTicEnd ();
+	}
 }
@@ -60,6 +60,7 @@ struct FTraceInfo
 	int sectorsel;		
 
 	bool TraceTraverse (int ptflags);
+	void ActivateLine (FPathTraverse &it, line_t *line, int lineside, int activation);
 	bool CheckPlane(const secplane_t &plane);
 	bool CheckSectorPlane (const sector_t *sector, bool checkFloor);
 	bool Check3DFloorPlane(const F3DFloor *ffloor, bool checkBottom);
@@ -77,7 +78,9 @@ bool Trace (fixed_t x, fixed_t y, fixed_t z, sector_t *sector,
 	int ptflags;
 	FTraceInfo inf;
 
-	ptflags = actorMask ? PT_ADDLINES|PT_ADDTHINGS|PT_COMPATIBLE : PT_ADDLINES;
+	// The trace only needs to look as far ahead as the closest hit.
+	// ActivateLine finishes the walk before a special can change the map.
+	ptflags = actorMask ? PT_ADDLINES|PT_ADDTHINGS|PT_COMPATIBLE|PT_LAZY : PT_ADDLINES|PT_LAZY;
 
 	inf.StartX = x;
 	inf.StartY = y;
@@ -246,9 +249,30 @@ bool Trace (fixed_t x, fixed_t y, fixed_t z, sector_t *sector,
 	}
 }
 
+//==========================================================================
+//
+// FTraceInfo :: ActivateLine
+//
+// The special may change the map, so the rest of the intercepts have to
+// be collected first, the same as the eager walk used to do.
+//
+//==========================================================================
+
+void FTraceInfo::ActivateLine (FPathTraverse &it, line_t *line, int lineside, int activation)
+{
+	if (P_TestActivateLine (line, IgnoreThis, lineside, activation))
+	{
+		it.Finish ();
+		P_ActivateLine (line, IgnoreThis, lineside, activation);
+	}
+}
+
 bool FTraceInfo::TraceTraverse (int ptflags)
 {
-	FPathTraverse it(StartX, StartY, FixedMul (Vx, MaxDist), FixedMul (Vy, MaxDist), ptflags | PT_DELTA);
+	static TArray<intercept_t> TraceIntercepts (128);
+
+	FPathTraverse it(StartX, StartY, FixedMul (Vx, MaxDist), FixedMul (Vy, MaxDist), ptflags | PT_DELTA,
+		&MainQueryContext, &TraceIntercepts);
 	intercept_t *in;
 
 	while ((in = it.Next()))
@@ -326,11 +350,11 @@ bool FTraceInfo::TraceTraverse (int ptflags)
 					// We must check special activation here because the code below is never reached.
 					if (TraceFlags & TRACE_PCross)
 					{
-						P_ActivateLine (in->d.line, IgnoreThis, lineside, SPAC_PCross);
+						ActivateLine (it, in->d.line, lineside, SPAC_PCross);
 					}
 					if (TraceFlags & TRACE_Impact)
 					{
-						P_ActivateLine (in->d.line, IgnoreThis, lineside, SPAC_Impact);
+						ActivateLine (it, in->d.line, lineside, SPAC_Impact);
 					}
 					continue;
 				}
@@ -376,7 +400,7 @@ bool FTraceInfo::TraceTraverse (int ptflags)
 					hitz >= bc ? TIER_Upper : TIER_Middle;
 				if (TraceFlags & TRACE_Impact)
 				{
-					P_ActivateLine (in->d.line, IgnoreThis, lineside, SPAC_Impact);
+					ActivateLine (it, in->d.line, lineside, SPAC_Impact);
 				}
 			}
 			else
@@ -428,7 +452,7 @@ bool FTraceInfo::TraceTraverse (int ptflags)
 								Results->ffloor = rover;
 								if ((TraceFlags & TRACE_Impact) && in->d.line->special)
 								{
-									P_ActivateLine (in->d.line, IgnoreThis, lineside, SPAC_Impact);
+									ActivateLine (it, in->d.line, lineside, SPAC_Impact);
 								}
 								goto cont;
 							}
@@ -442,12 +466,12 @@ bool FTraceInfo::TraceTraverse (int ptflags)
 				Results->HitType = TRACE_HitNone;
 				if (TraceFlags & TRACE_PCross)
 				{
-					P_ActivateLine (in->d.line, IgnoreThis, lineside, SPAC_PCross);
+					ActivateLine (it, in->d.line, lineside, SPAC_PCross);
 				}
 				if (TraceFlags & TRACE_Impact)
 				{ // This is incorrect for "impact", but Hexen did this, so
 				  // we need to as well, for compatibility
-					P_ActivateLine (in->d.line, IgnoreThis, lineside, SPAC_Impact);
+					ActivateLine (it, in->d.line, lineside, SPAC_Impact);
 				}
 			}
 #ifdef _3DFLOORS
@@ -483,7 +507,7 @@ cont:
 					}
 					if (Results->HitType == TRACE_HitWall && TraceFlags & TRACE_Impact)
 					{
-						P_ActivateLine (in->d.line, IgnoreThis, lineside, SPAC_Impact);
+						ActivateLine (it, in->d.line, lineside, SPAC_Impact);
 					}
 				}
 
@@ -2890,7 +2890,8 @@ void P_UnPredictPlayer ()
 			}
 		}
 
-		// Now fix the pointers in the blocknode chain
+		// Now fix the pointers in the blocknode chain. Unlinking the predicted
+		// position may have cleared the coarse bits of these blocks.
 		FBlockNode *block = act->BlockNode;
 
 		while (block != NULL)
@@ -2900,6 +2901,9 @@ void P_UnPredictPlayer ()
 			{
 				block->NextActor->PrevActor = &block->NextActor;
 			}
+			int x = block->BlockIndex % bmapwidth;
+			int y = block->BlockIndex / bmapwidth;
+			P_CoarseBlock (x, y) |= P_CoarseBlockBit (x, y);
 			block = block->NextBlock;
 		}
 
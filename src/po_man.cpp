@@ -1276,6 +1276,8 @@ void FPolyObj::LinkPolyobj ()
 	polyblock_t **link;
 	polyblock_t *tempLink;
 
+	P_ClearSightMemo ();
+
 	// calculate the polyobj bbox
 	Bounds.ClearBox();
 	for(unsigned i = 0; i < Sidedefs.Size(); i++)
@@ -2429,6 +2429,9 @@ ADD_STAT(blit)
 
 IVideo *Video;
 
+IVideo *V_CreateNullVideo();
+FRenderer *G_CreateNullRenderer();
+
 
 void I_ShutdownGraphics ()
 {
@@ -2450,7 +2453,8 @@ void I_InitGraphics ()
 	val.Bool = !!Args->CheckParm ("-devparm");
 	ticker.SetGenericRepDefault (val, CVAR_Bool);
 
-	Video = new CocoaVideo (0);
+	if (Args->CheckParm ("-benchmark")) Video = V_CreateNullVideo();
+	else Video = new CocoaVideo (0);
 	if (Video == NULL)
 		I_FatalError ("Failed to initialize display");
 
@@ -2466,7 +2470,8 @@ void I_CreateRenderer()
 {
 	if (Renderer == NULL)
 	{
-		Renderer = new FSoftwareRenderer;
+		if (Args->CheckParm ("-benchmark")) Renderer = G_CreateNullRenderer();
+		else Renderer = new FSoftwareRenderer;
 		atterm(I_DeleteRenderer);
 	}
 }
@@ -60,6 +60,8 @@ IVideo *Video;
 extern int NewWidth, NewHeight, NewBits, DisplayBits;
 bool V_DoModeSetup (int width, int height, int bits);
 void I_RestartRenderer();
+IVideo *V_CreateNullVideo();
+FRenderer *G_CreateNullRenderer();
 
 int currentrenderer;
 
@@ -109,7 +111,8 @@ void I_InitGraphics ()
 	ticker.SetGenericRepDefault (val, CVAR_Bool);
 	
 	//currentrenderer = vid_renderer;
-	if (currentrenderer==1) Video = new SDLGLVideo(0);
+	if (Args->CheckParm ("-benchmark")) Video = V_CreateNullVideo();
+	else if (currentrenderer==1) Video = new SDLGLVideo(0);
 	else Video = new SDLVideo (0);
 	
 	if (Video == NULL)
@@ -130,7 +133,8 @@ void I_CreateRenderer()
 	currentrenderer = vid_renderer;
 	if (Renderer == NULL)
 	{
-		if (currentrenderer==1) Renderer = gl_CreateInterface();
+		if (Args->CheckParm ("-benchmark")) Renderer = G_CreateNullRenderer();
+		else if (currentrenderer==1) Renderer = gl_CreateInterface();
 		else Renderer = new FSoftwareRenderer;
 		atterm(I_DeleteRenderer);
 	}
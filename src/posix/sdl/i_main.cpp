@@ -265,14 +265,28 @@ int main (int argc, char **argv)
 	
 	setlocale (LC_ALL, "C");
 
-	if (SDL_Init (SDL_INIT_VIDEO|SDL_INIT_TIMER|SDL_INIT_NOPARACHUTE|SDL_INIT_JOYSTICK) == -1)
+	// A headless benchmark must run without a display, so SDL's video
+	// subsystem is not started for it.
+	Uint32 sdlflags = SDL_INIT_VIDEO|SDL_INIT_TIMER|SDL_INIT_NOPARACHUTE|SDL_INIT_JOYSTICK;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (stricmp (argv[i], "-benchmark") == 0)
+		{
+			sdlflags &= ~SDL_INIT_VIDEO;
+		}
+	}
+
+	if (SDL_Init (sdlflags) == -1)
 	{
 		fprintf (stderr, "Could not initialize SDL:\n%s\n", SDL_GetError());
 		return -1;
 	}
 	atterm (SDL_Quit);
 
-	printf("Using video driver %s\n", SDL_GetCurrentVideoDriver());
+	if (sdlflags & SDL_INIT_VIDEO)
+	{
+		printf("Using video driver %s\n", SDL_GetCurrentVideoDriver());
+	}
 	printf("\n");
 	
     try
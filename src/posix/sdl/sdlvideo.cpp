@@ -12,6 +12,7 @@
 #include "v_palette.h"
 #include "sdlvideo.h"
 #include "r_swrenderer.h"
+#include "r_drawbgra.h"
 #include "version.h"
 
 #include <SDL.h>
@@ -46,6 +47,7 @@ public:
 	void SetFullscreen (bool fullscreen);
 	int GetPageCount ();
 	bool IsFullscreen ();
+	bool CanPresentTrueColor ();
 
 	friend class SDLVideo;
 
@@ -72,6 +74,7 @@ private:
 	bool NeedPalUpdate;
 	bool NeedGammaUpdate;
 	bool NotPaletted;
+	bool TrueColorFormat;	// The output is 32-bit 0x00RRGGBB
 
 	void UpdateColors ();
 	void ResetSDLRenderer ();
@@ -348,6 +351,7 @@ SDLFB::SDLFB (int width, int height, bool fullscreen)
 	NeedGammaUpdate = false;
 	UpdatePending = false;
 	NotPaletted = false;
+	TrueColorFormat = false;
 	FlashAmount = 0;
 
 	FString caption;
@@ -476,6 +480,11 @@ void SDLFB::Update ()
 		GPfx.Convert (MemBuffer, Pitch,
 			pixels, pitch, Width, Height,
 			FRACUNIT, FRACUNIT, 0, 0);
+		if (TrueColorFormat)
+		{
+			R_PresentTrueColorView (MemBuffer, Pitch, (DWORD *)pixels, pitch,
+				GammaTable, Flash, FlashAmount);
+		}
 	}
 	else
 	{
@@ -627,6 +636,11 @@ bool SDLFB::IsFullscreen ()
 	return (SDL_GetWindowFlags (Screen) & SDL_WINDOW_FULLSCREEN_DESKTOP) != 0;
 }
 
+bool SDLFB::CanPresentTrueColor ()
+{
+	return NotPaletted && TrueColorFormat;
+}
+
 void SDLFB::ResetSDLRenderer ()
 {
 	if (Renderer)
@@ -665,6 +679,7 @@ void SDLFB::ResetSDLRenderer ()
 			int bpp;
 			SDL_PixelFormatEnumToMasks(format, &bpp, &Rmask, &Gmask, &Bmask, &Amask);
 			GPfx.SetFormat (bpp, Rmask, Gmask, Bmask);
+			TrueColorFormat = (bpp == 32 && Rmask == 0xFF0000 && Gmask == 0xFF00 && Bmask == 0xFF);
 		}
 	}
 	else
@@ -675,9 +690,14 @@ void SDLFB::ResetSDLRenderer ()
 		{
 			NotPaletted = true;
 			GPfx.SetFormat (Surface->format->BitsPerPixel, Surface->format->Rmask, Surface->format->Gmask, Surface->format->Bmask);
+			TrueColorFormat = (Surface->format->BitsPerPixel == 32 && Surface->format->Rmask == 0xFF0000 &&
+				Surface->format->Gmask == 0xFF00 && Surface->format->Bmask == 0xFF);
 		}
 		else
+		{
 			NotPaletted = false;
+			TrueColorFormat = false;
+		}
 	}
 
 	// Calculate update rectangle
@@ -53,9 +53,22 @@
 #include "templates.h"
 #include "r_utility.h"
 #include "r_renderer.h"
+#include "c_cvars.h"
+#include "stats.h"
 
 static bool R_CheckForFixedLights(const BYTE *colormaps);
 
+// Light tables for colormaps made by GetSpecialLights are built when they
+// are first drawn with. Once they take up more than this many kilobytes,
+// the ones that have gone unused the longest are freed between frames.
+CUSTOM_CVAR (Int, r_colormapcache, 2048, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+{
+	if (self < 0)
+	{
+		self = 0;
+	}
+}
+
 
 extern "C" {
 FDynamicColormap NormalLight;
@@ -105,6 +118,13 @@ static FSpecialColormapParameters SpecialColormapParms[] =
 
 static void FreeSpecialLights();
 
+#define COLORMAP_HASH_SIZE	256
+
+int FDynamicColormap::DynamicColormapFrame;
+static FDynamicColormap *ColormapHash[COLORMAP_HASH_SIZE];
+static size_t ColormapBytes;
+static int ColormapBuilds, ColormapHits, ColormapEvictions;
+
 
 
 //==========================================================================
@@ -183,36 +203,51 @@ int AddSpecialColormap(float r1, float g1, float b1, float r2, float g2, float b
 //
 //==========================================================================
 
+static inline unsigned ColormapHashKey (PalEntry color, PalEntry fade, int desaturate)
+{
+	return ((DWORD(color) * 31 + DWORD(fade)) * 31 + desaturate) % COLORMAP_HASH_SIZE;
+}
+
 FDynamicColormap *GetSpecialLights (PalEntry color, PalEntry fade, int desaturate)
 {
 	FDynamicColormap *colormap;
 
+	// NormalLight changes with the level's fade, so it is not in the hash.
+	if (color == NormalLight.Color &&
+		fade == NormalLight.Fade &&
+		desaturate == NormalLight.Desaturate)
+	{
+		ColormapHits++;
+		return &NormalLight;
+	}
+
 	// If this colormap has already been created, just return it
-	for (colormap = &NormalLight; colormap != NULL; colormap = colormap->Next)
+	unsigned hash = ColormapHashKey (color, fade, desaturate);
+
+	for (colormap = ColormapHash[hash]; colormap != NULL; colormap = colormap->HashNext)
 	{
 		if (color == colormap->Color &&
 			fade == colormap->Fade &&
 			desaturate == colormap->Desaturate)
 		{
+			ColormapHits++;
 			return colormap;
 		}
 	}
 
-	// Not found. Create it.
+	// Not found. Create it. The light tables are left for GetMaps to build,
+	// so sectors that change color while out of sight cost nothing.
 	colormap = new FDynamicColormap;
 	colormap->Next = NormalLight.Next;
 	colormap->Color = color;
 	colormap->Fade = fade;
 	colormap->Desaturate = desaturate;
+	colormap->Maps = NULL;
+	colormap->LastUsed = 0;
+	colormap->HashNext = ColormapHash[hash];
+	ColormapHash[hash] = colormap;
 	NormalLight.Next = colormap;
 
-	if (Renderer->UsesColormap())
-	{
-		colormap->Maps = new BYTE[NUMCOLORMAPS*256];
-		colormap->BuildLights ();
-	}
-	else colormap->Maps = NULL;
-
 	return colormap;
 }
 
@@ -233,6 +268,79 @@ static void FreeSpecialLights()
 		delete colormap;
 	}
 	NormalLight.Next = NULL;
+	memset (ColormapHash, 0, sizeof(ColormapHash));
+	ColormapBytes = 0;
+}
+
+//==========================================================================
+//
+// FDynamicColormap :: CacheLights
+//
+//==========================================================================
+
+void FDynamicColormap::CacheLights ()
+{
+	Maps = new BYTE[NUMCOLORMAPS*256];
+	BuildLights ();
+	ColormapBytes += NUMCOLORMAPS*256;
+	ColormapBuilds++;
+}
+
+//==========================================================================
+//
+// R_TrimColormapCache
+//
+// Called once at the end of each frame, after the main view, camera
+// textures, player sprites and 2D have been drawn, when nothing can still
+// be using any light table. If the cached tables are over budget, frees
+// the ones that have gone unused the longest, but never one used during
+// this frame.
+//
+//==========================================================================
+
+static int STACK_ARGS SortColormapsByAge (const void *a, const void *b)
+{
+	return (*(FDynamicColormap **)a)->LastUsed - (*(FDynamicColormap **)b)->LastUsed;
+}
+
+void R_TrimColormapCache ()
+{
+	static TArray<FDynamicColormap *> candidates;
+	size_t budget = size_t(r_colormapcache) << 10;
+
+	if (ColormapBytes > budget)
+	{
+		FDynamicColormap *colormap;
+
+		candidates.Clear();
+		for (colormap = NormalLight.Next; colormap != NULL; colormap = colormap->Next)
+		{
+			if (colormap->Maps != NULL && colormap->LastUsed != FDynamicColormap::DynamicColormapFrame)
+			{
+				candidates.Push (colormap);
+			}
+		}
+		if (candidates.Size() > 1)
+		{
+			qsort (&candidates[0], candidates.Size(), sizeof(candidates[0]), SortColormapsByAge);
+		}
+		for (unsigned i = 0; i < candidates.Size() && ColormapBytes > budget; ++i)
+		{
+			delete[] candidates[i]->Maps;
+			candidates[i]->Maps = NULL;
+			ColormapBytes -= NUMCOLORMAPS*256;
+			ColormapEvictions++;
+		}
+	}
+	FDynamicColormap::DynamicColormapFrame++;
+}
+
+ADD_STAT (colormaps)
+{
+	FString out;
+	out.Format ("%u KB in light tables, %d builds, %d hits, %d evictions",
+		unsigned(ColormapBytes >> 10), ColormapBuilds, ColormapHits, ColormapEvictions);
+	return out;
 }
 
 //==========================================================================
@@ -358,29 +466,6 @@ void FDynamicColormap::ChangeColorFade (PalEntry lightcolor, PalEntry fadecolor)
 	}
 }
 
-//==========================================================================
-//
-//
-//
-//==========================================================================
-
-void FDynamicColormap::RebuildAllLights()
-{
-	if (Renderer->UsesColormap())
-	{
-		FDynamicColormap *cm;
-
-		for (cm = &NormalLight; cm != NULL; cm = cm->Next)
-		{
-			if (cm->Maps == NULL)
-			{
-				cm->Maps = new BYTE[NUMCOLORMAPS*256];
-				cm->BuildLights ();
-			}
-		}
-	}
-}
-
 //==========================================================================
 //
 // R_SetDefaultColormap
@@ -18,13 +18,32 @@ struct FDynamicColormap
 	void ChangeColor (PalEntry lightcolor, int desaturate);
 	void ChangeColorFade (PalEntry lightcolor, PalEntry fadecolor);
 	void BuildLights ();
-	static void RebuildAllLights();
 
-	BYTE *Maps;
+	// Returns the light tables. Colormaps made by GetSpecialLights only get
+	// them the first time they are drawn with, and can lose them again
+	// between frames if they go unused for a while.
+	BYTE *GetMaps ()
+	{
+		if (Maps == NULL)
+		{
+			CacheLights ();
+		}
+		LastUsed = DynamicColormapFrame;
+		return Maps;
+	}
+
+	BYTE *Maps;			// must stay first; the assembly code reads NormalLight.Maps
 	PalEntry Color;
 	PalEntry Fade;
 	int Desaturate;
 	FDynamicColormap *Next;
+	FDynamicColormap *HashNext;
+	int LastUsed;		// DynamicColormapFrame when Maps was last asked for
+
+	static int DynamicColormapFrame;
+
+private:
+	void CacheLights ();
 };
 
 // For hardware-accelerated weapon sprites in colored sectors
@@ -84,6 +103,7 @@ extern FDynamicColormap NormalLight;
 extern bool NormalLightHasFixedLights;
 
 FDynamicColormap *GetSpecialLights (PalEntry lightcolor, PalEntry fadecolor, int desaturate);
+void R_TrimColormapCache ();
 
 
 #endif
\ No newline at end of file
@@ -105,7 +105,7 @@ static BYTE *GetVoxelRemap(const BYTE *pal)
 		{
 			// The voxel palette uses VGA colors, so we have to expand it
 			// from 6 to 8 bits per component.
-			remap[i] = BestColor((uint32 *)GPalette.BaseColors,
+			remap[i] = ColorMatcher.Pick(
 				(oldpal[i*3 + 0] << 2) | (oldpal[i*3 + 0] >> 4),
 				(oldpal[i*3 + 1] << 2) | (oldpal[i*3 + 1] >> 4),
 				(oldpal[i*3 + 2] << 2) | (oldpal[i*3 + 2] >> 4));
@@ -173,6 +173,138 @@ static void RemapVoxelSlabs(kvxslab_t *dest, int size, const BYTE *remap)
 	}
 }
 
+//==========================================================================
+//
+// MakeVoxelMip
+//
+// Builds a mip level at half the size of src in every direction. Each
+// voxel is filled if any of the eight it covers is, and takes the most
+// common color among them. Every face of the new slabs is marked as
+// exposed, so nothing is culled that should be seen.
+//
+//==========================================================================
+
+static bool MakeVoxelMip(FVoxelMipLevel *dest, const FVoxelMipLevel *src)
+{
+	if (src->SlabData == NULL || MAX(src->SizeX, MAX(src->SizeY, src->SizeZ)) < 2)
+	{
+		return false;
+	}
+
+	int sizex = (src->SizeX + 1) >> 1;
+	int sizey = (src->SizeY + 1) >> 1;
+	int sizez = (src->SizeZ + 1) >> 1;
+	TArray<int> offsetx(sizex + 1);
+	TArray<short> offsetxy(sizex * (sizey + 1));
+	TArray<BYTE> slabs;
+	BYTE colors[128][8];
+	BYTE numcolors[128];
+	int x, y, z, i;
+
+	if (sizez > 128)
+	{
+		return false;
+	}
+	offsetx.Resize(sizex + 1);
+	offsetxy.Resize(sizex * (sizey + 1));
+
+	for (x = 0; x < sizex; ++x)
+	{
+		offsetx[x] = slabs.Size();
+		for (y = 0; y <= sizey; ++y)
+		{
+			int coloffs = slabs.Size() - offsetx[x];
+			if (coloffs > 32767)
+			{ // Does not fit in the xy offsets.
+				return false;
+			}
+			offsetxy[x * (sizey + 1) + y] = coloffs;
+			if (y == sizey)
+			{
+				break;
+			}
+
+			// Collect the colors of the source voxels covered by this column.
+			memset(numcolors, 0, sizez);
+			for (i = 0; i < 4; ++i)
+			{
+				int sx = x * 2 + (i & 1);
+				int sy = y * 2 + (i >> 1);
+				if (sx >= src->SizeX || sy >= src->SizeY)
+				{
+					continue;
+				}
+				const BYTE *slabxoffs = &src->SlabData[src->OffsetX[sx]];
+				const short *xyoffs = &src->OffsetXY[sx * (src->SizeY + 1)];
+				const kvxslab_t *voxptr = (const kvxslab_t *)(slabxoffs + xyoffs[sy]);
+				const kvxslab_t *voxend = (const kvxslab_t *)(slabxoffs + xyoffs[sy+1]);
+
+				for (; voxptr < voxend; voxptr = (const kvxslab_t *)((const BYTE *)voxptr + voxptr->zleng + 3))
+				{
+					for (z = 0; z < voxptr->zleng; ++z)
+					{
+						int dz = (voxptr->ztop + z) >> 1;
+						if (dz < sizez)
+						{
+							colors[dz][numcolors[dz]++] = voxptr->col[z];
+						}
+					}
+				}
+			}
+
+			// Turn the filled voxels into slabs.
+			for (z = 0; z < sizez; )
+			{
+				if (numcolors[z] == 0)
+				{
+					z++;
+					continue;
+				}
+				unsigned int start = slabs.Size();
+				slabs.Reserve(3);
+				slabs[start] = z;
+				slabs[start + 2] = 0x3f;
+				for (; z < sizez && numcolors[z] != 0; ++z)
+				{
+					int best = 0, bestcount = 0;
+					for (i = 0; i < numcolors[z]; ++i)
+					{
+						int count = 0;
+						for (int j = 0; j < numcolors[z]; ++j)
+						{
+							count += colors[z][i] == colors[z][j];
+						}
+						if (count > bestcount)
+						{
+							best = i;
+							bestcount = count;
+						}
+					}
+					slabs.Push(colors[z][best]);
+				}
+				slabs[start + 1] = slabs.Size() - start - 3;
+			}
+		}
+	}
+	offsetx[sizex] = slabs.Size();
+
+	dest->SizeX = sizex;
+	dest->SizeY = sizey;
+	dest->SizeZ = sizez;
+	if (slabs.Size() != 0)
+	{
+		// Use the same layout as R_LoadKVX, so the destructor can free it.
+		int offsetsize = (sizex + 1) * 4 + sizex * (sizey + 1) * 2;
+		dest->OffsetX = new int[(offsetsize + slabs.Size() + 3) / 4];
+		dest->OffsetXY = (short *)(dest->OffsetX + sizex + 1);
+		dest->SlabData = (BYTE *)(dest->OffsetXY + sizex * (sizey + 1));
+		memcpy(dest->OffsetX, &offsetx[0], (sizex + 1) * sizeof(int));
+		memcpy(dest->OffsetXY, &offsetxy[0], sizex * (sizey + 1) * sizeof(short));
+		memcpy(dest->SlabData, &slabs[0], slabs.Size());
+	}
+	return dest->SlabData != NULL;
+}
+
 //==========================================================================
 //
 // R_LoadKVX
@@ -314,6 +446,21 @@ FVoxel *R_LoadKVX(int lumpnum)
 		}
 	}
 
+	// Most KVX files only have the full size model, so make the rest of the
+	// mip levels. R_DrawVoxel can then draw small and distant voxels with
+	// fewer slabs. There is nothing to build them from if every mip was empty.
+	for (; mip > 0 && mip < MAXVOXMIPS; ++mip)
+	{
+		if (!MakeVoxelMip(&voxel->Mips[mip], &voxel->Mips[mip - 1]))
+		{
+			break;
+		}
+		voxel->Mips[mip].PivotX = voxel->Mips[0].PivotX >> mip;
+		voxel->Mips[mip].PivotY = voxel->Mips[0].PivotY >> mip;
+		voxel->Mips[mip].PivotZ = voxel->Mips[0].PivotZ >> mip;
+	}
+	voxel->NumMips = mip;
+
 	voxel->LumpNum = lumpnum;
 	voxel->Palette = new BYTE[768];
 	memcpy(voxel->Palette, rawvoxel + voxelsize - 768, 768);
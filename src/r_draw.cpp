@@ -43,6 +43,7 @@
 #include "gi.h"
 #include "stats.h"
 #include "x86.h"
+#include "c_dispatch.h"
 
 #undef RANGECHECK
 
@@ -82,6 +83,10 @@ void (*R_DrawSpanMaskedTranslucent)(void);
 void (*R_DrawSpanAddClamp)(void);
 void (*R_DrawSpanMaskedAddClamp)(void);
 void (STACK_ARGS *rt_map4cols)(int,int,int);
+#ifndef X86_ASM
+void (STACK_ARGS *rt_add4cols)(int,int,int);
+void (STACK_ARGS *rt_addclamp4cols)(int,int,int);
+#endif
 
 //
 // R_DrawColumn
@@ -1574,9 +1579,10 @@ extern "C" void STACK_ARGS R_DrawSlabC(int dx, fixed_t v, int dy, fixed_t vi, co
 
 // wallscan stuff, in C
 
+int vlinebits;
+
 #ifndef X86_ASM
 static DWORD STACK_ARGS vlinec1 ();
-static int vlinebits;
 
 DWORD (STACK_ARGS *dovline1)() = vlinec1;
 DWORD (STACK_ARGS *doprevline1)() = vlinec1;
@@ -1653,11 +1659,11 @@ void setupvline (int fracbits)
 		}
 	}
 #else
-	vlinebits = fracbits;
 #ifdef X64_ASM
 	setupvlinetallasm(fracbits);
 #endif
 #endif
+	vlinebits = fracbits;
 }
 
 #if !defined(X86_ASM)
@@ -1771,6 +1777,7 @@ static void R_DrawFogBoundarySection (int y, int y2, int x1)
 	{
 		int x2 = spanend[y];
 		int x = x1;
+		R_ReleaseTrueColorRect (dest + x1, x2 - x1 + 1, 1);
 		do
 		{
 			dest[x] = colormap[dest[x]];
@@ -1784,6 +1791,7 @@ static void R_DrawFogBoundaryLine (int y, int x)
 	int x2 = spanend[y];
 	BYTE *colormap = dc_colormap;
 	BYTE *dest = ylookup[y] + dc_destorg;
+	R_ReleaseTrueColorRect (dest + x, x2 - x + 1, 1);
 	do
 	{
 		dest[x] = colormap[dest[x]];
@@ -1803,7 +1811,7 @@ void R_DrawFogBoundary (int x1, int x2, short *uclip, short *dclip)
 	int b2 = dclip[x];
 	int rcolormap = GETPALOOKUP (light, wallshade);
 	int lcolormap;
-	BYTE *basecolormapdata = basecolormap->Maps;
+	BYTE *basecolormapdata = basecolormap->GetMaps();
 
 	if (b2 > t2)
 	{
@@ -2193,13 +2201,185 @@ void R_InitColumnDrawers ()
 	R_DrawSpan					= R_DrawSpanP_C;
 	R_DrawSpanMasked			= R_DrawSpanMaskedP_C;
 	rt_map4cols					= rt_map4cols_c;
+	rt_add4cols					= rt_add4cols_c;
+	rt_addclamp4cols			= rt_addclamp4cols_c;
 #endif
 	R_DrawSpanTranslucent		= R_DrawSpanTranslucentP_C;
 	R_DrawSpanMaskedTranslucent = R_DrawSpanMaskedTranslucentP_C;
 	R_DrawSpanAddClamp			= R_DrawSpanAddClampP_C;
 	R_DrawSpanMaskedAddClamp	= R_DrawSpanMaskedAddClampP_C;
+
+#ifdef SIMD_DRAWERS
+#ifndef DISABLE_AVX2
+	if (CPU.bAVX2)
+	{
+		R_DrawSpan					= R_DrawSpanP_AVX2;
+		R_DrawSpanMaskedTranslucent = R_DrawSpanMaskedTranslucentP_AVX2;
+		rt_add4cols					= rt_add4cols_avx2;
+		rt_addclamp4cols			= rt_addclamp4cols_avx2;
+	}
+	else
+#endif
+	{
+		R_DrawSpan					= R_DrawSpanP_SSE2;
+		R_DrawSpanMaskedTranslucent = R_DrawSpanMaskedTranslucentP_SSE2;
+		rt_add4cols					= rt_add4cols_sse2;
+		rt_addclamp4cols			= rt_addclamp4cols_sse2;
+	}
+#endif
+}
+
+#ifdef SIMD_DRAWERS
+//==========================================================================
+//
+// CCMD testdrawers
+//
+// Runs the SIMD drawers this CPU can use and the C drawers they replace
+// on the same random input, and reports any difference.
+//
+//==========================================================================
+
+static DWORD DrawerTestSeed;
+
+static BYTE DrawerTestRandom ()
+{
+	DrawerTestSeed = DrawerTestSeed * 1664525 + 1013904223;
+	return BYTE(DrawerTestSeed >> 24);
+}
+
+static void DrawerTestFill (BYTE *buffer, int size, bool holes)
+{
+	for (int i = 0; i < size; ++i)
+	{
+		buffer[i] = DrawerTestRandom ();
+		if (holes && buffer[i] < 64) buffer[i] = 0;
+	}
+}
+
+enum { DRAWERTEST_ROWS = 64, DRAWERTEST_PITCH = 512 };
+
+static bool TestSpanDrawer (void (*drawer)(void), void (*reference)(void), bool holes)
+{
+	static BYTE texture[256*256];
+	static BYTE colormap[256];
+	static BYTE dest1[DRAWERTEST_PITCH], dest2[DRAWERTEST_PITCH];
+
+	for (int i = 0; i < 1000; ++i)
+	{
+		ds_xbits = 2 + DrawerTestRandom () % 7;
+		ds_ybits = 2 + DrawerTestRandom () % 7;
+		DrawerTestFill (texture, 1 << (ds_xbits + ds_ybits), holes);
+		DrawerTestFill (colormap, 256, false);
+		DrawerTestFill (dest1, DRAWERTEST_PITCH, false);
+		memcpy (dest2, dest1, DRAWERTEST_PITCH);
+
+		ds_source = texture;
+		ds_colormap = colormap;
+		ds_y = 0;
+		ds_x1 = DrawerTestRandom () % 64;
+		ds_x2 = ds_x1 + DrawerTestRandom ();
+		ds_xfrac = (DrawerTestRandom () << 24) | (DrawerTestRandom () << 16) | (DrawerTestRandom () << 8);
+		ds_yfrac = (DrawerTestRandom () << 24) | (DrawerTestRandom () << 16) | (DrawerTestRandom () << 8);
+		ds_xstep = (DrawerTestRandom () << 20) | (DrawerTestRandom () << 12) | DrawerTestRandom ();
+		ds_ystep = (DrawerTestRandom () << 20) | (DrawerTestRandom () << 12) | DrawerTestRandom ();
+
+		dc_destorg = dest1;
+		reference ();
+		dc_destorg = dest2;
+		drawer ();
+		if (memcmp (dest1, dest2, DRAWERTEST_PITCH) != 0)
+		{
+			return false;
+		}
+	}
+	return true;
 }
 
+static bool Test4ColDrawer (void (STACK_ARGS *drawer)(int,int,int), void (STACK_ARGS *reference)(int,int,int))
+{
+	static BYTE temp[DRAWERTEST_ROWS*4];
+	static BYTE colormap[256];
+	static BYTE dest1[DRAWERTEST_ROWS*DRAWERTEST_PITCH], dest2[DRAWERTEST_ROWS*DRAWERTEST_PITCH];
+
+	for (int i = 0; i < 1000; ++i)
+	{
+		DrawerTestFill (temp, sizeof(temp), false);
+		DrawerTestFill (colormap, 256, false);
+		DrawerTestFill (dest1, sizeof(dest1), false);
+		memcpy (dest2, dest1, sizeof(dest1));
+
+		int yl = DrawerTestRandom () % DRAWERTEST_ROWS;
+		int yh = yl + DrawerTestRandom () % (DRAWERTEST_ROWS - yl);
+		int sx = (DrawerTestRandom () % (DRAWERTEST_PITCH / 4)) * 4;
+
+		dc_temp = temp;
+		dc_colormap = colormap;
+		dc_srcblend = Col2RGB8_LessPrecision[DrawerTestRandom () % 65];
+		dc_destblend = Col2RGB8_LessPrecision[DrawerTestRandom () % 65];
+
+		dc_destorg = dest1;
+		reference (sx, yl, yh);
+		dc_destorg = dest2;
+		drawer (sx, yl, yh);
+		if (memcmp (dest1, dest2, sizeof(dest1)) != 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static void TestDrawerSet (const char *set, void (*span)(void), void (*maskedtranslucent)(void),
+	void (STACK_ARGS *add4cols)(int,int,int), void (STACK_ARGS *addclamp4cols)(int,int,int))
+{
+	DrawerTestSeed = 1;
+	dc_srcblend = Col2RGB8[40];
+	dc_destblend = Col2RGB8[24];
+	Printf ("%s R_DrawSpan: %s\n", set, TestSpanDrawer (span, R_DrawSpanP_C, false) ? "ok" : "FAILED");
+	Printf ("%s R_DrawSpanMaskedTranslucent: %s\n", set,
+		TestSpanDrawer (maskedtranslucent, R_DrawSpanMaskedTranslucentP_C, true) ? "ok" : "FAILED");
+	Printf ("%s rt_add4cols: %s\n", set, Test4ColDrawer (add4cols, rt_add4cols_c) ? "ok" : "FAILED");
+	Printf ("%s rt_addclamp4cols: %s\n", set, Test4ColDrawer (addclamp4cols, rt_addclamp4cols_c) ? "ok" : "FAILED");
+}
+
+CCMD (testdrawers)
+{
+	// Everything the drawers read is global, so save what the renderer had.
+	int savedylookup[DRAWERTEST_ROWS];
+	BYTE *saveddestorg = dc_destorg;
+	int savedpitch = dc_pitch;
+	BYTE *savedtemp = dc_temp;
+	DWORD *savedsrcblend = dc_srcblend;
+	DWORD *saveddestblend = dc_destblend;
+	lighttable_t *savedcolormap = dc_colormap;
+
+	memcpy (savedylookup, ylookup, sizeof(savedylookup));
+	for (int i = 0; i < DRAWERTEST_ROWS; ++i)
+	{
+		ylookup[i] = i * DRAWERTEST_PITCH;
+	}
+	dc_pitch = DRAWERTEST_PITCH;
+
+	TestDrawerSet ("SSE2", R_DrawSpanP_SSE2, R_DrawSpanMaskedTranslucentP_SSE2,
+		rt_add4cols_sse2, rt_addclamp4cols_sse2);
+#ifndef DISABLE_AVX2
+	if (CPU.bAVX2)
+	{
+		TestDrawerSet ("AVX2", R_DrawSpanP_AVX2, R_DrawSpanMaskedTranslucentP_AVX2,
+			rt_add4cols_avx2, rt_addclamp4cols_avx2);
+	}
+#endif
+
+	memcpy (ylookup, savedylookup, sizeof(savedylookup));
+	dc_destorg = saveddestorg;
+	dc_pitch = savedpitch;
+	dc_temp = savedtemp;
+	dc_srcblend = savedsrcblend;
+	dc_destblend = saveddestblend;
+	dc_colormap = savedcolormap;
+}
+#endif
+
 // [RH] Choose column drawers in a single place
 EXTERN_CVAR (Int, r_drawfuzz)
 EXTERN_CVAR (Bool, r_drawtrans)
@@ -2402,8 +2582,8 @@ ESPSResult R_SetPatchStyle (FRenderStyle style, fixed_t alpha, int translation,
 		colfunc = R_DrawShadedColumn;
 		hcolfunc_post1 = rt_shaded1col;
 		hcolfunc_post4 = rt_shaded4cols;
-		dc_color = fixedcolormap ? fixedcolormap[APART(color)] : basecolormap->Maps[APART(color)];
-		dc_colormap = (basecolormap = &ShadeFakeColormap[16-alpha])->Maps;
+		dc_color = fixedcolormap ? fixedcolormap[APART(color)] : basecolormap->GetMaps()[APART(color)];
+		dc_colormap = (basecolormap = &ShadeFakeColormap[16-alpha])->GetMaps();
 		if (fixedlightlev >= 0 && fixedcolormap == NULL)
 		{
 			dc_colormap += fixedlightlev;
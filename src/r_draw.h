@@ -177,8 +177,10 @@ extern void (STACK_ARGS *rt_map4cols)(int sx, int yl, int yh);
 #define rt_copy4cols		rt_copy4cols_c
 #define rt_map1col			rt_map1col_c
 #define rt_shaded4cols		rt_shaded4cols_c
-#define rt_add4cols			rt_add4cols_c
-#define rt_addclamp4cols	rt_addclamp4cols_c
+
+// Picked by R_InitColumnDrawers, since there may be SIMD versions of these.
+extern void (STACK_ARGS *rt_add4cols)(int sx, int yl, int yh);
+extern void (STACK_ARGS *rt_addclamp4cols)(int sx, int yl, int yh);
 #endif
 
 void rt_draw4cols (int sx);
@@ -215,6 +217,23 @@ void	R_DrawSpanMaskedP_C (void);
 void	R_DrawSpanTranslucentP_C (void);
 void	R_DrawSpanMaskedTranslucentP_C (void);
 
+// x86-64 always has SSE2. The AVX2 drawers are only used if CPUID says so.
+#if defined(_M_X64) || defined(__amd64__)
+#define SIMD_DRAWERS
+
+void	R_DrawSpanP_SSE2 (void);
+void	R_DrawSpanMaskedTranslucentP_SSE2 (void);
+void STACK_ARGS rt_add4cols_sse2 (int sx, int yl, int yh);
+void STACK_ARGS rt_addclamp4cols_sse2 (int sx, int yl, int yh);
+
+#ifndef DISABLE_AVX2
+void	R_DrawSpanP_AVX2 (void);
+void	R_DrawSpanMaskedTranslucentP_AVX2 (void);
+void STACK_ARGS rt_add4cols_avx2 (int sx, int yl, int yh);
+void STACK_ARGS rt_addclamp4cols_avx2 (int sx, int yl, int yh);
+#endif
+#endif
+
 void	R_DrawTlatedLucentColumnP_C (void);
 #define R_DrawTlatedLucentColumn R_DrawTlatedLucentColumnP_C
 
@@ -0,0 +1,229 @@
+#if (defined(_M_X64) || defined(__amd64__)) && !defined(DISABLE_AVX2)
+
+#include <immintrin.h>
+#include <string.h>
+#include "doomtype.h"
+#include "r_draw.h"
+#include "v_video.h"
+
+// AVX2 versions of the span drawers and the four column adders. They do
+// eight pixels at a time, and the adders fetch their RGB values with
+// gathers. The byte tables are still read one pixel at a time, since a
+// gather can only fetch whole DWORDs. This file is built with AVX2 enabled,
+// so nothing in it may be called unless CPU.bAVX2 is set.
+
+#ifdef _MSC_VER
+#define ALIGN32 __declspec(align(32))
+#else
+#define ALIGN32 __attribute__((aligned(32)))
+#endif
+
+static inline __m256i AddRGB (__m256i fg, __m256i bg)
+{
+	__m256i c = _mm256_or_si256 (_mm256_add_epi32 (fg, bg), _mm256_set1_epi32 (0x1f07c1f));
+	return _mm256_and_si256 (c, _mm256_srli_epi32 (c, 15));
+}
+
+static inline __m256i AddClampRGB (__m256i fg, __m256i bg)
+{
+	__m256i a = _mm256_add_epi32 (fg, bg);
+	__m256i b = _mm256_and_si256 (a, _mm256_set1_epi32 (0x40100400));
+	a = _mm256_and_si256 (_mm256_or_si256 (a, _mm256_set1_epi32 (0x01f07c1f)), _mm256_set1_epi32 (0x3fffffff));
+	a = _mm256_or_si256 (a, _mm256_sub_epi32 (b, _mm256_srli_epi32 (b, 5)));
+	return _mm256_and_si256 (a, _mm256_srli_epi32 (a, 15));
+}
+
+// Texture coordinates for the next eight pixels of a span.
+struct FSpanSteps8
+{
+	__m256i xfrac, yfrac, xstep, ystep, xmask;
+	__m128i xshift, yshift;
+
+	FSpanSteps8 (dsfixed_t xf, dsfixed_t yf, dsfixed_t xs, dsfixed_t ys, int xbits, int ybits)
+	{
+		__m256i lane = _mm256_setr_epi32 (0, 1, 2, 3, 4, 5, 6, 7);
+		xfrac = _mm256_add_epi32 (_mm256_set1_epi32 (xf), _mm256_mullo_epi32 (_mm256_set1_epi32 (xs), lane));
+		yfrac = _mm256_add_epi32 (_mm256_set1_epi32 (yf), _mm256_mullo_epi32 (_mm256_set1_epi32 (ys), lane));
+		xstep = _mm256_set1_epi32 (xs * 8);
+		ystep = _mm256_set1_epi32 (ys * 8);
+		yshift = _mm_cvtsi32_si128 (32 - ybits);
+		xshift = _mm_cvtsi32_si128 (32 - ybits - xbits);
+		xmask = _mm256_set1_epi32 (((1 << xbits) - 1) << ybits);
+	}
+
+	void Spots (int *spots)
+	{
+		_mm256_store_si256 ((__m256i *)spots, _mm256_add_epi32 (
+			_mm256_and_si256 (_mm256_srl_epi32 (xfrac, xshift), xmask), _mm256_srl_epi32 (yfrac, yshift)));
+		xfrac = _mm256_add_epi32 (xfrac, xstep);
+		yfrac = _mm256_add_epi32 (yfrac, ystep);
+	}
+};
+
+void R_DrawSpanP_AVX2 (void)
+{
+	const BYTE *source = ds_source;
+	const BYTE *colormap = ds_colormap;
+	BYTE *dest = ylookup[ds_y] + ds_x1 + dc_destorg;
+	int count = ds_x2 - ds_x1 + 1;
+	dsfixed_t xfrac = ds_xfrac;
+	dsfixed_t yfrac = ds_yfrac;
+
+	if (count >= 8)
+	{
+		ALIGN32 int spots[8];
+		FSpanSteps8 steps (xfrac, yfrac, ds_xstep, ds_ystep, ds_xbits, ds_ybits);
+		do
+		{
+			steps.Spots (spots);
+			for (int i = 0; i < 8; ++i)
+			{
+				dest[i] = colormap[source[spots[i]]];
+			}
+			dest += 8;
+			count -= 8;
+		} while (count >= 8);
+		xfrac = _mm_cvtsi128_si32 (_mm256_castsi256_si128 (steps.xfrac));
+		yfrac = _mm_cvtsi128_si32 (_mm256_castsi256_si128 (steps.yfrac));
+	}
+	if (count > 0)
+	{
+		BYTE yshift = 32 - ds_ybits;
+		BYTE xshift = yshift - ds_xbits;
+		int xmask = ((1 << ds_xbits) - 1) << ds_ybits;
+		do
+		{
+			*dest++ = colormap[source[((xfrac >> xshift) & xmask) + (yfrac >> yshift)]];
+			xfrac += ds_xstep;
+			yfrac += ds_ystep;
+		} while (--count);
+	}
+}
+
+void R_DrawSpanMaskedTranslucentP_AVX2 (void)
+{
+	const BYTE *source = ds_source;
+	const BYTE *colormap = ds_colormap;
+	BYTE *dest = ylookup[ds_y] + ds_x1 + dc_destorg;
+	int count = ds_x2 - ds_x1 + 1;
+	dsfixed_t xfrac = ds_xfrac;
+	dsfixed_t yfrac = ds_yfrac;
+	const int *fg2rgb = (const int *)dc_srcblend;
+	const int *bg2rgb = (const int *)dc_destblend;
+
+	if (count >= 8)
+	{
+		ALIGN32 int spots[8];
+		ALIGN32 int fg[8];
+		ALIGN32 int out[8];
+		FSpanSteps8 steps (xfrac, yfrac, ds_xstep, ds_ystep, ds_xbits, ds_ybits);
+		do
+		{
+			int mask = 0;
+
+			steps.Spots (spots);
+			for (int i = 0; i < 8; ++i)
+			{
+				BYTE texdata = source[spots[i]];
+				fg[i] = colormap[texdata];
+				mask |= (texdata != 0) << i;
+			}
+			if (mask != 0)
+			{
+				__m128i bgbytes = _mm_loadl_epi64 ((const __m128i *)dest);
+				_mm256_store_si256 ((__m256i *)out, AddRGB (
+					_mm256_i32gather_epi32 (fg2rgb, _mm256_load_si256 ((const __m256i *)fg), 4),
+					_mm256_i32gather_epi32 (bg2rgb, _mm256_cvtepu8_epi32 (bgbytes), 4)));
+				for (int i = 0; i < 8; ++i)
+				{
+					if (mask & (1 << i))
+					{
+						dest[i] = RGB32k[0][0][out[i]];
+					}
+				}
+			}
+			dest += 8;
+			count -= 8;
+		} while (count >= 8);
+		xfrac = _mm_cvtsi128_si32 (_mm256_castsi256_si128 (steps.xfrac));
+		yfrac = _mm_cvtsi128_si32 (_mm256_castsi256_si128 (steps.yfrac));
+	}
+	if (count > 0)
+	{
+		BYTE yshift = 32 - ds_ybits;
+		BYTE xshift = yshift - ds_xbits;
+		int xmask = ((1 << ds_xbits) - 1) << ds_ybits;
+		do
+		{
+			BYTE texdata = source[((xfrac >> xshift) & xmask) + (yfrac >> yshift)];
+			if (texdata != 0)
+			{
+				DWORD fg = fg2rgb[colormap[texdata]] + bg2rgb[*dest];
+				fg |= 0x1f07c1f;
+				*dest = RGB32k[0][0][fg & (fg>>15)];
+			}
+			dest++;
+			xfrac += ds_xstep;
+			yfrac += ds_ystep;
+		} while (--count);
+	}
+}
+
+// The four column adders do two rows of dc_temp per vector. A leftover
+// row gets the upper half of the vector filled with copies of itself.
+static inline void Draw4Cols (int sx, int yl, int yh, bool clamp)
+{
+	int count = yh-yl;
+	if (count < 0)
+		return;
+	count++;
+
+	const int *fg2rgb = (const int *)dc_srcblend;
+	const int *bg2rgb = (const int *)dc_destblend;
+	BYTE *dest = ylookup[yl] + sx + dc_destorg;
+	const BYTE *source = &dc_temp[yl*4];
+	const BYTE *colormap = dc_colormap;
+	int pitch = dc_pitch;
+	ALIGN32 int out[8];
+
+	while (count > 0)
+	{
+		BYTE *dest2 = count > 1 ? dest + pitch : dest;
+		const BYTE *source2 = count > 1 ? source + 4 : source;
+		int bg0, bg1;
+
+		memcpy (&bg0, dest, 4);
+		memcpy (&bg1, dest2, 4);
+		__m256i fg = _mm256_setr_epi32 (colormap[source[0]], colormap[source[1]], colormap[source[2]], colormap[source[3]],
+			colormap[source2[0]], colormap[source2[1]], colormap[source2[2]], colormap[source2[3]]);
+		__m256i bg = _mm256_cvtepu8_epi32 (_mm_unpacklo_epi32 (_mm_cvtsi32_si128 (bg0), _mm_cvtsi32_si128 (bg1)));
+
+		fg = _mm256_i32gather_epi32 (fg2rgb, fg, 4);
+		bg = _mm256_i32gather_epi32 (bg2rgb, bg, 4);
+		_mm256_store_si256 ((__m256i *)out, clamp ? AddClampRGB (fg, bg) : AddRGB (fg, bg));
+		dest[0] = RGB32k[0][0][out[0]];
+		dest[1] = RGB32k[0][0][out[1]];
+		dest[2] = RGB32k[0][0][out[2]];
+		dest[3] = RGB32k[0][0][out[3]];
+		dest2[0] = RGB32k[0][0][out[4]];
+		dest2[1] = RGB32k[0][0][out[5]];
+		dest2[2] = RGB32k[0][0][out[6]];
+		dest2[3] = RGB32k[0][0][out[7]];
+
+		source += 8;
+		dest += pitch * 2;
+		count -= 2;
+	}
+}
+
+void STACK_ARGS rt_add4cols_avx2 (int sx, int yl, int yh)
+{
+	Draw4Cols (sx, yl, yh, false);
+}
+
+void STACK_ARGS rt_addclamp4cols_avx2 (int sx, int yl, int yh)
+{
+	Draw4Cols (sx, yl, yh, true);
+}
+
+#endif
@@ -0,0 +1,506 @@
+/*
+** r_drawbgra.cpp
+** True color wall and flat drawers
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 The GZ3Doom developers
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+** The paletted drawers still run when r_swtruecolor is on. Every wall
+** column and flat span they draw is drawn a second time into a 32-bit
+** copy of the screen, from the texture's CopyTrueColorPixels image and
+** with the light worked out per pixel instead of picked from one of the
+** colormaps. The top byte of each true color pixel is an owner tag: the
+** true color drawers set it to the number of the current frame, and
+** everything that only draws in the palette (sprites, masked walls,
+** particles, 2D) clears it for the pixels it covers. When the frame is
+** shown, a pixel is taken from the true color copy only if it is still
+** tagged with that frame, so all of those keep coming from the palette
+** without needing true color drawers of their own.
+*/
+
+#include "templates.h"
+#include "doomdef.h"
+#include "doomstat.h"
+#include "c_cvars.h"
+#include "v_video.h"
+#include "v_palette.h"
+#include "r_local.h"
+#include "r_utility.h"
+#include "r_data/colormaps.h"
+#include "textures/textures.h"
+#include "version.h"
+#include "r_drawbgra.h"
+
+// TYPES -------------------------------------------------------------------
+
+// The light of one column or span, ready to be applied to its texels.
+struct FTrueColorShade
+{
+	FTrueColorShade (int fade);
+	DWORD Light (DWORD texel) const;
+
+	int Mul, AddR, AddG, AddB;
+};
+
+// PUBLIC DATA DEFINITIONS -------------------------------------------------
+
+CUSTOM_CVAR (Bool, r_swtruecolor, false, CVAR_ARCHIVE|CVAR_GLOBALCONFIG|CVAR_NOINITCALL)
+{
+	Printf ("This won't take effect until " GAMENAME " is restarted.\n");
+}
+
+bool TrueColorActive;
+
+// PRIVATE DATA DEFINITIONS ------------------------------------------------
+
+static bool TrueColorEnabled;
+
+static TArray<DWORD> TrueColorBuffer;
+static DWORD *TrueColorBase;
+static BYTE *TrueColorBase8;		// The paletted buffer the true color one mirrors
+static int TrueColorPitch;
+static DWORD TrueColorTag;			// Owner tag of this frame's pixels, in the top byte
+
+// The part of the screen covered by the last view that was rendered.
+static bool TrueColorViewValid;
+static int TrueColorViewX, TrueColorViewY, TrueColorViewWidth, TrueColorViewHeight;
+
+// The current colormap. Light and desaturation are scaled to 0-256.
+static int LightR, LightG, LightB;
+static int FadeR, FadeG, FadeB;
+static int Desaturate;
+
+static int SpanStyle;
+static const DWORD *SpanSource;
+static int SpanAlpha;
+
+// CODE --------------------------------------------------------------------
+
+//==========================================================================
+//
+// FTrueColorShade
+//
+// The same steps FDynamicColormap::BuildLights takes for each palette
+// entry: desaturate, blend toward the fade color, then tint by the light
+// color.
+//
+//==========================================================================
+
+inline FTrueColorShade::FTrueColorShade (int fade)
+{
+	Mul = 256 - fade;
+	AddR = FadeR * fade;
+	AddG = FadeG * fade;
+	AddB = FadeB * fade;
+}
+
+inline DWORD FTrueColorShade::Light (DWORD texel) const
+{
+	int r = (texel >> 16) & 0xFF;
+	int g = (texel >> 8) & 0xFF;
+	int b = texel & 0xFF;
+
+	if (Desaturate != 0)
+	{
+		int intensity = ((r * 77 + g * 143 + b * 37) >> 8) * Desaturate;
+		r = (r * (256 - Desaturate) + intensity) >> 8;
+		g = (g * (256 - Desaturate) + intensity) >> 8;
+		b = (b * (256 - Desaturate) + intensity) >> 8;
+	}
+	r = ((r * Mul + AddR) * LightR) >> 16;
+	g = ((g * Mul + AddG) * LightG) >> 16;
+	b = ((b * Mul + AddB) * LightB) >> 16;
+	return (r << 16) | (g << 8) | b;
+}
+
+//==========================================================================
+//
+// R_InitTrueColor
+//
+//==========================================================================
+
+void R_InitTrueColor ()
+{
+	TrueColorEnabled = r_swtruecolor;
+}
+
+//==========================================================================
+//
+// R_BeginTrueColorFrame
+//
+// Only the main view gets a true color copy, because nothing else can
+// show one. Fixed colormaps are left to the paletted drawers.
+//
+//==========================================================================
+
+void R_BeginTrueColorFrame ()
+{
+	TrueColorActive = false;
+	if (!TrueColorEnabled || RenderTarget != screen || fixedcolormap != NULL ||
+		!screen->CanPresentTrueColor ())
+	{
+		return;
+	}
+
+	int pitch = screen->GetPitch ();
+	unsigned int size = pitch * screen->GetHeight ();
+
+	// A new tag for every frame leaves the pixels of older frames untagged
+	// without having to clear them. Only when the tags run out, or the
+	// buffer is new, does everything have to be cleared.
+	TrueColorTag += 1 << 24;
+	if (TrueColorBuffer.Size() != size || TrueColorTag == 0)
+	{
+		TrueColorBuffer.Resize (size);
+		memset (&TrueColorBuffer[0], 0, size * sizeof(DWORD));
+		TrueColorTag = 1 << 24;
+	}
+	TrueColorBase = &TrueColorBuffer[0];
+	TrueColorBase8 = screen->GetBuffer ();
+	TrueColorPitch = pitch;
+	TrueColorViewX = viewwindowx;
+	TrueColorViewY = viewwindowy;
+	TrueColorViewWidth = viewwidth;
+	TrueColorViewHeight = viewheight;
+
+	TrueColorActive = true;
+	TrueColorViewValid = true;
+}
+
+void R_EndTrueColorFrame ()
+{
+	TrueColorActive = false;
+}
+
+//==========================================================================
+//
+// R_TrueColorFade
+//
+//==========================================================================
+
+int R_TrueColorFade (fixed_t vis, int shade)
+{
+	if (fixedlightlev >= 0)
+	{
+		return (fixedlightlev >> COLORMAPSHIFT) * (256 / NUMCOLORMAPS);
+	}
+	int level = clamp<int> (shade - MIN (MAXLIGHTVIS, vis), 0, (NUMCOLORMAPS-1) << FRACBITS);
+	return (level * (256 / NUMCOLORMAPS)) >> FRACBITS;
+}
+
+//==========================================================================
+//
+// R_SetTrueColorColormap
+//
+//==========================================================================
+
+void R_SetTrueColorColormap (FDynamicColormap *colormap)
+{
+	LightR = colormap->Color.r * 256 / 255;
+	LightG = colormap->Color.g * 256 / 255;
+	LightB = colormap->Color.b * 256 / 255;
+	FadeR = colormap->Fade.r;
+	FadeG = colormap->Fade.g;
+	FadeB = colormap->Fade.b;
+	Desaturate = abs (colormap->Desaturate) * 256 / 255;
+}
+
+//==========================================================================
+//
+// R_DrawTrueColorColumn
+//
+//==========================================================================
+
+void R_DrawTrueColorColumn (const BYTE *dest8, const DWORD *source, int count,
+	DWORD frac, DWORD fracstep, int bits, int fade)
+{
+	FTrueColorShade shade (fade);
+	DWORD *dest = TrueColorBase + (dest8 - TrueColorBase8);
+	DWORD tag = TrueColorTag;
+	int pitch = TrueColorPitch;
+
+	do
+	{
+		*dest = shade.Light (source[frac >> bits]) | tag;
+		dest += pitch;
+		frac += fracstep;
+	} while (--count);
+}
+
+//==========================================================================
+//
+// R_SetupTrueColorSpan
+//
+// Masked planes are not drawn in true color. Their holes would need the
+// same treatment as masked walls.
+//
+//==========================================================================
+
+void R_SetupTrueColorSpan (FTexture *tex, int style, fixed_t alpha)
+{
+	SpanStyle = style;
+	if (style != TCS_None)
+	{
+		SpanSource = tex->GetPixelsBgra ();
+		SpanAlpha = alpha >> (FRACBITS - 8);
+	}
+}
+
+//==========================================================================
+//
+// R_DrawTrueColorSpan
+//
+// Translucent spans blend with the true color pixel under them if it
+// belongs to this frame, or with the palette color if it doesn't.
+//
+//==========================================================================
+
+void R_DrawTrueColorSpan (int fade)
+{
+	if (SpanStyle == TCS_None)
+	{
+		return;
+	}
+
+	FTrueColorShade shade (fade);
+	const BYTE *dest8 = ylookup[ds_y] + ds_x1 + dc_destorg;
+	DWORD *dest = TrueColorBase + (dest8 - TrueColorBase8);
+	int count = ds_x2 - ds_x1 + 1;
+	dsfixed_t xfrac = ds_xfrac;
+	dsfixed_t yfrac = ds_yfrac;
+	BYTE yshift = 32 - ds_ybits;
+	BYTE xshift = yshift - ds_xbits;
+	int xmask = ((1 << ds_xbits) - 1) << ds_ybits;
+	int alpha = SpanAlpha;
+	DWORD tag = TrueColorTag;
+
+	do
+	{
+		DWORD color = shade.Light (SpanSource[((xfrac >> xshift) & xmask) + (yfrac >> yshift)]);
+
+		if (SpanStyle != TCS_Opaque)
+		{
+			DWORD bg = ((*dest & 0xFF000000) == tag) ? *dest : GPalette.BaseColors[*dest8].d;
+			int r = (color >> 16) & 0xFF, g = (color >> 8) & 0xFF, b = color & 0xFF;
+			int bgr = (bg >> 16) & 0xFF, bgg = (bg >> 8) & 0xFF, bgb = bg & 0xFF;
+
+			if (SpanStyle == TCS_Translucent)
+			{
+				r = (r * alpha + bgr * (256 - alpha)) >> 8;
+				g = (g * alpha + bgg * (256 - alpha)) >> 8;
+				b = (b * alpha + bgb * (256 - alpha)) >> 8;
+			}
+			else
+			{
+				r = MIN (bgr + ((r * alpha) >> 8), 255);
+				g = MIN (bgg + ((g * alpha) >> 8), 255);
+				b = MIN (bgb + ((b * alpha) >> 8), 255);
+			}
+			color = (r << 16) | (g << 8) | b;
+		}
+		*dest++ = color | tag;
+		dest8++;
+		xfrac += ds_xstep;
+		yfrac += ds_ystep;
+	} while (--count);
+}
+
+//==========================================================================
+//
+// R_KeyTrueColorSpan
+//
+// Called after the paletted span drawer. A span that was not drawn in
+// true color takes the pixels under it back for the palette.
+//
+//==========================================================================
+
+void R_KeyTrueColorSpan ()
+{
+	if (SpanStyle == TCS_None)
+	{
+		R_ReleaseTrueColorRect (ylookup[ds_y] + ds_x1 + dc_destorg, ds_x2 - ds_x1 + 1, 1);
+	}
+}
+
+//==========================================================================
+//
+// TrueColorDest
+//
+// Returns the true color pixel for dest8 and how many rows there are
+// from it to the bottom of the buffer, or NULL if dest8 is not in the
+// paletted buffer the shown view was rendered to.
+//
+//==========================================================================
+
+static DWORD *TrueColorDest (const BYTE *dest8, int &rows)
+{
+	if (!TrueColorViewValid || dest8 < TrueColorBase8 || dest8 >= TrueColorBase8 + TrueColorBuffer.Size())
+	{
+		return NULL;
+	}
+	ptrdiff_t offset = dest8 - TrueColorBase8;
+	rows = int((TrueColorBuffer.Size() - offset + TrueColorPitch - 1) / TrueColorPitch);
+	return TrueColorBase + offset;
+}
+
+//==========================================================================
+//
+// R_ReleaseTrueColorColumn
+//
+//==========================================================================
+
+void R_ReleaseTrueColorColumn (const BYTE *dest8, int count)
+{
+	int rows;
+	DWORD *dest = TrueColorDest (dest8, rows);
+
+	if (dest != NULL)
+	{
+		for (count = MIN (count, rows); count > 0; --count)
+		{
+			*dest &= 0xFFFFFF;
+			dest += TrueColorPitch;
+		}
+	}
+}
+
+//==========================================================================
+//
+// R_ReleaseTrueColorRect
+//
+//==========================================================================
+
+void R_ReleaseTrueColorRect (const BYTE *dest8, int width, int height)
+{
+	int rows;
+	DWORD *dest = TrueColorDest (dest8, rows);
+
+	if (dest != NULL)
+	{
+		DWORD *end = TrueColorBase + TrueColorBuffer.Size();
+
+		for (height = MIN (height, rows); height > 0; --height)
+		{
+			DWORD *row = dest;
+			for (int x = MIN<ptrdiff_t> (width, end - dest); x > 0; --x)
+			{
+				*row++ &= 0xFFFFFF;
+			}
+			dest += TrueColorPitch;
+		}
+	}
+}
+
+//==========================================================================
+//
+// R_ReleaseTrueColorMasked
+//
+// Only releases the pixels that mvline draws, which skips color 0.
+//
+//==========================================================================
+
+void R_ReleaseTrueColorMasked (const BYTE *dest8, const BYTE *source, int count,
+	DWORD frac, DWORD fracstep, int bits)
+{
+	int rows;
+	DWORD *dest = TrueColorDest (dest8, rows);
+
+	if (dest != NULL)
+	{
+		for (count = MIN (count, rows); count > 0; --count)
+		{
+			if (source[frac >> bits] != 0)
+			{
+				*dest &= 0xFFFFFF;
+			}
+			dest += TrueColorPitch;
+			frac += fracstep;
+		}
+	}
+}
+
+//==========================================================================
+//
+// R_ReleaseTrueColorView
+//
+//==========================================================================
+
+void R_ReleaseTrueColorView ()
+{
+	TrueColorViewValid = false;
+}
+
+//==========================================================================
+//
+// R_PresentTrueColorView
+//
+// Gamma and the palette flash are applied here the way the framebuffer
+// applies them to its palette.
+//
+//==========================================================================
+
+void R_PresentTrueColorView (const BYTE *src8, int srcpitch, DWORD *dest, int destpitch,
+	const BYTE gamma[3][256], PalEntry flash, int flashamount)
+{
+	if (!TrueColorViewValid || src8 != TrueColorBase8 || srcpitch != TrueColorPitch)
+	{
+		return;
+	}
+	TrueColorViewValid = false;
+
+	int flashr = gamma[0][flash.r] * flashamount;
+	int flashg = gamma[1][flash.g] * flashamount;
+	int flashb = gamma[2][flash.b] * flashamount;
+	int mul = 256 - flashamount;
+
+	const DWORD *src = TrueColorBase + TrueColorViewY * srcpitch + TrueColorViewX;
+	dest = (DWORD *)((BYTE *)dest + TrueColorViewY * destpitch) + TrueColorViewX;
+
+	for (int y = 0; y < TrueColorViewHeight; ++y)
+	{
+		for (int x = 0; x < TrueColorViewWidth; ++x)
+		{
+			DWORD color = src[x];
+			if ((color & 0xFF000000) == TrueColorTag)
+			{
+				int r = gamma[0][(color >> 16) & 0xFF];
+				int g = gamma[1][(color >> 8) & 0xFF];
+				int b = gamma[2][color & 0xFF];
+				if (flashamount != 0)
+				{
+					r = (r * mul + flashr) >> 8;
+					g = (g * mul + flashg) >> 8;
+					b = (b * mul + flashb) >> 8;
+				}
+				dest[x] = (r << 16) | (g << 8) | b;
+			}
+		}
+		src += srcpitch;
+		dest = (DWORD *)((BYTE *)dest + destpitch);
+	}
+}
@@ -0,0 +1,99 @@
+/*
+** r_drawbgra.h
+** True color wall and flat drawers
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 The GZ3Doom developers
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+
+#ifndef __R_DRAWBGRA_H__
+#define __R_DRAWBGRA_H__
+
+#include "doomtype.h"
+
+struct FDynamicColormap;
+class FTexture;
+
+// Set while the current view is also drawn into the true color buffer.
+// It is only ever set for the main view, and never with a fixed colormap.
+extern bool TrueColorActive;
+
+enum ETrueColorSpanStyle
+{
+	TCS_None,
+	TCS_Opaque,
+	TCS_Translucent,
+	TCS_Add,
+};
+
+// Reads r_swtruecolor. Called once by R_InitRenderer.
+void R_InitTrueColor ();
+
+// Decides whether the view about to be rendered gets a true color copy.
+void R_BeginTrueColorFrame ();
+void R_EndTrueColorFrame ();
+
+// Turns a light level and distance into the amount of fade from 0 to 256,
+// the same as GETPALOOKUP would without rounding to a whole colormap.
+int R_TrueColorFade (fixed_t vis, int shade);
+
+// Colormap whose color, fade and desaturation are applied to the texels.
+void R_SetTrueColorColormap (FDynamicColormap *colormap);
+
+// Draws one wall column into the true color buffer after the paletted
+// drawer has drawn it to dest8. source points at the texel in the texture's
+// GetPixelsBgra copy that the paletted column started from.
+void R_DrawTrueColorColumn (const BYTE *dest8, const DWORD *source, int count,
+	DWORD frac, DWORD fracstep, int bits, int fade);
+
+// R_MapPlane calls these around the paletted span drawer. They take the
+// span from the same ds_* globals.
+void R_SetupTrueColorSpan (FTexture *tex, int style, fixed_t alpha);
+void R_DrawTrueColorSpan (int fade);
+void R_KeyTrueColorSpan ();
+
+// Everything that draws over the view only in the palette calls one of
+// these for the pixels it covers, so they are shown from the palette.
+// dest8 points into the paletted buffer, with the screen's pitch. Pointers
+// into other canvases are ignored.
+void R_ReleaseTrueColorColumn (const BYTE *dest8, int count);
+void R_ReleaseTrueColorRect (const BYTE *dest8, int width, int height);
+// For mvline columns, which leave color 0 transparent.
+void R_ReleaseTrueColorMasked (const BYTE *dest8, const BYTE *source, int count,
+	DWORD frac, DWORD fracstep, int bits);
+// For something that replaces the whole screen, like a wipe.
+void R_ReleaseTrueColorView ();
+
+// Copies the true color pixels of the last rendered view over the palette
+// converted ones in a 32-bit 0x00RRGGBB destination. Pixels that something
+// else has drawn over since the view was rendered are left alone.
+void R_PresentTrueColorView (const BYTE *src8, int srcpitch, DWORD *dest, int destpitch,
+	const BYTE gamma[3][256], PalEntry flash, int flashamount);
+
+#endif
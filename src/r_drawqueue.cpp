@@ -0,0 +1,488 @@
+/*
+** r_drawqueue.cpp
+** Draws walls and flats with several threads
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 The GZ3Doom developers
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+** The renderer itself still runs on one thread: walking the BSP, clipping
+** and setting up the drawers all works through globals that are shared
+** by everything. What takes most of the time at high resolutions, though,
+** is filling the pixels, and wallscan and R_MapPlane only need a handful
+** of values to do that. With r_multithreaded set, those values are put
+** in a queue, and when something needs the screen to be up to date, the
+** queue is drawn by several threads at once. Each thread owns a slice of
+** columns and draws only the parts of the queued columns and spans that
+** fall inside it, in the order they were queued. Every pixel comes out
+** of the same arithmetic as in the C drawers, so the picture matches a
+** build without X86_ASM or X64_ASM. The threads always use C loops, and
+** they have not been checked against the assembly vline and span drawers
+** that such builds use when r_multithreaded is off.
+*/
+
+#include <limits.h>
+
+#include "workerthreads.h"
+#include "templates.h"
+#include "doomdef.h"
+#include "c_cvars.h"
+#include "i_system.h"
+#include "stats.h"
+#include "r_local.h"
+#include "r_drawqueue.h"
+
+// MACROS ------------------------------------------------------------------
+
+#define MAX_DRAWER_THREADS	16
+
+// TYPES -------------------------------------------------------------------
+
+enum EDrawerCommand
+{
+	DC_VLine1,
+	DC_VLine4,
+	DC_Span,
+};
+
+struct FDrawerCommand
+{
+	BYTE Type;
+	BYTE Bits;				// vline texture bits or span x bits
+	BYTE YBits;				// span y bits
+	int X;					// first column
+	int Count;				// rows for vlines, pixels for spans
+	BYTE *Dest;
+	const BYTE *Source[4];
+	const BYTE *Colormap[4];
+	DWORD Frac[4];			// spans use the first two for x and y
+	DWORD Step[4];
+};
+
+struct FDrawerThread
+{
+	int Slice;
+	FWorkerSemaphore Start;
+	FWorkerThread Thread;
+};
+
+// EXTERNAL DATA DECLARATIONS ----------------------------------------------
+
+extern int vlinebits;
+
+// PUBLIC DATA DEFINITIONS -------------------------------------------------
+
+bool DrawerQueueActive;
+
+CUSTOM_CVAR (Int, r_multithreaded, 0, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+{
+	if (self < 0)
+	{
+		self = 0;
+	}
+	else if (self > MAX_DRAWER_THREADS)
+	{
+		self = MAX_DRAWER_THREADS;
+	}
+}
+
+// PRIVATE DATA DEFINITIONS ------------------------------------------------
+
+static TArray<FDrawerCommand> Commands;
+static FDrawerThread *Threads[MAX_DRAWER_THREADS];
+static int NumThreads;			// including the main thread, which has no entry
+static int ThreadsRequested;
+static int NumSlices;
+static int SliceWidth;
+static int QueuePitch;
+static bool QuitThreads;
+static FWorkerSemaphore *ThreadsDone;
+
+static int FrameCommands, FrameFlushes;
+
+// CODE --------------------------------------------------------------------
+
+//==========================================================================
+//
+// DrawVLine
+//
+// Same as vlinec1, for the rows of one column.
+//
+//==========================================================================
+
+static void DrawVLine (BYTE *dest, int count, int pitch, int bits,
+	const BYTE *source, const BYTE *colormap, DWORD frac, DWORD fracstep)
+{
+	do
+	{
+		*dest = colormap[source[frac>>bits]];
+		frac += fracstep;
+		dest += pitch;
+	} while (--count);
+}
+
+//==========================================================================
+//
+// DrawSpan
+//
+// Same as R_DrawSpanP_C, starting skip pixels into the span. Skipping
+// by multiplying gives the same texture coordinates as stepping, since
+// both wrap the same way.
+//
+//==========================================================================
+
+static void DrawSpan (const FDrawerCommand &cmd, int skip, int count)
+{
+	DWORD xfrac = cmd.Frac[0] + cmd.Step[0] * skip;
+	DWORD yfrac = cmd.Frac[1] + cmd.Step[1] * skip;
+	DWORD xstep = cmd.Step[0];
+	DWORD ystep = cmd.Step[1];
+	const BYTE *source = cmd.Source[0];
+	const BYTE *colormap = cmd.Colormap[0];
+	BYTE *dest = cmd.Dest + skip;
+	BYTE yshift = 32 - cmd.YBits;
+	BYTE xshift = yshift - cmd.Bits;
+	int xmask = ((1 << cmd.Bits) - 1) << cmd.YBits;
+
+	do
+	{
+		int spot = ((xfrac >> xshift) & xmask) + (yfrac >> yshift);
+		*dest++ = colormap[source[spot]];
+		xfrac += xstep;
+		yfrac += ystep;
+	} while (--count);
+}
+
+//==========================================================================
+//
+// DrawSlice
+//
+// Draws the parts of the queued commands that are inside one slice.
+//
+//==========================================================================
+
+static void DrawSlice (int slice)
+{
+	const int x1 = slice * SliceWidth;
+	const int x2 = slice == NumSlices - 1 ? INT_MAX : x1 + SliceWidth;
+	const int pitch = QueuePitch;
+	const unsigned int count = Commands.Size();
+
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		const FDrawerCommand &cmd = Commands[i];
+
+		switch (cmd.Type)
+		{
+		case DC_VLine1:
+			if (cmd.X >= x1 && cmd.X < x2)
+			{
+				DrawVLine (cmd.Dest, cmd.Count, pitch, cmd.Bits,
+					cmd.Source[0], cmd.Colormap[0], cmd.Frac[0], cmd.Step[0]);
+			}
+			break;
+
+		case DC_VLine4:
+			if (cmd.X >= x1 && cmd.X + 3 < x2)
+			{
+				BYTE *dest = cmd.Dest;
+				DWORD place[4] = { cmd.Frac[0], cmd.Frac[1], cmd.Frac[2], cmd.Frac[3] };
+				int bits = cmd.Bits;
+				int rows = cmd.Count;
+
+				do
+				{
+					dest[0] = cmd.Colormap[0][cmd.Source[0][place[0]>>bits]]; place[0] += cmd.Step[0];
+					dest[1] = cmd.Colormap[1][cmd.Source[1][place[1]>>bits]]; place[1] += cmd.Step[1];
+					dest[2] = cmd.Colormap[2][cmd.Source[2][place[2]>>bits]]; place[2] += cmd.Step[2];
+					dest[3] = cmd.Colormap[3][cmd.Source[3][place[3]>>bits]]; place[3] += cmd.Step[3];
+					dest += pitch;
+				} while (--rows);
+			}
+			else if (cmd.X + 3 >= x1 && cmd.X < x2)
+			{ // The slices are aligned to wallscan's groups, so this is only
+			  // for views that are not.
+				for (int z = 0; z < 4; ++z)
+				{
+					if (cmd.X + z >= x1 && cmd.X + z < x2)
+					{
+						DrawVLine (cmd.Dest + z, cmd.Count, pitch, cmd.Bits,
+							cmd.Source[z], cmd.Colormap[z], cmd.Frac[z], cmd.Step[z]);
+					}
+				}
+			}
+			break;
+
+		case DC_Span:
+			{
+				int start = MAX (cmd.X, x1);
+				int stop = MIN (cmd.X + cmd.Count, x2);
+				if (start < stop)
+				{
+					DrawSpan (cmd, start - cmd.X, stop - start);
+				}
+			}
+			break;
+		}
+	}
+}
+
+//==========================================================================
+//
+// DrawerThreadLoop
+//
+//==========================================================================
+
+static void DrawerThreadLoop (void *param)
+{
+	FDrawerThread *thread = (FDrawerThread *)param;
+
+	for (;;)
+	{
+		thread->Start.Wait();
+		if (QuitThreads)
+		{
+			break;
+		}
+		DrawSlice (thread->Slice);
+		ThreadsDone->Post();
+	}
+}
+
+//==========================================================================
+//
+// R_ShutdownDrawerThreads
+//
+//==========================================================================
+
+void R_ShutdownDrawerThreads ()
+{
+	int i;
+
+	QuitThreads = true;
+	for (i = 1; i < NumThreads; ++i)
+	{
+		Threads[i]->Start.Post();
+	}
+	for (i = 1; i < NumThreads; ++i)
+	{
+		Threads[i]->Thread.Join();
+		delete Threads[i];
+		Threads[i] = NULL;
+	}
+	NumThreads = 0;
+	ThreadsRequested = 0;
+	QuitThreads = false;
+	if (ThreadsDone != NULL)
+	{
+		delete ThreadsDone;
+		ThreadsDone = NULL;
+	}
+}
+
+//==========================================================================
+//
+// StartDrawerThreads
+//
+// Returns the number of threads that could be started, counting the
+// main thread.
+//
+//==========================================================================
+
+static int StartDrawerThreads (int count)
+{
+	if (count == ThreadsRequested)
+	{
+		return NumThreads;
+	}
+	R_ShutdownDrawerThreads ();
+	ThreadsRequested = count;
+	if (count <= 1)
+	{
+		return 1;
+	}
+
+	ThreadsDone = new FWorkerSemaphore;
+	for (NumThreads = 1; NumThreads < count; ++NumThreads)
+	{
+		FDrawerThread *thread = new FDrawerThread;
+
+		thread->Slice = NumThreads;
+		if (!thread->Thread.Start (DrawerThreadLoop, thread))
+		{
+			delete thread;
+			break;
+		}
+		Threads[NumThreads] = thread;
+	}
+	return NumThreads;
+}
+
+//==========================================================================
+//
+// R_BeginDrawerQueue
+//
+//==========================================================================
+
+void R_BeginDrawerQueue ()
+{
+	R_EndDrawerQueue ();
+
+	FrameCommands = FrameFlushes = 0;
+	// The true color drawers read back what the paletted ones drew, so
+	// they cannot be queued.
+	if (!TrueColorActive && StartDrawerThreads (r_multithreaded) > 1)
+	{
+		// wallscan draws groups of four columns, so keep each group in one slice.
+		NumSlices = NumThreads;
+		SliceWidth = ((viewwidth + NumSlices - 1) / NumSlices + 3) & ~3;
+		QueuePitch = dc_pitch;
+		DrawerQueueActive = true;
+	}
+}
+
+//==========================================================================
+//
+// R_FinishDrawerQueue
+//
+//==========================================================================
+
+void R_FinishDrawerQueue ()
+{
+	if (Commands.Size() == 0)
+	{
+		return;
+	}
+
+	int i;
+
+	for (i = 1; i < NumThreads; ++i)
+	{
+		Threads[i]->Start.Post();
+	}
+	DrawSlice (0);
+	for (i = 1; i < NumThreads; ++i)
+	{
+		ThreadsDone->Wait();
+	}
+
+	FrameCommands += Commands.Size();
+	FrameFlushes++;
+	Commands.Clear();
+}
+
+//==========================================================================
+//
+// R_EndDrawerQueue
+//
+//==========================================================================
+
+void R_EndDrawerQueue ()
+{
+	R_FinishDrawerQueue ();
+	DrawerQueueActive = false;
+}
+
+//==========================================================================
+//
+// R_QueueVLine1
+//
+// Returns the texture position after the column like dovline1 does.
+//
+//==========================================================================
+
+DWORD STACK_ARGS R_QueueVLine1 ()
+{
+	FDrawerCommand &cmd = Commands[Commands.Reserve(1)];
+
+	cmd.Type = DC_VLine1;
+	cmd.Bits = vlinebits;
+	cmd.X = int(dc_dest - dc_destorg) % QueuePitch;
+	cmd.Count = dc_count;
+	cmd.Dest = dc_dest;
+	cmd.Source[0] = dc_source;
+	cmd.Colormap[0] = dc_colormap;
+	cmd.Frac[0] = dc_texturefrac;
+	cmd.Step[0] = dc_iscale;
+	return dc_texturefrac + DWORD(dc_iscale) * dc_count;
+}
+
+//==========================================================================
+//
+// R_QueueVLine4
+//
+//==========================================================================
+
+void STACK_ARGS R_QueueVLine4 ()
+{
+	FDrawerCommand &cmd = Commands[Commands.Reserve(1)];
+
+	cmd.Type = DC_VLine4;
+	cmd.Bits = vlinebits;
+	cmd.X = int(dc_dest - dc_destorg) % QueuePitch;
+	cmd.Count = dc_count;
+	cmd.Dest = dc_dest;
+	for (int z = 0; z < 4; ++z)
+	{
+		cmd.Source[z] = bufplce[z];
+		cmd.Colormap[z] = palookupoffse[z];
+		cmd.Frac[z] = vplce[z];
+		cmd.Step[z] = vince[z];
+		vplce[z] += vince[z] * dc_count;
+	}
+}
+
+//==========================================================================
+//
+// R_QueueSpan
+//
+//==========================================================================
+
+void R_QueueSpan ()
+{
+	FDrawerCommand &cmd = Commands[Commands.Reserve(1)];
+
+	cmd.Type = DC_Span;
+	cmd.Bits = ds_xbits;
+	cmd.YBits = ds_ybits;
+	cmd.X = ds_x1;
+	cmd.Count = ds_x2 - ds_x1 + 1;
+	cmd.Dest = ylookup[ds_y] + ds_x1 + dc_destorg;
+	cmd.Source[0] = ds_source;
+	cmd.Colormap[0] = ds_colormap;
+	cmd.Frac[0] = ds_xfrac;
+	cmd.Frac[1] = ds_yfrac;
+	cmd.Step[0] = ds_xstep;
+	cmd.Step[1] = ds_ystep;
+}
+
+ADD_STAT (drawers)
+{
+	FString out;
+	out.Format ("%d threads, %d commands in %d batches", MAX (NumThreads, 1), FrameCommands, FrameFlushes);
+	return out;
+}
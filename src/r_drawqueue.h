@@ -0,0 +1,63 @@
+/*
+** r_drawqueue.h
+** Queues the wall and flat drawers for the drawer threads
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 The GZ3Doom developers
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+
+#ifndef __R_DRAWQUEUE_H__
+#define __R_DRAWQUEUE_H__
+
+#include "doomtype.h"
+
+// While this is set, wallscan and R_MapPlane record what they draw
+// instead of drawing it. Anything else that draws to the view must call
+// R_FinishDrawerQueue first.
+extern bool DrawerQueueActive;
+
+// Starts queueing if r_multithreaded asks for more than one thread.
+void R_BeginDrawerQueue ();
+
+// Draws everything that has been queued so far, with each thread
+// drawing its own slice of columns, and waits until it is done.
+void R_FinishDrawerQueue ();
+
+// Draws what is left and stops queueing.
+void R_EndDrawerQueue ();
+
+void R_ShutdownDrawerThreads ();
+
+// These take their parameters from the same globals as dovline1,
+// dovline4 and R_DrawSpan do.
+DWORD STACK_ARGS R_QueueVLine1 ();
+void STACK_ARGS R_QueueVLine4 ();
+void R_QueueSpan ();
+
+#endif
@@ -45,6 +45,7 @@
 #include "r_draw.h"
 #include "r_main.h"
 #include "r_things.h"
+#include "r_drawbgra.h"
 #include "v_video.h"
 
 // I should have commented this stuff better.
@@ -1178,6 +1179,7 @@ void R_DrawMaskedColumnHoriz (const BYTE *column, const FTexture::Span *span)
 			dc_source = column + top;
 			dc_dest = ylookup[dc_yl] + dc_x + dc_destorg;
 			dc_count = dc_yh - dc_yl + 1;
+			R_ReleaseTrueColorColumn (dc_dest, dc_count);
 			hcolfunc_pre ();
 		}
 nextpost:
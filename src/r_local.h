@@ -37,5 +37,7 @@
 #include "r_main.h"
 #include "r_things.h"
 #include "r_draw.h"
+#include "r_drawqueue.h"
+#include "r_drawbgra.h"
 
 #endif // __R_LOCAL_H__
@@ -441,6 +441,7 @@ void R_InitRenderer()
 	R_InitPlanes ();
 	R_InitShadeMaps();
 	R_InitColumnDrawers ();
+	R_InitTrueColor ();
 
 	colfunc = basecolfunc = R_DrawColumn;
 	fuzzcolfunc = R_DrawFuzzColumn;
@@ -461,6 +462,7 @@ void R_InitRenderer()
 
 static void R_ShutdownRenderer()
 {
+	R_ShutdownDrawerThreads();
 	R_DeinitSprites();
 	R_DeinitPlanes();
 	// Free openings
@@ -749,6 +751,8 @@ void R_RenderActorView (AActor *actor, bool dontmaplines)
 
 	R_SetupBuffer ();
 	R_SetupFrame (actor);
+	R_BeginTrueColorFrame ();
+	R_BeginDrawerQueue ();
 
 	// Clear buffers.
 	R_ClearClipSegs (0, viewwidth);
@@ -801,6 +805,7 @@ void R_RenderActorView (AActor *actor, bool dontmaplines)
 	R_RenderBSPNode (nodes + numnodes - 1);	// The head node is the last node output.
 	R_3D_ResetClip(); // reset clips (floor/ceiling)
 	camera->renderflags = savedflags;
+	R_FinishDrawerQueue ();
 	WallCycles.Unclock();
 
 	NetUpdate ();
@@ -810,6 +815,7 @@ void R_RenderActorView (AActor *actor, bool dontmaplines)
 		PlaneCycles.Clock();
 		R_DrawPlanes ();
 		R_DrawSkyBoxes ();
+		R_FinishDrawerQueue ();
 		PlaneCycles.Unclock();
 
 		// [RH] Walk through mirrors
@@ -827,6 +833,8 @@ void R_RenderActorView (AActor *actor, bool dontmaplines)
 
 		NetUpdate ();
 	}
+	R_EndDrawerQueue ();
+	R_EndTrueColorFrame ();
 	WallMirrors.Clear ();
 	interpolator.RestoreInterpolations ();
 	R_SetupBuffer ();
@@ -123,6 +123,10 @@ short					ceilingclip[MAXWIDTH];
 
 static fixed_t			planeheight;
 
+// Per-frame plane statistics
+static int				vpdrawn, vpmerged, vpspans;
+static TArray<visplane_t *> vpsorted;
+
 extern "C" {
 //
 // spanend holds the end of a plane span in each screen row
@@ -225,7 +229,7 @@ void R_MapPlane (int y, int x1)
 	if (plane_shade)
 	{
 		// Determine lighting based on the span's distance from the viewer.
-		ds_colormap = basecolormap->Maps + (GETPALOOKUP (
+		ds_colormap = basecolormap->GetMaps() + (GETPALOOKUP (
 			FixedMul (GlobVis, abs (centeryfrac - (y << FRACBITS))), planeshade) << COLORMAPSHIFT);
 	}
 
@@ -238,6 +242,24 @@ void R_MapPlane (int y, int x1)
 	ds_x1 = x1;
 	ds_x2 = x2;
 
+	if (TrueColorActive)
+	{
+		R_DrawTrueColorSpan (R_TrueColorFade (
+			FixedMul (GlobVis, abs (centeryfrac - (y << FRACBITS))), planeshade));
+		spanfunc ();
+		R_KeyTrueColorSpan ();
+		return;
+	}
+
+	if (DrawerQueueActive)
+	{
+		if (spanfunc == R_DrawSpan)
+		{
+			R_QueueSpan ();
+			return;
+		}
+		R_FinishDrawerQueue ();
+	}
 	spanfunc ();
 }
 
@@ -255,7 +277,7 @@ void STACK_ARGS R_CalcTiltedLighting (fixed_t lval, fixed_t lend, int width)
 {
 	fixed_t lstep;
 	BYTE *lightfiller;
-	BYTE *basecolormapdata = basecolormap->Maps;
+	BYTE *basecolormapdata = basecolormap->GetMaps();
 	int i = 0;
 
 	if (width == 0 || lval == lend)
@@ -376,6 +398,7 @@ void R_MapTiltedPlane (int y, int x1)
 	vz = plane_sv[2] + plane_sv[1]*(centery-y) + plane_sv[0]*(x1-centerx);
 
 	fb = ylookup[y] + x1 + dc_destorg;
+	R_ReleaseTrueColorRect (fb, spanend[y] - x1 + 1, 1);
 
 	BYTE vshift = 32 - ds_ybits;
 	BYTE ushift = vshift - ds_xbits;
@@ -486,6 +509,7 @@ void R_MapTiltedPlane (int y, int x1)
 void R_MapColoredPlane (int y, int x1)
 {
 	memset (ylookup[y] + x1 + dc_destorg, ds_color, spanend[y] - x1 + 1);
+	R_ReleaseTrueColorRect (ylookup[y] + x1 + dc_destorg, spanend[y] - x1 + 1, 1);
 }
 
 //==========================================================================
@@ -540,6 +564,8 @@ void R_ClearPlanes (bool fullclear)
 			? (ConBottom - viewwindowy) : 0);
 
 		lastopening = 0;
+
+		vpdrawn = vpmerged = vpspans = 0;
 	}
 }
 
@@ -728,10 +754,43 @@ visplane_t *R_FindPlane (const secplane_t &height, FTextureID picnum, int lightl
 	return check;
 }
 
+//==========================================================================
+//
+// R_SamePlane
+//
+// Returns true if two visplanes only differ in the columns they cover.
+//
+//==========================================================================
+
+static bool R_SamePlane (const visplane_t *a, const visplane_t *b)
+{
+	return a->height == b->height &&
+		a->picnum == b->picnum &&
+		a->lightlevel == b->lightlevel &&
+		a->xoffs == b->xoffs &&
+		a->yoffs == b->yoffs &&
+		a->xscale == b->xscale &&
+		a->yscale == b->yscale &&
+		a->angle == b->angle &&
+		a->colormap == b->colormap &&
+		a->skybox == b->skybox &&
+		a->sky == b->sky &&
+		a->Alpha == b->Alpha &&
+		a->Additive == b->Additive &&
+		a->CurrentMirror == b->CurrentMirror &&
+		a->MirrorFlags == b->MirrorFlags &&
+		a->CurrentSkybox == b->CurrentSkybox;
+}
+
 //==========================================================================
 //
 // R_CheckPlane
 //
+// If the columns are already in use, the plane continues in another
+// visplane with the same parameters. An existing one that is still free
+// in this range is reused before a new one is made, so that its spans
+// join up with the ones already there when the planes are drawn.
+//
 //==========================================================================
 
 visplane_t *R_CheckPlane (visplane_t *pl, int start, int stop)
@@ -786,6 +845,27 @@ visplane_t *R_CheckPlane (visplane_t *pl, int start, int stop)
 		else
 		{
 			hash = visplane_hash (pl->picnum.GetIndex(), pl->lightlevel, pl->height);
+
+			// Sky box planes are each rendered as their own view, so only
+			// regular planes can be merged.
+			for (visplane_t *check = visplanes[hash]; check != NULL; check = check->next)
+			{
+				if (check == pl || !R_SamePlane (check, pl))
+					continue;
+
+				intrl = MAX (start, check->minx);
+				intrh = MIN (stop, check->maxx);
+				for (x = intrl; x <= intrh && check->top[x] == 0x7fff; x++)
+					;
+
+				if (x > intrh)
+				{
+					check->minx = MIN (start, check->minx);
+					check->maxx = MAX (stop, check->maxx);
+					vpmerged++;
+					return check;
+				}
+			}
 		}
 		visplane_t *new_pl = new_visplane (hash);
 
@@ -953,6 +1033,15 @@ static void R_DrawSky (visplane_t *pl)
 	rw_pic = frontskytex;
 	rw_offset = 0;
 
+	// Two-layer skies are composited into skybuf, which only holds four
+	// columns at a time, so they cannot be queued.
+	bool queued = DrawerQueueActive;
+	if (queued && backskytex != NULL)
+	{
+		R_FinishDrawerQueue ();
+		DrawerQueueActive = false;
+	}
+
 	frontyScale = rw_pic->yScale;
 	dc_texturemid = MulScale16 (skymid, frontyScale);
 
@@ -979,6 +1068,7 @@ static void R_DrawSky (visplane_t *pl)
 		}
 		R_DrawSkyStriped (pl);
 	}
+	DrawerQueueActive = queued;
 }
 
 static void R_DrawSkyStriped (visplane_t *pl)
@@ -1031,14 +1121,30 @@ static void R_DrawSkyStriped (visplane_t *pl)
 CVAR (Bool, tilt, false, 0);
 //CVAR (Int, pa, 0, 0)
 
+static int STACK_ARGS R_SortPlanes (const void *a, const void *b)
+{
+	const visplane_t *pa = *(const visplane_t **)a;
+	const visplane_t *pb = *(const visplane_t **)b;
+
+	if (pa->picnum != pb->picnum)
+	{
+		return pa->picnum.GetIndex() - pb->picnum.GetIndex();
+	}
+	return pa->lightlevel - pb->lightlevel;
+}
+
 int R_DrawPlanes ()
 {
 	visplane_t *pl;
 	int i;
-	int vpcount = 0;
+	int vpcount;
 
 	ds_color = 3;
 
+	// Opaque planes never overlap, so they can be drawn in any order. Group
+	// them by texture and light level so that consecutive planes share
+	// their texture data.
+	vpsorted.Clear ();
 	for (i = 0; i < MAXVISPLANES; i++)
 	{
 		for (pl = visplanes[i]; pl; pl = pl->next)
@@ -1048,11 +1154,20 @@ int R_DrawPlanes ()
 				continue;
 			// kg3D - draw only real planes now
 			if(pl->sky >= 0) {
-				vpcount++;
-				R_DrawSinglePlane (pl, OPAQUE, false, false);
+				vpsorted.Push (pl);
 			}
 		}
 	}
+	vpcount = vpsorted.Size();
+	if (vpcount > 1)
+	{
+		qsort (&vpsorted[0], vpcount, sizeof(visplane_t *), R_SortPlanes);
+	}
+	for (i = 0; i < vpcount; i++)
+	{
+		R_DrawSinglePlane (vpsorted[i], OPAQUE, false, false);
+	}
+	vpdrawn += vpcount;
 	return vpcount;
 }
 
@@ -1101,6 +1216,7 @@ void R_DrawSinglePlane (visplane_t *pl, fixed_t alpha, bool additive, bool maske
 	if (r_drawflat)
 	{ // [RH] no texture mapping
 		ds_color += 4;
+		R_FinishDrawerQueue ();
 		R_MapVisPlane (pl, R_MapColoredPlane);
 	}
 	else if (pl->picnum == skyflatnum)
@@ -1138,6 +1254,7 @@ void R_DrawSinglePlane (visplane_t *pl, fixed_t alpha, bool additive, bool maske
 		}
 		else
 		{
+			R_FinishDrawerQueue ();
 			R_DrawTiltedPlane (pl, alpha, additive, masked);
 		}
 	}
@@ -1368,6 +1485,13 @@ ADD_STAT(skyboxes)
 	return out;
 }
 
+ADD_STAT(planes)
+{
+	FString out;
+	out.Format ("%d visplanes, %d merged, %d spans", vpdrawn, vpmerged, vpspans);
+	return out;
+}
+
 //==========================================================================
 //
 // R_DrawSkyPlane
@@ -1550,7 +1674,7 @@ void R_DrawNormalPlane (visplane_t *pl, fixed_t alpha, bool additive, bool maske
 
 	GlobVis = FixedDiv (r_FloorVisibility, planeheight);
 	if (fixedlightlev >= 0)
-		ds_colormap = basecolormap->Maps + fixedlightlev, plane_shade = false;
+		ds_colormap = basecolormap->GetMaps() + fixedlightlev, plane_shade = false;
 	else if (fixedcolormap)
 		ds_colormap = fixedcolormap, plane_shade = false;
 	else
@@ -1603,6 +1727,20 @@ void R_DrawNormalPlane (visplane_t *pl, fixed_t alpha, bool additive, bool maske
 			}
 		}
 	}
+	if (TrueColorActive)
+	{
+		int style = TCS_Opaque;
+		if (spanfunc == R_FillSpan || masked)
+		{
+			style = TCS_None;
+		}
+		else if (alpha < OPAQUE || additive)
+		{
+			style = additive ? TCS_Add : TCS_Translucent;
+		}
+		R_SetTrueColorColormap (basecolormap);
+		R_SetupTrueColorSpan (TexMan(pl->picnum, true), style, alpha);
+	}
 	R_MapVisPlane (pl, R_MapPlane);
 }
 
@@ -1706,11 +1844,11 @@ void R_DrawTiltedPlane (visplane_t *pl, fixed_t alpha, bool additive, bool maske
 		planelightfloat = -planelightfloat;
 
 	if (fixedlightlev >= 0)
-		ds_colormap = basecolormap->Maps + fixedlightlev, plane_shade = false;
+		ds_colormap = basecolormap->GetMaps() + fixedlightlev, plane_shade = false;
 	else if (fixedcolormap)
 		ds_colormap = fixedcolormap, plane_shade = false;
 	else
-		ds_colormap = basecolormap->Maps, plane_shade = true;
+		ds_colormap = basecolormap->GetMaps(), plane_shade = true;
 
 	if (!plane_shade)
 	{
@@ -1744,6 +1882,7 @@ void R_MapVisPlane (visplane_t *pl, void (*mapfunc)(int y, int x1))
 	int x = pl->maxx;
 	int t2 = pl->top[x];
 	int b2 = pl->bottom[x];
+	int spans = 0;
 
 	if (b2 > t2)
 	{
@@ -1762,11 +1901,13 @@ void R_MapVisPlane (visplane_t *pl, void (*mapfunc)(int y, int x1))
 		while (t2 < stop)
 		{
 			mapfunc (t2++, xr);
+			spans++;
 		}
 		stop = MAX (b1, t2);
 		while (b2 > stop)
 		{
 			mapfunc (--b2, xr);
+			spans++;
 		}
 
 		// Mark any spans that have just opened
@@ -1790,7 +1931,9 @@ void R_MapVisPlane (visplane_t *pl, void (*mapfunc)(int y, int x1))
 	while (t2 < b2)
 	{
 		mapfunc (--b2, pl->minx);
+		spans++;
 	}
+	vpspans += spans;
 }
 
 //==========================================================================
@@ -162,6 +162,7 @@ inline bool IsFogBoundary (sector_t *front, sector_t *back)
 //=============================================================================
 
 CVAR(Bool, r_drawmirrors, true, 0)
+CVAR(Bool, r_wallmips, false, CVAR_ARCHIVE)
 
 //
 // R_RenderMaskedSegRange
@@ -176,7 +177,7 @@ static void BlastMaskedColumn (void (*blastfunc)(const BYTE *pixels, const FText
 		// calculate lighting
 		if (fixedcolormap == NULL && fixedlightlev < 0)
 		{
-			dc_colormap = basecolormap->Maps + (GETPALOOKUP (rw_light, wallshade) << COLORMAPSHIFT);
+			dc_colormap = basecolormap->GetMaps() + (GETPALOOKUP (rw_light, wallshade) << COLORMAPSHIFT);
 		}
 
 		dc_iscale = MulScale18 (MaskedSWall[dc_x], MaskedScaleY);
@@ -344,7 +345,7 @@ void R_RenderMaskedSegRange (drawseg_t *ds, int x1, int x2)
 	}
 
 	if (fixedlightlev >= 0)
-		dc_colormap = basecolormap->Maps + fixedlightlev;
+		dc_colormap = basecolormap->GetMaps() + fixedlightlev;
 	else if (fixedcolormap != NULL)
 		dc_colormap = fixedcolormap;
 
@@ -583,7 +584,7 @@ void R_RenderFakeWall(drawseg_t *ds, int x1, int x2, F3DFloor *rover)
 	}
 
 	if (fixedlightlev >= 0)
-		dc_colormap = basecolormap->Maps + fixedlightlev;
+		dc_colormap = basecolormap->GetMaps() + fixedlightlev;
 	else if (fixedcolormap != NULL)
 		dc_colormap = fixedcolormap;
 
@@ -1030,44 +1031,103 @@ inline fixed_t prevline1 (fixed_t vince, BYTE *colormap, int count, fixed_t vplc
 	dc_texturefrac = vplce;
 	dc_source = bufplce;
 	dc_dest = dest;
-	return doprevline1 ();
+	return DrawerQueueActive ? R_QueueVLine1 () : doprevline1 ();
 }
 
-void wallscan (int x1, int x2, short *uwal, short *dwal, fixed_t *swal, fixed_t *lwal,
-			   fixed_t yrepeat, const BYTE *(*getcol)(FTexture *tex, int x))
+// Draws the columns wallscan just drew again with the true color drawer.
+static void wallscan_truecolor (int x1, int x2, short *uwal, short *dwal, fixed_t *swal, fixed_t *lwal,
+	fixed_t yrepeat, SDWORD texturemid, SDWORD xoffset, int shiftval)
+{
+	const BYTE *pixels = rw_pic->GetPixels ();
+	const DWORD *bgra = rw_pic->GetPixelsBgra ();
+	const BYTE *pixelsend = pixels + rw_pic->GetWidth() * rw_pic->GetHeight();
+	fixed_t light = rw_light;
+
+	R_SetTrueColorColormap (basecolormap);
+	for (int x = x1; x <= x2; ++x, light += rw_lightstep)
+	{
+		int y1 = uwal[x];
+		int y2 = dwal[x];
+		if (y2 <= y1) continue;
+
+		const BYTE *source = R_GetColumn (rw_pic, (lwal[x] + xoffset) >> FRACBITS);
+		if (source < pixels || source >= pixelsend) continue;
+
+		fixed_t iscale = swal[x] * yrepeat;
+		R_DrawTrueColorColumn (ylookup[y1] + x + dc_destorg, bgra + (source - pixels), y2 - y1,
+			texturemid + FixedMul (iscale, (y1<<FRACBITS)-centeryfrac+FRACUNIT), iscale,
+			32-shiftval, R_TrueColorFade (light, wallshade));
+	}
+}
+
+// Takes the pixels maskwallscan or transmaskwallscan just drew back for
+// the palette, so the true color walls behind them don't show through.
+static void maskwallscan_release (int x1, int x2, short *uwal, short *dwal, fixed_t *swal, fixed_t *lwal,
+	fixed_t yrepeat, SDWORD texturemid, SDWORD xoffset, int shiftval, const BYTE *(*getcol)(FTexture *tex, int x))
+{
+	for (int x = x1; x <= x2; ++x)
+	{
+		int y1 = uwal[x];
+		int y2 = dwal[x];
+		if (y2 <= y1) continue;
+
+		fixed_t iscale = swal[x] * yrepeat;
+		R_ReleaseTrueColorMasked (ylookup[y1] + x + dc_destorg, getcol (rw_pic, (lwal[x] + xoffset) >> FRACBITS),
+			y2 - y1, texturemid + FixedMul (iscale, (y1<<FRACBITS)-centeryfrac+FRACUNIT), iscale, 32-shiftval);
+	}
+}
+
+// The mip level R_GetMipColumn returns columns from
+static const BYTE *wallmip;
+static int wallmiplevel;
+
+static const BYTE *R_GetMipColumn (FTexture *tex, int col)
+{
+	int width = tex->GetWidth();
+	int widthmask = (1 << tex->WidthBits) - 1;
+
+	// Wrap the column the same way R_GetColumn and GetColumn do.
+	if (col < 0 && width != widthmask + 1)
+	{
+		col = width + (col % width);
+	}
+	unsigned int column = col;
+	if (column >= (unsigned)width)
+	{
+		column = (widthmask + 1 == width) ? column & widthmask : column % width;
+	}
+	return wallmip + (column >> wallmiplevel) * (tex->GetHeight() >> wallmiplevel);
+}
+
+// Draws columns x1 to x2 of a wall. miplevel is added to the texture
+// coordinate shift, so getcol must return columns from that mip level.
+static void wallscan_run (int x1, int x2, short *uwal, short *dwal, fixed_t *swal, fixed_t *lwal,
+	fixed_t yrepeat, const BYTE *(*getcol)(FTexture *tex, int x), fixed_t light, int miplevel)
 {
 	int x, shiftval;
 	int y1ve[4], y2ve[4], u4, d4, z;
 	char bad;
-	fixed_t light = rw_light - rw_lightstep;
 	SDWORD texturemid, xoffset;
 	BYTE *basecolormapdata;
 
-	// This function also gets used to draw skies. Unlike BUILD, skies are
-	// drawn by visplane instead of by bunch, so these checks are invalid.
-	//if ((uwal[x1] > viewheight) && (uwal[x2] > viewheight)) return;
-	//if ((dwal[x1] < 0) && (dwal[x2] < 0)) return;
-
-	if (rw_pic->UseType == FTexture::TEX_Null)
-	{
-		return;
-	}
+	light -= rw_lightstep;
 
 //extern cycle_t WallScanCycles;
 //clock (WallScanCycles);
 
-	rw_pic->GetHeight();	// Make sure texture size is loaded
 	shiftval = rw_pic->HeightBits;
-	setupvline (32-shiftval);
+	setupvline (32-shiftval+miplevel);
 	yrepeat >>= 2 + shiftval;
 	texturemid = dc_texturemid << (16 - shiftval);
 	xoffset = rw_offset;
-	basecolormapdata = basecolormap->Maps;
+	basecolormapdata = basecolormap->GetMaps();
 
 	x = x1;
 	//while ((umost[x] > dmost[x]) && (x <= x2)) x++;
 
 	bool fixed = (fixedcolormap != NULL || fixedlightlev >= 0);
+	DWORD (STACK_ARGS *vline1)() = DrawerQueueActive ? R_QueueVLine1 : dovline1;
+	void (STACK_ARGS *vline4)() = DrawerQueueActive ? R_QueueVLine4 : dovline4;
 	if (fixed)
 	{
 		palookupoffse[0] = dc_colormap;
@@ -1096,7 +1156,7 @@ void wallscan (int x1, int x2, short *uwal, short *dwal, fixed_t *swal, fixed_t
 		dc_count = y2ve[0] - y1ve[0];
 		dc_texturefrac = texturemid + FixedMul (dc_iscale, (y1ve[0]<<FRACBITS)-centeryfrac+FRACUNIT);
 
-		dovline1();
+		vline1();
 	}
 
 	for(; x <= x2-3; x += 4)
@@ -1157,7 +1217,7 @@ void wallscan (int x1, int x2, short *uwal, short *dwal, fixed_t *swal, fixed_t
 		{
 			dc_count = d4-u4;
 			dc_dest = ylookup[u4]+x+dc_destorg;
-			dovline4();
+			vline4();
 		}
 
 		BYTE *i = x+ylookup[d4]+dc_destorg;
@@ -1189,10 +1249,98 @@ void wallscan (int x1, int x2, short *uwal, short *dwal, fixed_t *swal, fixed_t
 		dc_count = y2ve[0] - y1ve[0];
 		dc_texturefrac = texturemid + FixedMul (dc_iscale, (y1ve[0]<<FRACBITS)-centeryfrac+FRACUNIT);
 
-		dovline1();
+		vline1();
+	}
+
+	// Skies come from other getcol functions and stay paletted.
+	if (TrueColorActive && getcol == R_GetColumn)
+	{
+		wallscan_truecolor (x1, x2, uwal, dwal, swal, lwal, yrepeat, texturemid, xoffset, shiftval);
 	}
 
 //unclock (WallScanCycles);
+}
+
+// Splits the wall into runs of columns that use the same mip level. The
+// level comes from how many texels a screen pixel steps over vertically.
+static void wallscan_mipmapped (int x1, int x2, short *uwal, short *dwal, fixed_t *swal, fixed_t *lwal,
+	fixed_t yrepeat, int maxlevel)
+{
+	int shiftval = rw_pic->HeightBits;
+	fixed_t yrep = yrepeat >> (2 + shiftval);
+	int start = x1;
+	int level = -1;
+
+	for (int x = x1; x <= x2 + 1; ++x)
+	{
+		int thislevel = -1;
+
+		if (x <= x2)
+		{
+			DWORD step = DWORD(abs (swal[x] * yrep)) >> (32 - shiftval);
+
+			thislevel = 0;
+			while (thislevel < maxlevel && step >= (2u << thislevel))
+			{
+				thislevel++;
+			}
+		}
+		if (thislevel == level)
+		{
+			continue;
+		}
+		if (level == 0)
+		{
+			wallscan_run (start, x - 1, uwal, dwal, swal, lwal, yrepeat, R_GetColumn,
+				rw_light + (start - x1) * rw_lightstep, 0);
+		}
+		else if (level > 0)
+		{
+			wallmip = rw_pic->GetMipmap (level);
+			wallmiplevel = level;
+			wallscan_run (start, x - 1, uwal, dwal, swal, lwal, yrepeat, R_GetMipColumn,
+				rw_light + (start - x1) * rw_lightstep, level);
+		}
+		start = x;
+		level = thislevel;
+	}
+}
+
+void wallscan (int x1, int x2, short *uwal, short *dwal, fixed_t *swal, fixed_t *lwal,
+			   fixed_t yrepeat, const BYTE *(*getcol)(FTexture *tex, int x))
+{
+	// This function also gets used to draw skies. Unlike BUILD, skies are
+	// drawn by visplane instead of by bunch, so these checks are invalid.
+	//if ((uwal[x1] > viewheight) && (uwal[x2] > viewheight)) return;
+	//if ((dwal[x1] < 0) && (dwal[x2] < 0)) return;
+
+	if (rw_pic->UseType == FTexture::TEX_Null)
+	{
+		return;
+	}
+
+	rw_pic->GetHeight();	// Make sure texture size is loaded
+
+	// Distant walls can use a smaller copy of the texture, which is quicker
+	// to read and does not shimmer. Skies and true color stay full size.
+	int maxlevel = 0;
+	if (r_wallmips && getcol == R_GetColumn && !TrueColorActive)
+	{
+		maxlevel = FTexture::MAX_MIPLEVEL;
+		while (maxlevel > 0 && rw_pic->GetMipmap (maxlevel) == NULL)
+		{
+			maxlevel--;
+		}
+	}
+
+	if (maxlevel > 0)
+	{
+		wallscan_mipmapped (x1, x2, uwal, dwal, swal, lwal, yrepeat, maxlevel);
+	}
+	else
+	{
+		wallscan_run (x1, x2, uwal, dwal, swal, lwal, yrepeat, getcol, rw_light, 0);
+	}
 
 	NetUpdate ();
 }
@@ -1399,6 +1547,8 @@ void maskwallscan (int x1, int x2, short *uwal, short *dwal, fixed_t *swal, fixe
 		return;
 	}
 
+	R_FinishDrawerQueue ();
+
 //extern cycle_t WallScanCycles;
 //clock (WallScanCycles);
 
@@ -1408,7 +1558,7 @@ void maskwallscan (int x1, int x2, short *uwal, short *dwal, fixed_t *swal, fixe
 	yrepeat >>= 2 + shiftval;
 	texturemid = dc_texturemid << (16 - shiftval);
 	xoffset = rw_offset;
-	basecolormapdata = basecolormap->Maps;
+	basecolormapdata = basecolormap->GetMaps();
 
 	x = startx = x1;
 	p = x + dc_destorg;
@@ -1532,6 +1682,11 @@ void maskwallscan (int x1, int x2, short *uwal, short *dwal, fixed_t *swal, fixe
 		domvline1();
 	}
 
+	if (TrueColorActive)
+	{
+		maskwallscan_release (x1, x2, uwal, dwal, swal, lwal, yrepeat, texturemid, xoffset, shiftval, getcol);
+	}
+
 //unclock(WallScanCycles);
 
 	NetUpdate ();
@@ -1572,6 +1727,8 @@ void transmaskwallscan (int x1, int x2, short *uwal, short *dwal, fixed_t *swal,
 		return;
 	}
 
+	R_FinishDrawerQueue ();
+
 //extern cycle_t WallScanCycles;
 //clock (WallScanCycles);
 
@@ -1581,7 +1738,7 @@ void transmaskwallscan (int x1, int x2, short *uwal, short *dwal, fixed_t *swal,
 	yrepeat >>= 2 + shiftval;
 	texturemid = dc_texturemid << (16 - shiftval);
 	xoffset = rw_offset;
-	basecolormapdata = basecolormap->Maps;
+	basecolormapdata = basecolormap->GetMaps();
 
 	x = startx = x1;
 	p = x + dc_destorg;
@@ -1708,6 +1865,11 @@ void transmaskwallscan (int x1, int x2, short *uwal, short *dwal, fixed_t *swal,
 		tmvline1();
 	}
 
+	if (TrueColorActive)
+	{
+		maskwallscan_release (x1, x2, uwal, dwal, swal, lwal, yrepeat, texturemid, xoffset, shiftval, getcol);
+	}
+
 //unclock(WallScanCycles);
 
 	NetUpdate ();
@@ -1732,7 +1894,7 @@ void R_RenderSegLoop ()
 	fixed_t xoffset = rw_offset;
 
 	if (fixedlightlev >= 0)
-		dc_colormap = basecolormap->Maps + fixedlightlev;
+		dc_colormap = basecolormap->GetMaps() + fixedlightlev;
 	else if (fixedcolormap != NULL)
 		dc_colormap = fixedcolormap;
 
@@ -2576,6 +2738,10 @@ void R_StoreWallRange (int start, int stop)
 	}
 
 	// [RH] Draw any decals bound to the seg
+	if (curline->sidedef->AttachedDecals != NULL)
+	{ // Decals are drawn directly, on top of the queued wall.
+		R_FinishDrawerQueue ();
+	}
 	for (DBaseDecal *decal = curline->sidedef->AttachedDecals; decal != NULL; decal = decal->WallNext)
 	{
 		R_RenderDecal (curline->sidedef, decal, ds_p, 0);
@@ -3149,11 +3315,11 @@ static void R_RenderDecal (side_t *wall, DBaseDecal *decal, drawseg_t *clipper,
 
 	rw_light = rw_lightleft + (x1 - WallC.sx1) * rw_lightstep;
 	if (fixedlightlev >= 0)
-		dc_colormap = usecolormap->Maps + fixedlightlev;
+		dc_colormap = usecolormap->GetMaps() + fixedlightlev;
 	else if (fixedcolormap != NULL)
 		dc_colormap = fixedcolormap;
 	else if (!foggy && (decal->RenderFlags & RF_FULLBRIGHT))
-		dc_colormap = usecolormap->Maps;
+		dc_colormap = usecolormap->GetMaps();
 	else
 		calclighting = true;
 
@@ -3206,7 +3372,7 @@ static void R_RenderDecal (side_t *wall, DBaseDecal *decal, drawseg_t *clipper,
 			{
 				if (calclighting)
 				{ // calculate lighting
-					dc_colormap = usecolormap->Maps + (GETPALOOKUP (rw_light, wallshade) << COLORMAPSHIFT);
+					dc_colormap = usecolormap->GetMaps() + (GETPALOOKUP (rw_light, wallshade) << COLORMAPSHIFT);
 				}
 				R_WallSpriteColumn (R_DrawMaskedColumn);
 				dc_x++;
@@ -3216,7 +3382,7 @@ static void R_RenderDecal (side_t *wall, DBaseDecal *decal, drawseg_t *clipper,
 			{
 				if (calclighting)
 				{ // calculate lighting
-					dc_colormap = usecolormap->Maps + (GETPALOOKUP (rw_light, wallshade) << COLORMAPSHIFT);
+					dc_colormap = usecolormap->GetMaps() + (GETPALOOKUP (rw_light, wallshade) << COLORMAPSHIFT);
 				}
 				rt_initcols();
 				for (int zz = 4; zz; --zz)
@@ -3231,7 +3397,7 @@ static void R_RenderDecal (side_t *wall, DBaseDecal *decal, drawseg_t *clipper,
 			{
 				if (calclighting)
 				{ // calculate lighting
-					dc_colormap = usecolormap->Maps + (GETPALOOKUP (rw_light, wallshade) << COLORMAPSHIFT);
+					dc_colormap = usecolormap->GetMaps() + (GETPALOOKUP (rw_light, wallshade) << COLORMAPSHIFT);
 				}
 				R_WallSpriteColumn (R_DrawMaskedColumn);
 				dc_x++;
@@ -145,9 +145,16 @@ int 			newvissprite;
 bool			DrewAVoxel;
 
 static vissprite_t **spritesorter;
+static vissprite_t **spritesorttemp;
 static int spritesortersize = 0;
 static int vsprcount;
 
+// Drawsegs that can clip sprites, binned by screen column so that a sprite
+// only has to check the drawsegs that overlap the columns it covers.
+#define DSBINSHIFT		5
+static TArray<int>		DrawsegBins[(MAXWIDTH >> DSBINSHIFT) + 1];
+static TArray<int>		DrawsegCandidates;
+
 static void R_ProjectWallSprite(AActor *thing, fixed_t fx, fixed_t fy, fixed_t fz, FTextureID picnum, fixed_t xscale, fixed_t yscale, INTBOOL flip);
 
 
@@ -167,8 +174,10 @@ void R_DeinitSprites()
 	if (spritesorter != NULL)
 	{
 		delete[] spritesorter;
+		delete[] spritesorttemp;
 		spritesortersize = 0;
 		spritesorter = NULL;
+		spritesorttemp = NULL;
 	}
 
 	// Free offscreen buffer
@@ -310,6 +319,7 @@ void R_DrawMaskedColumn (const BYTE *column, const FTexture::Span *span)
 			dc_source = column + top;
 			dc_dest = ylookup[dc_yl] + dc_x + dc_destorg;
 			dc_count = dc_yh - dc_yl + 1;
+			R_ReleaseTrueColorColumn (dc_dest, dc_count);
 			colfunc ();
 		}
 nextpost:
@@ -446,11 +456,11 @@ void R_DrawWallSprite(vissprite_t *spr)
 	rw_lightstep = (SafeDivScale12(GlobVis, spr->wallc.sz2) - rw_lightleft) / (spr->wallc.sx2 - spr->wallc.sx1);
 	rw_light = rw_lightleft + (x1 - spr->wallc.sx1) * rw_lightstep;
 	if (fixedlightlev >= 0)
-		dc_colormap = usecolormap->Maps + fixedlightlev;
+		dc_colormap = usecolormap->GetMaps() + fixedlightlev;
 	else if (fixedcolormap != NULL)
 		dc_colormap = fixedcolormap;
 	else if (!foggy && (spr->renderflags & RF_FULLBRIGHT))
-		dc_colormap = usecolormap->Maps;
+		dc_colormap = usecolormap->GetMaps();
 	else
 		calclighting = true;
 
@@ -502,7 +512,7 @@ void R_DrawWallSprite(vissprite_t *spr)
 		{
 			if (calclighting)
 			{ // calculate lighting
-				dc_colormap = usecolormap->Maps + (GETPALOOKUP (rw_light, shade) << COLORMAPSHIFT);
+				dc_colormap = usecolormap->GetMaps() + (GETPALOOKUP (rw_light, shade) << COLORMAPSHIFT);
 			}
 			R_WallSpriteColumn(R_DrawMaskedColumn);
 			dc_x++;
@@ -512,7 +522,7 @@ void R_DrawWallSprite(vissprite_t *spr)
 		{
 			if (calclighting)
 			{ // calculate lighting
-				dc_colormap = usecolormap->Maps + (GETPALOOKUP (rw_light, shade) << COLORMAPSHIFT);
+				dc_colormap = usecolormap->GetMaps() + (GETPALOOKUP (rw_light, shade) << COLORMAPSHIFT);
 			}
 			rt_initcols();
 			for (int zz = 4; zz; --zz)
@@ -527,7 +537,7 @@ void R_DrawWallSprite(vissprite_t *spr)
 		{
 			if (calclighting)
 			{ // calculate lighting
-				dc_colormap = usecolormap->Maps + (GETPALOOKUP (rw_light, shade) << COLORMAPSHIFT);
+				dc_colormap = usecolormap->GetMaps() + (GETPALOOKUP (rw_light, shade) << COLORMAPSHIFT);
 			}
 			R_WallSpriteColumn(R_DrawMaskedColumn);
 			dc_x++;
@@ -600,6 +610,7 @@ void R_DrawVisVoxel(vissprite_t *spr, int minslabz, int maxslabz, short *cliptop
 			}
 			for (FCoverageBuffer::Span *span = OffscreenCoverageBuffer->Spans[x]; span != NULL; span = span->NextSpan)
 			{
+				R_ReleaseTrueColorColumn (ylookup[span->Start] + x + dc_destorg, span->Stop - span->Start);
 				if (flags & DVF_SPANSONLY)
 				{
 					dc_x = x;
@@ -1019,17 +1030,17 @@ void R_ProjectSprite (AActor *thing, int fakeside, F3DFloor *fakefloor, F3DFloor
 		}
 		if (fixedlightlev >= 0)
 		{
-			vis->Style.colormap = mybasecolormap->Maps + fixedlightlev;
+			vis->Style.colormap = mybasecolormap->GetMaps() + fixedlightlev;
 		}
 		else if (!foggy && ((thing->renderflags & RF_FULLBRIGHT) || (thing->flags5 & MF5_BRIGHT)))
 		{ // full bright
-			vis->Style.colormap = mybasecolormap->Maps;
+			vis->Style.colormap = mybasecolormap->GetMaps();
 		}
 		else
 		{ // diminished light
 			vis->ColormapNum = GETPALOOKUP(
 				(fixed_t)DivScale12 (r_SpriteVisibility, MAX(tz, MINZ)), spriteshade);
-			vis->Style.colormap = mybasecolormap->Maps + (vis->ColormapNum << COLORMAPSHIFT);
+			vis->Style.colormap = mybasecolormap->GetMaps() + (vis->ColormapNum << COLORMAPSHIFT);
 		}
 	}
 }
@@ -1104,7 +1115,7 @@ static void R_ProjectWallSprite(AActor *thing, fixed_t fx, fixed_t fy, fixed_t f
 	vis->bWallSprite = true;
 	vis->ColormapNum = GETPALOOKUP(
 		(fixed_t)DivScale12 (r_SpriteVisibility, MAX(tz, MINZ)), spriteshade);
-	vis->Style.colormap = basecolormap->Maps + (vis->ColormapNum << COLORMAPSHIFT);
+	vis->Style.colormap = basecolormap->GetMaps() + (vis->ColormapNum << COLORMAPSHIFT);
 	vis->wallc = wallc;
 }
 
@@ -1318,15 +1329,15 @@ void R_DrawPSprite (pspdef_t* psp, int pspnum, AActor *owner, fixed_t sx, fixed_
 			}
 			if (fixedlightlev >= 0)
 			{
-				vis->Style.colormap = mybasecolormap->Maps + fixedlightlev;
+				vis->Style.colormap = mybasecolormap->GetMaps() + fixedlightlev;
 			}
 			else if (!foggy && psp->state->GetFullbright())
 			{ // full bright
-				vis->Style.colormap = mybasecolormap->Maps;	// [RH] use basecolormap
+				vis->Style.colormap = mybasecolormap->GetMaps();	// [RH] use basecolormap
 			}
 			else
 			{ // local light
-				vis->Style.colormap = mybasecolormap->Maps + (GETPALOOKUP (0, spriteshade) << COLORMAPSHIFT);
+				vis->Style.colormap = mybasecolormap->GetMaps() + (GETPALOOKUP (0, spriteshade) << COLORMAPSHIFT);
 			}
 		}
 		if (camera->Inventory != NULL)
@@ -1345,8 +1356,8 @@ void R_DrawPSprite (pspdef_t* psp, int pspnum, AActor *owner, fixed_t sx, fixed_
 				}
 				// Has the basecolormap changed? If so, we can't hardware accelerate it,
 				// since we don't know what it is anymore.
-				else if (vis->Style.colormap < mybasecolormap->Maps ||
-					vis->Style.colormap >= mybasecolormap->Maps + NUMCOLORMAPS*256)
+				else if (vis->Style.colormap < mybasecolormap->GetMaps() ||
+					vis->Style.colormap >= mybasecolormap->GetMaps() + NUMCOLORMAPS*256)
 				{
 					noaccel = true;
 				}
@@ -1372,7 +1383,7 @@ void R_DrawPSprite (pspdef_t* psp, int pspnum, AActor *owner, fixed_t sx, fixed_
 	else
 	{
 		VisPSpritesBaseColormap[pspnum] = basecolormap;
-		vis->Style.colormap = basecolormap->Maps;
+		vis->Style.colormap = basecolormap->GetMaps();
 		vis->Style.RenderStyle = STYLE_Normal;
 	}
 
@@ -1527,7 +1538,7 @@ void R_DrawRemainingPlayerSprites()
 				colormap->Desaturate == 0)
 			{
 				overlay = colormap->Fade;
-				overlay.a = BYTE(((vis->Style.colormap - colormap->Maps) >> 8) * 255 / NUMCOLORMAPS);
+				overlay.a = BYTE(((vis->Style.colormap - colormap->GetMaps()) >> 8) * 255 / NUMCOLORMAPS);
 			}
 			else
 			{
@@ -1535,7 +1546,7 @@ void R_DrawRemainingPlayerSprites()
 				colormapstyle.Color = colormap->Color;
 				colormapstyle.Fade = colormap->Fade;
 				colormapstyle.Desaturate = colormap->Desaturate;
-				colormapstyle.FadeLevel = ((vis->Style.colormap - colormap->Maps) >> 8) / float(NUMCOLORMAPS);
+				colormapstyle.FadeLevel = ((vis->Style.colormap - colormap->GetMaps()) >> 8) / float(NUMCOLORMAPS);
 			}
 			screen->DrawTexture(vis->pic,
 				viewwindowx + VisPSpritesX1[i],
@@ -1730,6 +1741,66 @@ static void swap(vissprite_t *&a, vissprite_t *&b)
 }
 #endif
 
+//==========================================================================
+//
+// R_RadixSortVisSprites
+//
+// Stable LSD radix sort of spritesorter by descending idepth. This gives
+// the same order as a stable sort with sv_compare.
+//
+//==========================================================================
+
+static inline DWORD R_DepthKey (const vissprite_t *spr)
+{
+	// Map the signed depth to an unsigned key that rises as idepth falls.
+	return ~(DWORD(spr->idepth) ^ 0x80000000u);
+}
+
+static void R_RadixSortVisSprites ()
+{
+	static int counts[3][2048];
+	vissprite_t **src = spritesorter;
+	vissprite_t **dest = spritesorttemp;
+	int i, pass;
+
+	memset (counts, 0, sizeof(counts));
+	for (i = 0; i < vsprcount; ++i)
+	{
+		DWORD key = R_DepthKey(src[i]);
+		counts[0][key & 2047]++;
+		counts[1][(key >> 11) & 2047]++;
+		counts[2][key >> 22]++;
+	}
+
+	for (pass = 0; pass < 3; ++pass)
+	{
+		int *count = counts[pass];
+		int shift = pass * 11;
+		int sum = 0;
+
+		// Skip this digit if every sprite shares it.
+		if (count[(R_DepthKey(src[0]) >> shift) & 2047] == vsprcount)
+		{
+			continue;
+		}
+		for (i = 0; i < 2048; ++i)
+		{
+			int c = count[i];
+			count[i] = sum;
+			sum += c;
+		}
+		for (i = 0; i < vsprcount; ++i)
+		{
+			dest[count[(R_DepthKey(src[i]) >> shift) & 2047]++] = src[i];
+		}
+		std::swap (src, dest);
+	}
+	if (src != spritesorter)
+	{
+		memcpy (spritesorter, src, vsprcount * sizeof(vissprite_t *));
+	}
+}
+
 void R_SortVisSprites (bool (*compare)(vissprite_t *, vissprite_t *), size_t first)
 {
 	int i;
@@ -1743,8 +1814,12 @@ void R_SortVisSprites (bool (*compare)(vissprite_t *, vissprite_t *), size_t fir
 	if (spritesortersize < MaxVisSprites)
 	{
 		if (spritesorter != NULL)
+		{
 			delete[] spritesorter;
+			delete[] spritesorttemp;
+		}
 		spritesorter = new vissprite_t *[MaxVisSprites];
+		spritesorttemp = new vissprite_t *[MaxVisSprites];
 		spritesortersize = MaxVisSprites;
 	}
 
@@ -1766,7 +1841,49 @@ void R_SortVisSprites (bool (*compare)(vissprite_t *, vissprite_t *), size_t fir
 		}
 	}
 
-	std::stable_sort(&spritesorter[0], &spritesorter[vsprcount], compare);
+	if (compare == sv_compare && vsprcount >= 64)
+	{
+		R_RadixSortVisSprites ();
+	}
+	else
+	{
+		std::stable_sort(&spritesorter[0], &spritesorter[vsprcount], compare);
+	}
+}
+
+//==========================================================================
+//
+// R_BinDrawsegs
+//
+// Sorts the drawsegs that can clip or mask sprites into column bins.
+// Each bin lists them in the order they were added.
+//
+//==========================================================================
+
+static void R_BinDrawsegs ()
+{
+	int numbins = ((viewwidth - 1) >> DSBINSHIFT) + 1;
+	int i;
+
+	for (i = 0; i < numbins; ++i)
+	{
+		DrawsegBins[i].Clear();
+	}
+	for (drawseg_t *ds = firstdrawseg; ds < ds_p; ++ds)
+	{
+		// kg3D - no clipping on fake segs
+		if (ds->fake || ds->x1 > ds->x2 ||
+			(!(ds->silhouette & SIL_BOTH) && ds->maskedtexturecol == -1 && !ds->bFogBoundary))
+		{
+			continue;
+		}
+		int index = int(ds - firstdrawseg);
+		int last = ds->x2 >> DSBINSHIFT;
+		for (i = ds->x1 >> DSBINSHIFT; i <= last; ++i)
+		{
+			DrawsegBins[i].Push(index);
+		}
+	}
 }
 
 
@@ -1880,16 +1997,16 @@ void R_DrawSprite (vissprite_t *spr)
 			}
 			if (fixedlightlev >= 0)
 			{
-				spr->Style.colormap = mybasecolormap->Maps + fixedlightlev;
+				spr->Style.colormap = mybasecolormap->GetMaps() + fixedlightlev;
 			}
 			else if (!foggy && (spr->renderflags & RF_FULLBRIGHT))
 			{ // full bright
-				spr->Style.colormap = mybasecolormap->Maps;
+				spr->Style.colormap = mybasecolormap->GetMaps();
 			}
 			else
 			{ // diminished light
 				spriteshade = LIGHT2SHADE(sec->lightlevel + r_actualextralight);
-				spr->Style.colormap = mybasecolormap->Maps + (GETPALOOKUP (
+				spr->Style.colormap = mybasecolormap->GetMaps() + (GETPALOOKUP (
 					(fixed_t)DivScale12 (r_SpriteVisibility, spr->depth), spriteshade) << COLORMAPSHIFT);
 			}
 		}
@@ -2055,17 +2172,46 @@ void R_DrawSprite (vissprite_t *spr)
 
 	// Scan drawsegs from end to start for obscuring segs.
 	// The first drawseg that is closer than the sprite is the clip seg.
+	// Only the drawsegs in the bins the sprite covers need to be checked.
 
-	// Modified by Lee Killough:
-	// (pointer check was originally nonportable
-	// and buggy, by going past LEFT end of array):
+	const int *dsindex;
+	unsigned int dscount;
+	int bin1 = x1 >> DSBINSHIFT;
+	int bin2 = x2 >> DSBINSHIFT;
 
-	//		for (ds=ds_p-1 ; ds >= drawsegs ; ds--)    old buggy code
+	if (bin1 == bin2)
+	{
+		dsindex = DrawsegBins[bin1].Size() ? &DrawsegBins[bin1][0] : NULL;
+		dscount = DrawsegBins[bin1].Size();
+	}
+	else
+	{
+		// Gather each drawseg once, from the first of the sprite's bins
+		// it appears in, and put them back in drawing order.
+		DrawsegCandidates.Clear();
+		for (int bin = bin1; bin <= bin2; ++bin)
+		{
+			for (unsigned int n = 0; n < DrawsegBins[bin].Size(); ++n)
+			{
+				int index = DrawsegBins[bin][n];
+				if (MAX(bin1, firstdrawseg[index].x1 >> DSBINSHIFT) == bin)
+				{
+					DrawsegCandidates.Push(index);
+				}
+			}
+		}
+		dscount = DrawsegCandidates.Size();
+		dsindex = NULL;
+		if (dscount != 0)
+		{
+			dsindex = &DrawsegCandidates[0];
+			std::sort(&DrawsegCandidates[0], &DrawsegCandidates[0] + dscount);
+		}
+	}
 
-	for (ds = ds_p; ds-- > firstdrawseg; )  // new -- killough
+	for (unsigned int n = dscount; n-- > 0; )
 	{
-		// kg3D - no clipping on fake segs
-		if(ds->fake) continue;
+		ds = firstdrawseg + dsindex[n];
 		// determine if the drawseg obscures the sprite
 		if (ds->x1 > x2 || ds->x2 < x1 ||
 			(!(ds->silhouette & SIL_BOTH) && ds->maskedtexturecol == -1 &&
@@ -2230,7 +2376,11 @@ void R_DrawHeightPlanes(fixed_t height); // kg3D - fake planes
 
 void R_DrawMasked (void)
 {
+	// Sprites and masked walls are drawn directly.
+	R_FinishDrawerQueue ();
+
 	R_SortVisSprites (DrewAVoxel ? sv_compare2d : sv_compare, firstvissprite - vissprites);
+	R_BinDrawsegs ();
 
 	if (height_top == NULL)
 	{ // kg3D - no visible 3D floors, normal rendering
@@ -2364,7 +2514,7 @@ void R_ProjectParticle (particle_t *particle, const sector_t *sector, int shade,
 			botplane = &heightsec->ceilingplane;
 			toppic = sector->GetTexture(sector_t::ceiling);
 			botpic = heightsec->GetTexture(sector_t::ceiling);
-			map = heightsec->ColorMap->Maps;
+			map = heightsec->ColorMap->GetMaps();
 		}
 		else if (fakeside == FAKED_BelowFloor)
 		{
@@ -2372,7 +2522,7 @@ void R_ProjectParticle (particle_t *particle, const sector_t *sector, int shade,
 			botplane = &sector->floorplane;
 			toppic = heightsec->GetTexture(sector_t::floor);
 			botpic = sector->GetTexture(sector_t::floor);
-			map = heightsec->ColorMap->Maps;
+			map = heightsec->ColorMap->GetMaps();
 		}
 		else
 		{
@@ -2380,7 +2530,7 @@ void R_ProjectParticle (particle_t *particle, const sector_t *sector, int shade,
 			botplane = &heightsec->floorplane;
 			toppic = heightsec->GetTexture(sector_t::ceiling);
 			botpic = heightsec->GetTexture(sector_t::floor);
-			map = sector->ColorMap->Maps;
+			map = sector->ColorMap->GetMaps();
 		}
 	}
 	else
@@ -2389,7 +2539,7 @@ void R_ProjectParticle (particle_t *particle, const sector_t *sector, int shade,
 		botplane = &sector->floorplane;
 		toppic = sector->GetTexture(sector_t::ceiling);
 		botpic = sector->GetTexture(sector_t::floor);
-		map = sector->ColorMap->Maps;
+		map = sector->ColorMap->GetMaps();
 	}
 
 	if (botpic != skyflatnum && particle->z < botplane->ZatPoint (particle->x, particle->y))
@@ -2492,6 +2642,7 @@ void R_DrawParticle (vissprite_t *vis)
 
 	spacing = RenderTarget->GetPitch() - countbase;
 	dest = ylookup[yl] + x1 + dc_destorg;
+	R_ReleaseTrueColorRect (dest, countbase, ycount);
 
 	do
 	{
@@ -2798,6 +2949,7 @@ void R_DrawVoxel(fixed_t globalposx, fixed_t globalposy, fixed_t globalposz, ang
 							if (!(flags & DVF_OFFSCREEN))
 							{
 								// Draw directly to the screen.
+								R_ReleaseTrueColorRect(ylookup[z1] + lxt + xxl + dc_destorg, xxr - xxl, z2 - z1);
 								R_DrawSlab(xxr - xxl, yplc[xxl], z2 - z1, yinc, col, ylookup[z1] + lxt + xxl + dc_destorg);
 							}
 							else
@@ -33,6 +33,9 @@
 **
 */
 
+#include <sys/types.h>
+#include <sys/stat.h>
+
 #include "resourcefile.h"
 #include "cmdlib.h"
 #include "templates.h"
@@ -41,6 +44,11 @@
 #include "w_zip.h"
 #include "i_system.h"
 #include "ancientzip.h"
+#include "c_cvars.h"
+#include "c_dispatch.h"
+#include "m_misc.h"
+#include "md5.h"
+#include "doomerrors.h"
 
 #define BUFREADCOMMENT (0x400)
 
@@ -117,9 +125,12 @@ struct FZipLump : public FResourceLump
 
 	virtual FileReader *GetReader();
 	virtual int FillCache();
+	virtual BYTE *ReadCompressed();
+	virtual bool DecompressData(const BYTE *data, char *dest);
 
 private:
 	void SetLumpAddress();
+	bool Decompress(FileReader *reader, char *dest);
 	virtual int GetFileOffset() 
 	{ 
 		if (Method != METHOD_STORED) return -1;
@@ -128,6 +139,19 @@ private:
 };
 
 
+//==========================================================================
+//
+// An entry that could not be added as a lump
+//
+//==========================================================================
+
+struct FZipUnsupportedEntry
+{
+	FString Name;
+	int Method;
+	bool Encrypted;
+};
+
 //==========================================================================
 //
 // Zip file
@@ -138,15 +162,75 @@ class FZipFile : public FResourceFile
 {
 	FZipLump *Lumps;
 
+	// Key for the directory cache
+	bool CacheDirectory;
+	DWORD FileSize;
+	QWORD FileTime;
+	DWORD CachedUnresolved;		// lumps without a known file start when the cache was written
+	TArray<FZipUnsupportedEntry> Unsupported;	// left out of Lumps, kept for their warnings
+
 	static int STACK_ARGS lumpcmp(const void * a, const void * b);
 
+	void SkipUnsupported(const FString &name, int method, bool encrypted, bool quiet);
+	void PrintUnsupported(const FZipUnsupportedEntry &entry);
+	FString DirectoryCacheName(bool create);
+	bool ReadDirectoryCache();
+	DWORD CountUnresolved();
+
 public:
 	FZipFile(const char * filename, FileReader *file);
 	virtual ~FZipFile();
 	bool Open(bool quiet);
 	virtual FResourceLump *GetLump(int no) { return ((unsigned)no < NumLumps)? &Lumps[no] : NULL; }
+	virtual void SaveDirectoryCache();
+};
+
+//==========================================================================
+//
+// Directory cache
+//
+// Once a Zip's lump table has been sorted and the local file headers of
+// the lumps that were used have been located, it is saved to the cache
+// directory, so that the next start can take it as is instead of
+// reading the central directory and seeking to every local header again.
+// A cache file is found by the archive's path and is only used if the
+// archive still has the same size and time stamp.
+//
+//==========================================================================
+
+CVAR (Bool, w_cachezipdirs, true, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+
+#define ZIPCACHE_ID			MAKE_ID('Z','D','I','R')
+#define ZIPCACHE_VERSION	2
+
+struct FZipCacheHeader
+{
+	DWORD Magic;
+	DWORD Version;
+	DWORD FileSize;
+	DWORD FileTimeLo, FileTimeHi;
+	DWORD NumLumps;
+	DWORD NumUnsupported;
+	DWORD PathLength;		// followed by the archive's path
 };
 
+struct FZipCacheEntry
+{
+	DWORD LumpSize;
+	DWORD CompressedSize;
+	DWORD Position;
+	WORD GPFlags;
+	BYTE Method;
+	BYTE Flags;
+	DWORD NameLength;		// followed by the lump's full name
+};
+
+struct FZipCacheUnsupported
+{
+	WORD Method;
+	WORD Encrypted;
+	DWORD NameLength;		// followed by the entry's name
+};
 
 
 int STACK_ARGS FZipFile::lumpcmp(const void * a, const void * b)
@@ -168,16 +252,43 @@ FZipFile::FZipFile(const char * filename, FileReader *file)
 : FResourceFile(filename, file)
 {
 	Lumps = NULL;
+	CacheDirectory = false;
+	FileSize = 0;
+	FileTime = 0;
+	CachedUnresolved = 0;
 }
 
 bool FZipFile::Open(bool quiet)
 {
-	DWORD centraldir = Zip_FindCentralDir(Reader);
+	DWORD centraldir;
 	FZipEndOfCentralDirectory info;
 	int skipped = 0;
 
 	Lumps = NULL;
 
+	// Only archives that are real files can be looked up in the directory cache.
+	struct stat fileinfo;
+	if (w_cachezipdirs && Filename != NULL && stat(Filename, &fileinfo) == 0)
+	{
+		FileSize = DWORD(fileinfo.st_size);
+		FileTime = QWORD(fileinfo.st_mtime);
+		CacheDirectory = true;
+
+		if (ReadDirectoryCache())
+		{
+			if (!quiet)
+			{
+				for (unsigned i = 0; i < Unsupported.Size(); i++)
+				{
+					PrintUnsupported(Unsupported[i]);
+				}
+				Printf(", %d lumps\n", NumLumps);
+			}
+			return true;
+		}
+	}
+
+	centraldir = Zip_FindCentralDir(Reader);
 	if (centraldir == 0)
 	{
 		if (!quiet) Printf("\n%s: ZIP file corrupt!\n", Filename);
@@ -197,13 +308,14 @@ bool FZipFile::Open(bool quiet)
 	}
 
 	NumLumps = LittleShort(info.NumEntries);
-	Lumps = new FZipLump[NumLumps];
 
 	// Load the entire central directory. Too bad that this contains variable length entries...
 	void *directory = malloc(LittleLong(info.DirectorySize));
 	Reader->Seek(LittleLong(info.DirectoryOffset), SEEK_SET);
 	Reader->Read(directory, LittleLong(info.DirectorySize));
 
+	Lumps = new FZipLump[NumLumps];
+
 	char *dirptr = (char*)directory;
 	FZipLump *lump_p = Lumps;
 	for (DWORD i = 0; i < NumLumps; i++)
@@ -233,7 +345,7 @@ bool FZipFile::Open(bool quiet)
 			zip_fh->Method != METHOD_IMPLODE &&
 			zip_fh->Method != METHOD_SHRINK)
 		{
-			if (!quiet) Printf("\n%s: '%s' uses an unsupported compression algorithm (#%d).\n", Filename, name.GetChars(), zip_fh->Method);
+			SkipUnsupported(name, zip_fh->Method, false, quiet);
 			skipped++;
 			continue;
 		}
@@ -241,7 +353,7 @@ bool FZipFile::Open(bool quiet)
 		zip_fh->Flags = LittleShort(zip_fh->Flags);
 		if (zip_fh->Flags & ZF_ENCRYPTED)
 		{
-			if (!quiet) Printf("\n%s: '%s' is encrypted. Encryption is not supported.\n", Filename, name.GetChars());
+			SkipUnsupported(name, zip_fh->Method, true, quiet);
 			skipped++;
 			continue;
 		}
@@ -276,9 +388,371 @@ bool FZipFile::Open(bool quiet)
 	
 	// Entries in Zips are sorted alphabetically.
 	qsort(Lumps, NumLumps, sizeof(FZipLump), lumpcmp);
+
+	// Not in the cache, so make sure it gets written.
+	CachedUnresolved = NumLumps + 1;
 	return true;
 }
 
+//==========================================================================
+//
+// FZipFile :: SkipUnsupported
+//
+// Remembers an entry that can't be read, so that the warning for it is
+// also printed when the directory comes from the cache.
+//
+//==========================================================================
+
+void FZipFile::SkipUnsupported(const FString &name, int method, bool encrypted, bool quiet)
+{
+	FZipUnsupportedEntry &entry = Unsupported[Unsupported.Reserve(1)];
+
+	entry.Name = name;
+	entry.Method = method;
+	entry.Encrypted = encrypted;
+	if (!quiet) PrintUnsupported(entry);
+}
+
+//==========================================================================
+//
+// FZipFile :: PrintUnsupported
+//
+//==========================================================================
+
+void FZipFile::PrintUnsupported(const FZipUnsupportedEntry &entry)
+{
+	if (entry.Encrypted)
+	{
+		Printf("\n%s: '%s' is encrypted. Encryption is not supported.\n", Filename, entry.Name.GetChars());
+	}
+	else
+	{
+		Printf("\n%s: '%s' uses an unsupported compression algorithm (#%d).\n", Filename, entry.Name.GetChars(), entry.Method);
+	}
+}
+
+//==========================================================================
+//
+// FZipFile :: DirectoryCacheName
+//
+//==========================================================================
+
+FString FZipFile::DirectoryCacheName(bool create)
+{
+	FString path = M_GetCachePath(create);
+	path << "/zipdirs";
+	if (create) CreatePath(path);
+
+	// Archives with the same name in different directories get different
+	// cache files by adding a hash of the full path.
+	MD5Context md5;
+	BYTE digest[16];
+	md5.Update((const BYTE *)Filename, (unsigned)strlen(Filename));
+	md5.Final(digest);
+	path.AppendFormat("/%s-%02x%02x%02x%02x.gzd", ExtractFileBase(Filename, true).GetChars(),
+		digest[0], digest[1], digest[2], digest[3]);
+	return path;
+}
+
+//==========================================================================
+//
+// FZipFile :: CountUnresolved
+//
+//==========================================================================
+
+DWORD FZipFile::CountUnresolved()
+{
+	DWORD count = 0;
+	for (DWORD i = 0; i < NumLumps; i++)
+	{
+		if (Lumps[i].Flags & LUMPFZIP_NEEDFILESTART) count++;
+	}
+	return count;
+}
+
+//==========================================================================
+//
+// OpenDirectoryCache
+//
+// Opens a cache file and reads its header and the path of the archive it
+// belongs to. Returns NULL if it is not a cache file of this version.
+//
+//==========================================================================
+
+static FILE *OpenDirectoryCache(const char *path, FZipCacheHeader &header, FString &archive)
+{
+	FILE *f = fopen(path, "rb");
+	if (f == NULL) return NULL;
+
+	if (fread(&header, sizeof(header), 1, f) == 1 &&
+		LittleLong(header.Magic) == ZIPCACHE_ID &&
+		LittleLong(header.Version) == ZIPCACHE_VERSION)
+	{
+		DWORD pathlen = LittleLong(header.PathLength);
+		TArray<char> name(pathlen);
+
+		name.Resize(pathlen);
+		if (pathlen > 0 && pathlen <= 0x10000 && fread(&name[0], pathlen, 1, f) == 1)
+		{
+			archive = FString(&name[0], pathlen);
+			return f;
+		}
+	}
+	fclose(f);
+	return NULL;
+}
+
+//==========================================================================
+//
+// FZipFile :: ReadDirectoryCache
+//
+// Sets up the lumps from the cache file if it matches this archive.
+//
+//==========================================================================
+
+bool FZipFile::ReadDirectoryCache()
+{
+	FZipCacheHeader header;
+	FString archive;
+	FILE *f = OpenDirectoryCache(DirectoryCacheName(false), header, archive);
+	if (f == NULL) return false;
+
+	if (LittleLong(header.FileSize) != FileSize ||
+		LittleLong(header.FileTimeLo) != DWORD(FileTime) ||
+		LittleLong(header.FileTimeHi) != DWORD(FileTime >> 32) ||
+		archive.Compare(Filename) != 0)
+	{
+		fclose(f);
+		return false;
+	}
+
+	// The rest is the lumps and the unsupported entries.
+	TArray<BYTE> data;
+	long start = ftell(f);
+	fseek(f, 0, SEEK_END);
+	long len = ftell(f) - start;
+	fseek(f, start, SEEK_SET);
+	if (len > 0)
+	{
+		data.Resize(len);
+		if (fread(&data[0], 1, len, f) != (size_t)len) data.Clear();
+	}
+	fclose(f);
+	if (data.Size() == 0) return false;
+
+	const BYTE *pos = &data[0];
+	const BYTE *end = pos + data.Size();
+	DWORD numlumps = LittleLong(header.NumLumps);
+	DWORD numunsupported = LittleLong(header.NumUnsupported);
+	DWORD i;
+
+	// A Zip can't have more than 65535 entries.
+	if (numlumps == 0 || numlumps > 0xFFFF || numunsupported > 0xFFFF)
+	{
+		return false;
+	}
+
+	FZipLump *lumps = new FZipLump[numlumps];
+	for (i = 0; i < numlumps; i++)
+	{
+		FZipCacheEntry entry;
+
+		if (DWORD(end - pos) < sizeof(entry)) break;
+		memcpy(&entry, pos, sizeof(entry));
+		pos += sizeof(entry);
+
+		DWORD namelen = LittleLong(entry.NameLength);
+		if (namelen == 0 || DWORD(end - pos) < namelen) break;
+		FString name((const char *)pos, namelen);
+		pos += namelen;
+
+		FZipLump *lump_p = &lumps[i];
+		lump_p->LumpNameSetup(name);
+		lump_p->LumpSize = LittleLong(entry.LumpSize);
+		lump_p->Owner = this;
+		lump_p->Flags = LUMPF_ZIPFILE | (entry.Flags & LUMPFZIP_NEEDFILESTART);
+		lump_p->Method = entry.Method;
+		lump_p->GPFlags = LittleShort(entry.GPFlags);
+		lump_p->CompressedSize = LittleLong(entry.CompressedSize);
+		lump_p->Position = LittleLong(entry.Position);
+		lump_p->CheckEmbedded();
+
+		if (0 == stricmp("dehacked.exe", name))
+		{
+			memset(lump_p->Name, 0, sizeof(lump_p->Name));
+		}
+	}
+
+	TArray<FZipUnsupportedEntry> unsupported;
+	if (i == numlumps)
+	{
+		for (i = 0; i < numunsupported; i++)
+		{
+			FZipCacheUnsupported entry;
+
+			if (DWORD(end - pos) < sizeof(entry)) break;
+			memcpy(&entry, pos, sizeof(entry));
+			pos += sizeof(entry);
+
+			DWORD namelen = LittleLong(entry.NameLength);
+			if (DWORD(end - pos) < namelen) break;
+
+			FZipUnsupportedEntry &skip = unsupported[unsupported.Reserve(1)];
+			skip.Name = FString((const char *)pos, namelen);
+			skip.Method = LittleShort(entry.Method);
+			skip.Encrypted = entry.Encrypted != 0;
+			pos += namelen;
+		}
+		if (i == numunsupported && pos == end)
+		{
+			Lumps = lumps;
+			NumLumps = numlumps;
+			Unsupported = unsupported;
+			CachedUnresolved = CountUnresolved();
+			return true;
+		}
+	}
+	// The file is damaged.
+	delete[] lumps;
+	return false;
+}
+
+//==========================================================================
+//
+// FZipFile :: SaveDirectoryCache
+//
+// Writes the cache file if the archive was not found in the cache or if
+// more lumps have been located since it was read.
+//
+//==========================================================================
+
+void FZipFile::SaveDirectoryCache()
+{
+	if (!CacheDirectory || !w_cachezipdirs || NumLumps == 0 || CountUnresolved() >= CachedUnresolved)
+	{
+		return;
+	}
+
+	TArray<BYTE> data;
+	FZipCacheHeader header;
+	DWORD pathlen = (DWORD)strlen(Filename);
+
+	header.Magic = LittleLong(ZIPCACHE_ID);
+	header.Version = LittleLong(ZIPCACHE_VERSION);
+	header.FileSize = LittleLong(FileSize);
+	header.FileTimeLo = LittleLong(DWORD(FileTime));
+	header.FileTimeHi = LittleLong(DWORD(FileTime >> 32));
+	header.NumLumps = LittleLong(NumLumps);
+	header.NumUnsupported = LittleLong(Unsupported.Size());
+	header.PathLength = LittleLong(pathlen);
+	memcpy(&data[data.Reserve(sizeof(header))], &header, sizeof(header));
+	if (pathlen > 0)
+	{
+		memcpy(&data[data.Reserve(pathlen)], Filename, pathlen);
+	}
+
+	for (DWORD i = 0; i < NumLumps; i++)
+	{
+		FZipLump *lump_p = &Lumps[i];
+		FZipCacheEntry entry;
+		DWORD namelen = (DWORD)strlen(lump_p->FullName);
+
+		entry.LumpSize = LittleLong(lump_p->LumpSize);
+		entry.CompressedSize = LittleLong(lump_p->CompressedSize);
+		entry.Position = LittleLong(lump_p->Position);
+		entry.GPFlags = LittleShort(lump_p->GPFlags);
+		entry.Method = lump_p->Method;
+		entry.Flags = lump_p->Flags & LUMPFZIP_NEEDFILESTART;
+		entry.NameLength = LittleLong(namelen);
+		memcpy(&data[data.Reserve(sizeof(entry))], &entry, sizeof(entry));
+		memcpy(&data[data.Reserve(namelen)], lump_p->FullName, namelen);
+	}
+
+	for (unsigned i = 0; i < Unsupported.Size(); i++)
+	{
+		FZipCacheUnsupported entry;
+		DWORD namelen = (DWORD)Unsupported[i].Name.Len();
+
+		entry.Method = LittleShort(WORD(Unsupported[i].Method));
+		entry.Encrypted = LittleShort(WORD(Unsupported[i].Encrypted));
+		entry.NameLength = LittleLong(namelen);
+		memcpy(&data[data.Reserve(sizeof(entry))], &entry, sizeof(entry));
+		if (namelen > 0)
+		{
+			memcpy(&data[data.Reserve(namelen)], Unsupported[i].Name.GetChars(), namelen);
+		}
+	}
+
+	FString path = DirectoryCacheName(true);
+	FILE *f = fopen(path, "wb");
+	if (f != NULL)
+	{
+		if (fwrite(&data[0], data.Size(), 1, f) != 1)
+		{
+			Printf("Error saving directory cache %s\n", path.GetChars());
+		}
+		fclose(f);
+		CachedUnresolved = CountUnresolved();
+	}
+}
+
+//==========================================================================
+//
+// Zip_PruneDirectoryCache
+//
+// Deletes the cache files of archives that are gone or have changed
+// since the file was written, and any file this version can't read.
+//
+//==========================================================================
+
+void Zip_PruneDirectoryCache()
+{
+	if (!w_cachezipdirs)
+	{
+		return;
+	}
+
+	TArray<FFileList> list;
+	FString path = M_GetCachePath(false);
+	path << "/zipdirs/";
+
+	try
+	{
+		ScanDirectory(list, path);
+	}
+	catch (CRecoverableError &)
+	{
+		return;		// nothing has been cached yet
+	}
+
+	for (unsigned i = 0; i < list.Size(); i++)
+	{
+		if (list[i].isDirectory)
+		{
+			continue;
+		}
+
+		FZipCacheHeader header;
+		FString archive;
+		struct stat fileinfo;
+		bool stale = true;
+		FILE *f = OpenDirectoryCache(list[i].Filename, header, archive);
+
+		if (f != NULL)
+		{
+			fclose(f);
+			stale = stat(archive, &fileinfo) != 0 ||
+				LittleLong(header.FileSize) != DWORD(fileinfo.st_size) ||
+				LittleLong(header.FileTimeLo) != DWORD(QWORD(fileinfo.st_mtime)) ||
+				LittleLong(header.FileTimeHi) != DWORD(QWORD(fileinfo.st_mtime) >> 32);
+		}
+		if (stale)
+		{
+			remove(list[i].Filename);
+		}
+	}
+}
+
 //==========================================================================
 //
 // Zip file
@@ -353,54 +827,101 @@ int FZipLump::FillCache()
 
 	Owner->Reader->Seek(Position, SEEK_SET);
 	Cache = new char[LumpSize];
+	if (!Decompress(Owner->Reader, Cache))
+	{
+		return 0;
+	}
+	RefCount = 1;
+	return 1;
+}
+
+//==========================================================================
+//
+// Reads the lump's data from the reader's current position. This must not
+// touch anything shared, because the prefetcher calls it from its threads.
+//
+//==========================================================================
+
+bool FZipLump::Decompress(FileReader *reader, char *dest)
+{
 	switch (Method)
 	{
 		case METHOD_STORED:
 		{
-			Owner->Reader->Read(Cache, LumpSize);
+			reader->Read(dest, LumpSize);
 			break;
 		}
 
 		case METHOD_DEFLATE:
 		{
-			FileReaderZ frz(*Owner->Reader, true);
-			frz.Read(Cache, LumpSize);
+			FileReaderZ frz(*reader, true);
+			frz.Read(dest, LumpSize);
 			break;
 		}
 
 		case METHOD_BZIP2:
 		{
-			FileReaderBZ2 frz(*Owner->Reader);
-			frz.Read(Cache, LumpSize);
+			FileReaderBZ2 frz(*reader);
+			frz.Read(dest, LumpSize);
 			break;
 		}
 
 		case METHOD_LZMA:
 		{
-			FileReaderLZMA frz(*Owner->Reader, LumpSize, true);
-			frz.Read(Cache, LumpSize);
+			FileReaderLZMA frz(*reader, LumpSize, true);
+			frz.Read(dest, LumpSize);
 			break;
 		}
 
 		case METHOD_IMPLODE:
 		{
 			FZipExploder exploder;
-			exploder.Explode((unsigned char *)Cache, LumpSize, Owner->Reader, CompressedSize, GPFlags);
+			exploder.Explode((unsigned char *)dest, LumpSize, reader, CompressedSize, GPFlags);
 			break;
 		}
 
 		case METHOD_SHRINK:
 		{
-			ShrinkLoop((unsigned char *)Cache, LumpSize, Owner->Reader, CompressedSize);
+			ShrinkLoop((unsigned char *)dest, LumpSize, reader, CompressedSize);
 			break;
 		}
 
 		default:
 			assert(0);
-			return 0;
+			return false;
 	}
-	RefCount = 1;
-	return 1;
+	return true;
+}
+
+//==========================================================================
+//
+// Returns a copy of the compressed data for the prefetcher, or NULL if
+// the lump is stored and there is nothing to gain.
+//
+//==========================================================================
+
+BYTE *FZipLump::ReadCompressed()
+{
+	if (Method == METHOD_STORED)
+	{
+		return NULL;
+	}
+	if (Flags & LUMPFZIP_NEEDFILESTART) SetLumpAddress();
+
+	BYTE *data = new BYTE[CompressedSize];
+	Owner->Reader->Seek(Position, SEEK_SET);
+	if (Owner->Reader->Read(data, CompressedSize) != CompressedSize)
+	{
+		delete[] data;
+		return NULL;
+	}
+	return data;
+}
+
+bool FZipLump::DecompressData(const BYTE *data, char *dest)
+{
+	MemoryReader reader((const char *)data, CompressedSize);
+	return Decompress(&reader, dest);
 }
 
 
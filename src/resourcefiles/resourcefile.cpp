@@ -38,6 +38,7 @@
 #include "cmdlib.h"
 #include "w_wad.h"
 #include "doomerrors.h"
+#include "w_prefetch.h"
 
 
 
@@ -215,7 +216,22 @@ void *FResourceLump::CacheLump()
 	}
 	else if (LumpSize > 0)
 	{
-		FillCache();
+		char *prefetched = W_ClaimPrefetchedLump(this);
+
+		if (prefetched != NULL)
+		{
+			Cache = prefetched;
+			RefCount = 1;
+		}
+		else
+		{
+			FillCache();
+		}
+		if (Owner != NULL)
+		{
+			if (RefCount < 0) Owner->ResidentBytes += LumpSize;
+			else Owner->CopiedBytes += LumpSize;
+		}
 	}
 	return Cache;
 }
@@ -234,6 +250,7 @@ int FResourceLump::ReleaseCache()
 		{
 			delete [] Cache;
 			Cache = NULL;
+			if (Owner != NULL) Owner->CopiedBytes -= LumpSize;
 		}
 	}
 	return RefCount;
@@ -295,6 +312,7 @@ FResourceFile::FResourceFile(const char *filename, FileReader *r)
 	if (filename != NULL) Filename = copystring(filename);
 	else Filename = NULL;
 	Reader = r;
+	ResidentBytes = CopiedBytes = 0;
 }
 
 
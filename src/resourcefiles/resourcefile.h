@@ -51,6 +51,11 @@ struct FResourceLump
 	void *CacheLump();
 	int ReleaseCache();
 
+	// For lumps that have to be decompressed, ReadCompressed returns their
+	// raw data, which DecompressData can then unpack on any thread.
+	virtual BYTE *ReadCompressed() { return NULL; }
+	virtual bool DecompressData(const BYTE *data, char *dest) { return false; }
+
 protected:
 	virtual int FillCache() = 0;
 
@@ -61,6 +66,8 @@ class FResourceFile
 public:
 	FileReader *Reader;
 	const char *Filename;
+	size_t ResidentBytes;	// cached lumps that point into the file's buffer
+	size_t CopiedBytes;		// cached lumps that were read into their own memory
 protected:
 	DWORD NumLumps;
 
@@ -81,8 +88,12 @@ public:
 	virtual void FindStrifeTeaserVoices ();
 	virtual bool Open(bool quiet) = 0;
 	virtual FResourceLump *GetLump(int no) = 0;
+	virtual void SaveDirectoryCache() {}
 };
 
+// Deletes cached Zip directories that no longer match their archive.
+void Zip_PruneDirectoryCache();
+
 struct FUncompressedLump : public FResourceLump
 {
 	int				Position;
@@ -239,7 +239,7 @@ public:
 void I_InitSound ()
 {
 	/* Get command line options: */
-	nosound = !!Args->CheckParm ("-nosound");
+	nosound = !!Args->CheckParm ("-nosound") || !!Args->CheckParm ("-benchmark");
 	nosfx = !!Args->CheckParm ("-nosfx");
 
 	if (nosound)
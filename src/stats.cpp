@@ -122,9 +122,9 @@ void FStat::PrintStat ()
 			}
 		}
 	}
-	if (count)
+	if (count && StatusBar != NULL)
 	{
-		ST_SetNeedRefresh();
+		StatusBar->Invalidate (0, y, SCREENWIDTH, SCREENHEIGHT);
 	}
 }
 
@@ -43,7 +43,9 @@
 #include "colormatcher.h"
 #include "c_dispatch.h"
 #include "v_video.h"
+#include "v_palette.h"
 #include "m_fixed.h"
+#include "r_utility.h"
 #include "textures/textures.h"
 
 typedef bool (*CheckFunc)(FileReader & file);
@@ -150,7 +152,8 @@ FTexture::FTexture (const char *name, int lumpnum)
   WidthBits(0), HeightBits(0), xScale(FRACUNIT), yScale(FRACUNIT), SourceLump(lumpnum),
   UseType(TEX_Any), bNoDecals(false), bNoRemap0(false), bWorldPanning(false),
   bMasked(true), bAlphaTexture(false), bHasCanvas(false), bWarped(0), bComplex(false), bMultiPatch(false), bKeepAround(false),
-  Rotations(0xFFFF), SkyOffset(0), Width(0), Height(0), WidthMask(0), Native(NULL)
+  Rotations(0xFFFF), SkyOffset(0), Width(0), Height(0), WidthMask(0), Native(NULL),
+  PixelsBgraTime(0)
 {
 	id.SetInvalid();
 	if (name != NULL)
@@ -471,6 +474,139 @@ void FTexture::KillNative()
 	}
 }
 
+//===========================================================================
+//
+// FTexture::GetPixelsBgra
+//
+// Makes a true color copy of the texture for the BGRA drawers. It is laid
+// out like GetPixels, so a drawer can find a texel at the same offset it
+// has in the paletted image. The copy is padded to a power of 2 height, the
+// same as the column drawers assume when they mask the texture coordinate.
+// Warped and camera textures change every frame and are copied again.
+//
+//===========================================================================
+
+const DWORD *FTexture::GetPixelsBgra()
+{
+	if (PixelsBgra.Size() != 0 && (!(bWarped || bHasCanvas) || PixelsBgraTime == r_FrameTime))
+	{
+		return &PixelsBgra[0];
+	}
+
+	int w = GetWidth();
+	int h = GetHeight();
+	FBitmap bmp;
+
+	bmp.Create(w, h);
+	CopyTrueColorPixels(&bmp, 0, 0);
+
+	PixelsBgra.Resize(w * h + (1 << HeightBits) - h);
+	for (int x = 0; x < w; ++x)
+	{
+		const BYTE *in = bmp.GetPixels() + x * 4;
+		DWORD *out = &PixelsBgra[x * h];
+		for (int y = 0; y < h; ++y)
+		{
+			*out++ = (in[2] << 16) | (in[1] << 8) | in[0];
+			in += bmp.GetPitch();
+		}
+	}
+	for (unsigned int i = w * h; i < PixelsBgra.Size(); ++i)
+	{
+		PixelsBgra[i] = 0;
+	}
+	PixelsBgraTime = r_FrameTime;
+	return &PixelsBgra[0];
+}
+
+void FTexture::KillBgra()
+{
+	PixelsBgra.Clear();
+	PixelsBgra.ShrinkToFit();
+}
+
+//===========================================================================
+//
+// FTexture::GetMipmap
+//
+// Makes all mip levels the first time one is asked for. Level n is
+// (Width+2^n-1)>>n columns of Height>>n texels, and the levels are stored
+// one after another. Only textures with a power of 2 height can be used,
+// since the wall drawers wrap the texture coordinate with a shift. Warped
+// and camera textures change every frame, so they are never mipmapped.
+//
+//===========================================================================
+
+const BYTE *FTexture::GetMipmap(int level)
+{
+	int w = GetWidth();
+	int h = GetHeight();
+
+	if (level < 1 || level > MAX_MIPLEVEL || level >= HeightBits ||
+		h != (1 << HeightBits) || bWarped || bHasCanvas)
+	{
+		return NULL;
+	}
+
+	if (Mipmaps.Size() == 0)
+	{
+		int levels = MIN<int>(MAX_MIPLEVEL, HeightBits - 1);
+		unsigned int size = 0;
+		int i;
+
+		for (i = 1; i <= levels; ++i)
+		{
+			size += ((w + (1 << i) - 1) >> i) * (h >> i);
+		}
+		Mipmaps.Resize(size);
+
+		const BYTE *src = GetPixels();
+		BYTE *dest = &Mipmaps[0];
+		int sw = w, sh = h;
+
+		for (i = 1; i <= levels; ++i)
+		{
+			int dw = (sw + 1) >> 1;
+			int dh = sh >> 1;
+
+			for (int x = 0; x < dw; ++x)
+			{
+				const BYTE *col1 = src + (x * 2) * sh;
+				const BYTE *col2 = src + MIN(x * 2 + 1, sw - 1) * sh;
+
+				for (int y = 0; y < dh; ++y)
+				{
+					const PalEntry &p1 = GPalette.BaseColors[col1[y*2]];
+					const PalEntry &p2 = GPalette.BaseColors[col1[y*2+1]];
+					const PalEntry &p3 = GPalette.BaseColors[col2[y*2]];
+					const PalEntry &p4 = GPalette.BaseColors[col2[y*2+1]];
+
+					*dest++ = ColorMatcher.Pick(
+						(p1.r + p2.r + p3.r + p4.r + 2) >> 2,
+						(p1.g + p2.g + p3.g + p4.g + 2) >> 2,
+						(p1.b + p2.b + p3.b + p4.b + 2) >> 2);
+				}
+			}
+			src = dest - dw * dh;
+			sw = dw;
+			sh = dh;
+		}
+	}
+
+	const BYTE *mip = &Mipmaps[0];
+	for (int i = 1; i < level; ++i)
+	{
+		mip += ((w + (1 << i) - 1) >> i) * (h >> i);
+	}
+	return mip;
+}
+
+void FTexture::KillMipmaps()
+{
+	Mipmaps.Clear();
+	Mipmaps.ShrinkToFit();
+}
+
 // For this generic implementation, we just call GetPixels and copy that data
 // to the buffer. Texture formats that can do better than paletted images
 // should provide their own implementation that may preserve the original
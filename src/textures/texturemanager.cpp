@@ -53,6 +53,7 @@
 #include "r_renderer.h"
 #include "r_sky.h"
 #include "textures/textures.h"
+#include "w_prefetch.h"
 
 FTextureManager TexMan;
 
@@ -354,6 +355,8 @@ void FTextureManager::UnloadAll ()
 	for (unsigned int i = 0; i < Textures.Size(); ++i)
 	{
 		Textures[i].Texture->Unload ();
+		Textures[i].Texture->KillBgra ();
+		Textures[i].Texture->KillMipmaps ();
 	}
 }
 
@@ -798,6 +801,45 @@ void FTextureManager::LoadTextureX(int wadnum)
 	AddTexturesLumps (texlump1, texlump2, pnames);
 }
 
+//==========================================================================
+//
+// PrefetchTextureLumps
+//
+// Hands the prefetch threads the lumps AddTexturesForWad is going to
+// look at, in the order it looks at them. Only compressed lumps are
+// actually queued.
+//
+//==========================================================================
+
+static void PrefetchTextureLumps(int wadnum)
+{
+	static const int groups[] = { ns_sprites, ns_patches, ns_flats, ns_newtextures };
+	TArray<int> lumps;
+	int firsttx = Wads.GetFirstLump(wadnum);
+	int lasttx = Wads.GetLastLump(wadnum);
+
+	for (unsigned j = 0; j < countof(groups); j++)
+	{
+		for (int i = firsttx; i <= lasttx; i++)
+		{
+			if (Wads.GetLumpNamespace(i) == groups[j])
+			{
+				lumps.Push(i);
+			}
+		}
+	}
+	for (int i = firsttx; i <= lasttx; i++)
+	{
+		int ns = Wads.GetLumpNamespace(i);
+		if (ns == ns_graphics || ns >= ns_firstskin ||
+			(ns == ns_global && !(Wads.GetLumpFlags(i) & LUMPF_ZIPFILE)))
+		{
+			lumps.Push(i);
+		}
+	}
+	W_PrefetchLumps(lumps);
+}
+
 //==========================================================================
 //
 // FTextureManager :: AddTexturesForWad
@@ -811,6 +853,8 @@ void FTextureManager::AddTexturesForWad(int wadnum)
 
 	FirstTextureForFile.Push(firsttexture);
 
+	PrefetchTextureLumps(wadnum);
+
 	// First step: Load sprites
 	AddGroup(wadnum, ns_sprites, FTexture::TEX_Sprite);
 
@@ -896,6 +940,7 @@ void FTextureManager::AddTexturesForWad(int wadnum)
 	// Seventh step: Check for hires replacements.
 	AddHiresTextures(wadnum);
 
+	W_StopPrefetch();
 	SortTexturesByType(firsttexture, Textures.Size());
 }
 
@@ -1243,10 +1288,24 @@ void FTextureManager::PrecacheLevel (void)
 	memset (hitlist, 0, cnt);
 
 	screen->GetHitlist(hitlist);
+
+	// Let the prefetch threads unpack the source lumps ahead of the loop.
+	TArray<int> lumps;
+	for (int i = cnt - 1; i >= 0; i--)
+	{
+		FTexture *tex = ByIndex(i);
+		if (hitlist[i] && tex != NULL && !tex->bMultiPatch && tex->GetSourceLump() >= 0)
+		{
+			lumps.Push(tex->GetSourceLump());
+		}
+	}
+	W_PrefetchLumps(lumps);
+
 	for (int i = cnt - 1; i >= 0; i--)
 	{
 		Renderer->PrecacheTexture(ByIndex(i), hitlist[i]);
 	}
+	W_StopPrefetch();
 
 	delete[] hitlist;
 }
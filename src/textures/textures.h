@@ -229,6 +229,15 @@ public:
 
 	// Returns the whole texture, stored in column-major order
 	virtual const BYTE *GetPixels () = 0;
+
+	// Returns the whole texture as 0x00RRGGBB texels made by CopyTrueColorPixels,
+	// stored in column-major order like GetPixels
+	const DWORD *GetPixelsBgra ();
+
+	// Returns the texture box filtered down to 1/(2^level) size, stored in
+	// column-major order like GetPixels, or NULL if it cannot be mipmapped
+	enum { MAX_MIPLEVEL = 3 };
+	const BYTE *GetMipmap (int level);
 	
 	virtual int CopyTrueColorPixels(FBitmap *bmp, int x, int y, int rotate=0, FCopyInfo *inf = NULL);
 	int CopyTrueColorTranslated(FBitmap *bmp, int x, int y, int rotate, FRemapTable *remap, FCopyInfo *inf = NULL);
@@ -248,6 +257,12 @@ public:
 	// Frees the native 3D representation of the texture
 	void KillNative();
 
+	// Frees the copy made by GetPixelsBgra
+	void KillBgra();
+
+	// Frees the copies made by GetMipmap
+	void KillMipmaps();
+
 	// Fill the native texture buffer with pixel data for this image
 	virtual void FillBuffer(BYTE *buff, int pitch, int height, FTextureFormat fmt);
 
@@ -301,6 +316,9 @@ protected:
 	WORD Width, Height, WidthMask;
 	static BYTE GrayMap[256];
 	FNativeTexture *Native;
+	TArray<DWORD> PixelsBgra;
+	DWORD PixelsBgraTime;
+	TArray<BYTE> Mipmaps;
 
 	FTexture (const char *name = NULL, int lumpnum = -1);
 
@@ -42,6 +42,7 @@ INTBOOL CheckActorFlag(const AActor *owner, const char *flagname, bool printerro
 //
 //==========================================================================
 class FxExpression;
+class FxBytecode;
 
 struct FStateLabels;
 
@@ -118,12 +119,78 @@ public:
 //
 //==========================================================================
 
+struct ExpVal
+{
+	ExpValType Type;
+	union
+	{
+		int Int;
+		double Float;
+		void *pointer;
+	};
+
+	int GetInt() const
+	{
+		return Type == VAL_Int? Int : Type == VAL_Float? int(Float) : 0;
+	}
+
+	double GetFloat() const
+	{
+		return Type == VAL_Int? double(Int) : Type == VAL_Float? Float : 0;
+	}
+
+	bool GetBool() const
+	{
+		return (Type == VAL_Int || Type == VAL_Sound) ? !!Int : Type == VAL_Float? Float!=0. : false;
+	}
+	
+	template<class T> T *GetPointer() const
+	{
+		return Type == VAL_Object || Type == VAL_Pointer? (T*)pointer : NULL;
+	}
+
+	FSoundID GetSoundID() const
+	{
+		return Type == VAL_Sound? Int : 0;
+	}
+
+	int GetColor() const
+	{
+		return Type == VAL_Color? Int : 0;
+	}
+
+	FName GetName() const
+	{
+		return Type == VAL_Name? ENamedName(Int) : NAME_None;
+	}
+	
+	FState *GetState() const
+	{
+		return Type == VAL_State? (FState*)pointer : NULL;
+	}
+
+	const PClass *GetClass() const
+	{
+		return Type == VAL_Class? (const PClass *)pointer : NULL;
+	}
+
+};
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
 struct FStateExpression
 {
 	FxExpression *expr;
 	const PClass *owner;
 	bool constant;
 	bool cloned;
+	bool hasvalue;		// expr is constant and its value is stored in value
+	ExpVal value;
+	FxBytecode *code;	// expr compiled to bytecode, or NULL
 };
 
 class FStateExpressions
@@ -139,7 +206,12 @@ public:
 	void Copy(int dest, int src, int cnt);
 	int ResolveAll();
 	FxExpression *Get(int no);
+	bool Eval(int no, AActor *self, ExpVal &val);
 	unsigned int Size() { return expressions.Size(); }
+	void Benchmark();
+
+private:
+	void Prepare(int no);
 };
 
 extern FStateExpressions StateParams;
@@ -0,0 +1,1168 @@
+/*
+** thingdef_bytecode.cpp
+** Bytecode for DECORATE action function parameters
+**
+** Resolved parameter expressions are flattened into a linear register
+** program, so that calling an action function no longer walks the tree.
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 The GZ3Doom developers
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+
+#include <math.h>
+
+#include "actor.h"
+#include "tarray.h"
+#include "templates.h"
+#include "i_system.h"
+#include "m_random.h"
+#include "thingdef.h"
+#include "doomstat.h"
+#include "c_dispatch.h"
+#include "stats.h"
+#include "sc_man.h"
+#include "thingdef_exp.h"
+
+// MACROS ------------------------------------------------------------------
+
+#define BENCHMARK_REPEATS	1000
+
+// TYPES -------------------------------------------------------------------
+
+enum
+{
+	OP_LI,			// dest = Arg
+	OP_LF,			// dest = Float
+	OP_EVAL,		// dest = Expr->EvalExpression (self)
+	OP_VAL2I,		// dest = A.GetInt()
+	OP_VAL2F,		// dest = A.GetFloat()
+	OP_VAL2B,		// dest = A.GetBool()
+	OP_I2F,
+	OP_F2I,
+	OP_I2B,
+	OP_F2B,
+	OP_MOVI,
+	OP_MOVF,
+
+	// Variable loads. If B is set, Arg is an offset into self,
+	// otherwise Address is the variable's address.
+	OP_LDI,
+	OP_LDB,
+	OP_LDF,
+	OP_LDFIX,
+	OP_LDANG,
+
+	OP_NEGI,
+	OP_NEGF,
+	OP_NOTI,
+	OP_LNOTI,
+
+	OP_ADDI,
+	OP_SUBI,
+	OP_MULI,
+	OP_DIVI,
+	OP_MODI,
+	OP_ADDF,
+	OP_SUBF,
+	OP_MULF,
+	OP_DIVF,
+	OP_MODF,
+
+	OP_LTI,
+	OP_GTI,
+	OP_GEI,
+	OP_LEI,
+	OP_EQI,
+	OP_NEI,
+	OP_LTF,
+	OP_GTF,
+	OP_GEF,
+	OP_LEF,
+	OP_EQF,
+	OP_NEF,
+
+	OP_SHLI,
+	OP_SHRI,
+	OP_USHRI,
+	OP_ANDI,
+	OP_ORI,
+	OP_XORI,
+
+	OP_ABSI,
+	OP_ABSF,
+
+	OP_RANDOM,		// dest = rng()
+	OP_RANDOMRANGE,	// dest = random number between A and B
+	OP_FRANDOM,		// dest = float random number in [0,1)
+	OP_FRANDOMRANGE,// dest = dest scaled to between A and B
+	OP_RANDOM2,		// dest = rng->Random2(A)
+
+	OP_JMP,			// continue at Arg
+	OP_JZ,			// continue at Arg if A is 0
+	OP_JNZ,			// continue at Arg if A is not 0
+};
+
+// CODE --------------------------------------------------------------------
+
+//==========================================================================
+//
+// FxBytecode :: FxBytecode
+//
+//==========================================================================
+
+FxBytecode::FxBytecode()
+{
+	for (int i = 0; i < NUM_REGT; i++)
+	{
+		NumRegs[i] = 0;
+	}
+	NumEvals = 0;
+	NumRandoms = 0;
+	Failed = false;
+}
+
+//==========================================================================
+//
+// FxBytecode :: Compile
+//
+// Returns NULL if the expression is better left to the tree.
+//
+//==========================================================================
+
+FxBytecode *FxBytecode::Compile(FxExpression *x)
+{
+	FxBytecode *code = new FxBytecode;
+
+	code->Result = x->Emit(*code);
+	if (code->Failed ||
+		(code->Result.RegType != REGT_INT && code->Result.RegType != REGT_FLOAT))
+	{
+		delete code;
+		return NULL;
+	}
+	code->Code.ShrinkToFit();
+	return code;
+}
+
+//==========================================================================
+//
+// FxBytecode :: NewReg
+//
+//==========================================================================
+
+ExpEmit FxBytecode::NewReg(int regtype)
+{
+	if (NumRegs[regtype] >= MAX_EXP_REGS)
+	{
+		Failed = true;
+		return ExpEmit(0, regtype);
+	}
+	return ExpEmit(NumRegs[regtype]++, regtype);
+}
+
+//==========================================================================
+//
+// FxBytecode :: Emit
+//
+// The returned reference is only valid until the next instruction is added.
+//
+//==========================================================================
+
+FExpOp &FxBytecode::Emit(int op, int dest, int a, int b)
+{
+	FExpOp &ins = Code[Code.Reserve(1)];
+
+	ins.Op = BYTE(op);
+	ins.Dest = BYTE(dest);
+	ins.A = BYTE(a);
+	ins.B = BYTE(b);
+	ins.Arg = 0;
+	ins.Float = 0;
+	return ins;
+}
+
+//==========================================================================
+//
+// FxBytecode :: EmitEval
+//
+// Evaluates an expression through the tree.
+//
+//==========================================================================
+
+ExpEmit FxBytecode::EmitEval(FxExpression *x)
+{
+	ExpEmit dest = NewReg(REGT_VAL);
+	Emit(OP_EVAL, dest.RegNum).Expr = x;
+	NumEvals++;
+	return dest;
+}
+
+//==========================================================================
+//
+// FxBytecode :: EmitLoad
+//
+// Reads a variable the way GetVariableValue does. Returns REGT_NIL for
+// the types this cannot handle.
+//
+//==========================================================================
+
+ExpEmit FxBytecode::EmitLoad(const FExpressionType &type, void *address, bool selfrelative)
+{
+	ExpEmit dest;
+	int op;
+
+	switch (type.Type)
+	{
+	case VAL_Int:	op = OP_LDI;	dest = NewReg(REGT_INT);	break;
+	case VAL_Bool:	op = OP_LDB;	dest = NewReg(REGT_INT);	break;
+	case VAL_Float:	op = OP_LDF;	dest = NewReg(REGT_FLOAT);	break;
+	case VAL_Fixed:	op = OP_LDFIX;	dest = NewReg(REGT_FLOAT);	break;
+	case VAL_Angle:	op = OP_LDANG;	dest = NewReg(REGT_FLOAT);	break;
+	default:		return ExpEmit();
+	}
+
+	FExpOp &ins = Emit(op, dest.RegNum, 0, selfrelative);
+	if (selfrelative)
+	{
+		ins.Arg = int(intptr_t(address));
+	}
+	else
+	{
+		ins.Address = address;
+	}
+	return dest;
+}
+
+//==========================================================================
+//
+// FxBytecode :: EmitRandom
+//
+//==========================================================================
+
+ExpEmit FxBytecode::EmitRandom(int op, FRandom *rng, int dest, int a, int b)
+{
+	Emit(op, dest, a, b).Rng = rng;
+	NumRandoms++;
+	return ExpEmit(dest, op == OP_FRANDOM || op == OP_FRANDOMRANGE ? REGT_FLOAT : REGT_INT);
+}
+
+//==========================================================================
+//
+// FxBytecode :: ToInt / ToFloat / ToBool
+//
+// Convert a result the way ExpVal's GetInt, GetFloat and GetBool do.
+// ToBool returns 0 or 1 in an integer register.
+//
+//==========================================================================
+
+ExpEmit FxBytecode::ToInt(ExpEmit e)
+{
+	ExpEmit dest;
+
+	switch (e.RegType)
+	{
+	case REGT_INT:
+		return e;
+
+	case REGT_FLOAT:
+		dest = NewReg(REGT_INT);
+		Emit(OP_F2I, dest.RegNum, e.RegNum);
+		return dest;
+
+	case REGT_VAL:
+		dest = NewReg(REGT_INT);
+		Emit(OP_VAL2I, dest.RegNum, e.RegNum);
+		return dest;
+
+	default:	// an object reference
+		dest = NewReg(REGT_INT);
+		Emit(OP_LI, dest.RegNum);
+		return dest;
+	}
+}
+
+ExpEmit FxBytecode::ToFloat(ExpEmit e)
+{
+	ExpEmit dest;
+
+	switch (e.RegType)
+	{
+	case REGT_FLOAT:
+		return e;
+
+	case REGT_INT:
+		dest = NewReg(REGT_FLOAT);
+		Emit(OP_I2F, dest.RegNum, e.RegNum);
+		return dest;
+
+	case REGT_VAL:
+		dest = NewReg(REGT_FLOAT);
+		Emit(OP_VAL2F, dest.RegNum, e.RegNum);
+		return dest;
+
+	default:
+		dest = NewReg(REGT_FLOAT);
+		Emit(OP_LF, dest.RegNum);
+		return dest;
+	}
+}
+
+ExpEmit FxBytecode::ToBool(ExpEmit e)
+{
+	ExpEmit dest = NewReg(REGT_INT);
+
+	switch (e.RegType)
+	{
+	case REGT_INT:		Emit(OP_I2B, dest.RegNum, e.RegNum);	break;
+	case REGT_FLOAT:	Emit(OP_F2B, dest.RegNum, e.RegNum);	break;
+	case REGT_VAL:		Emit(OP_VAL2B, dest.RegNum, e.RegNum);	break;
+	default:			Emit(OP_LI, dest.RegNum);				break;
+	}
+	return dest;
+}
+
+//==========================================================================
+//
+// FxBytecode :: Move
+//
+// Both registers must be of the same type, either integer or float.
+//
+//==========================================================================
+
+ExpEmit FxBytecode::Move(ExpEmit dest, ExpEmit src)
+{
+	Emit(dest.RegType == REGT_INT ? OP_MOVI : OP_MOVF, dest.RegNum, src.RegNum);
+	return dest;
+}
+
+//==========================================================================
+//
+// FxBytecode :: GetMark / Rewind
+//
+// Lets a node drop what it emitted so far and fall back to the tree.
+//
+//==========================================================================
+
+FxBytecode::FMark FxBytecode::GetMark() const
+{
+	FMark mark;
+
+	mark.CodeSize = Code.Size();
+	for (int i = 0; i < NUM_REGT; i++)
+	{
+		mark.NumRegs[i] = NumRegs[i];
+	}
+	mark.NumEvals = NumEvals;
+	mark.NumRandoms = NumRandoms;
+	return mark;
+}
+
+void FxBytecode::Rewind(const FMark &mark)
+{
+	Code.Resize(mark.CodeSize);
+	for (int i = 0; i < NUM_REGT; i++)
+	{
+		NumRegs[i] = mark.NumRegs[i];
+	}
+	NumEvals = mark.NumEvals;
+	NumRandoms = mark.NumRandoms;
+}
+
+//==========================================================================
+//
+// FxBytecode :: Run
+//
+//==========================================================================
+
+ExpVal FxBytecode::Run(AActor *self) const
+{
+	int ireg[MAX_EXP_REGS];
+	double freg[MAX_EXP_REGS];
+	ExpVal vreg[MAX_EXP_REGS];
+	const FExpOp *code = &Code[0];
+	const FExpOp *pc = code;
+	const FExpOp *end = code + Code.Size();
+
+	while (pc < end)
+	{
+		const FExpOp &op = *pc++;
+		const BYTE *addr;
+
+		switch (op.Op)
+		{
+		case OP_LI:		ireg[op.Dest] = op.Arg;									break;
+		case OP_LF:		freg[op.Dest] = op.Float;								break;
+		case OP_EVAL:	vreg[op.Dest] = op.Expr->EvalExpression (self);			break;
+		case OP_VAL2I:	ireg[op.Dest] = vreg[op.A].GetInt();					break;
+		case OP_VAL2F:	freg[op.Dest] = vreg[op.A].GetFloat();					break;
+		case OP_VAL2B:	ireg[op.Dest] = vreg[op.A].GetBool();					break;
+		case OP_I2F:	freg[op.Dest] = double(ireg[op.A]);						break;
+		case OP_F2I:	ireg[op.Dest] = int(freg[op.A]);						break;
+		case OP_I2B:	ireg[op.Dest] = ireg[op.A] != 0;						break;
+		case OP_F2B:	ireg[op.Dest] = freg[op.A] != 0.;						break;
+		case OP_MOVI:	ireg[op.Dest] = ireg[op.A];								break;
+		case OP_MOVF:	freg[op.Dest] = freg[op.A];								break;
+
+		case OP_LDI:
+		case OP_LDB:
+		case OP_LDF:
+		case OP_LDFIX:
+		case OP_LDANG:
+			if (op.B)
+			{
+				if (self == NULL)
+				{
+					I_Error("Accessing member variable without valid object");
+				}
+				addr = (const BYTE *)self + op.Arg;
+			}
+			else
+			{
+				addr = (const BYTE *)op.Address;
+			}
+			switch (op.Op)
+			{
+			case OP_LDI:	ireg[op.Dest] = *(const int *)addr;							break;
+			case OP_LDB:	ireg[op.Dest] = *(const bool *)addr;						break;
+			case OP_LDF:	freg[op.Dest] = *(const double *)addr;						break;
+			case OP_LDFIX:	freg[op.Dest] = (*(const fixed_t *)addr) / 65536.;			break;
+			case OP_LDANG:	freg[op.Dest] = (*(const angle_t *)addr) * 90./ANGLE_90;	break;
+			}
+			break;
+
+		case OP_NEGI:	ireg[op.Dest] = -ireg[op.A];							break;
+		case OP_NEGF:	freg[op.Dest] = -freg[op.A];							break;
+		case OP_NOTI:	ireg[op.Dest] = ~ireg[op.A];							break;
+		case OP_LNOTI:	ireg[op.Dest] = !ireg[op.A];							break;
+
+		case OP_ADDI:	ireg[op.Dest] = ireg[op.A] + ireg[op.B];				break;
+		case OP_SUBI:	ireg[op.Dest] = ireg[op.A] - ireg[op.B];				break;
+		case OP_MULI:	ireg[op.Dest] = ireg[op.A] * ireg[op.B];				break;
+		case OP_DIVI:
+		case OP_MODI:
+			if (ireg[op.B] == 0)
+			{
+				I_Error("Division by 0");
+			}
+			ireg[op.Dest] = op.Op == OP_DIVI ? ireg[op.A] / ireg[op.B] : ireg[op.A] % ireg[op.B];
+			break;
+		case OP_ADDF:	freg[op.Dest] = freg[op.A] + freg[op.B];				break;
+		case OP_SUBF:	freg[op.Dest] = freg[op.A] - freg[op.B];				break;
+		case OP_MULF:	freg[op.Dest] = freg[op.A] * freg[op.B];				break;
+		case OP_DIVF:
+		case OP_MODF:
+			if (freg[op.B] == 0)
+			{
+				I_Error("Division by 0");
+			}
+			freg[op.Dest] = op.Op == OP_DIVF ? freg[op.A] / freg[op.B] : fmod(freg[op.A], freg[op.B]);
+			break;
+
+		case OP_LTI:	ireg[op.Dest] = ireg[op.A] < ireg[op.B];				break;
+		case OP_GTI:	ireg[op.Dest] = ireg[op.A] > ireg[op.B];				break;
+		case OP_GEI:	ireg[op.Dest] = ireg[op.A] >= ireg[op.B];				break;
+		case OP_LEI:	ireg[op.Dest] = ireg[op.A] <= ireg[op.B];				break;
+		case OP_EQI:	ireg[op.Dest] = ireg[op.A] == ireg[op.B];				break;
+		case OP_NEI:	ireg[op.Dest] = ireg[op.A] != ireg[op.B];				break;
+		case OP_LTF:	ireg[op.Dest] = freg[op.A] < freg[op.B];				break;
+		case OP_GTF:	ireg[op.Dest] = freg[op.A] > freg[op.B];				break;
+		case OP_GEF:	ireg[op.Dest] = freg[op.A] >= freg[op.B];				break;
+		case OP_LEF:	ireg[op.Dest] = freg[op.A] <= freg[op.B];				break;
+		case OP_EQF:	ireg[op.Dest] = freg[op.A] == freg[op.B];				break;
+		case OP_NEF:	ireg[op.Dest] = freg[op.A] != freg[op.B];				break;
+
+		case OP_SHLI:	ireg[op.Dest] = ireg[op.A] << ireg[op.B];				break;
+		case OP_SHRI:	ireg[op.Dest] = ireg[op.A] >> ireg[op.B];				break;
+		case OP_USHRI:	ireg[op.Dest] = int((unsigned int)(ireg[op.A]) >> ireg[op.B]);	break;
+		case OP_ANDI:	ireg[op.Dest] = ireg[op.A] & ireg[op.B];				break;
+		case OP_ORI:	ireg[op.Dest] = ireg[op.A] | ireg[op.B];				break;
+		case OP_XORI:	ireg[op.Dest] = ireg[op.A] ^ ireg[op.B];				break;
+
+		case OP_ABSI:	ireg[op.Dest] = abs(ireg[op.A]);						break;
+		case OP_ABSF:	freg[op.Dest] = fabs(freg[op.A]);						break;
+
+		case OP_RANDOM:
+			ireg[op.Dest] = (*op.Rng)();
+			break;
+
+		case OP_RANDOMRANGE:
+		{
+			int minval = ireg[op.A];
+			int maxval = ireg[op.B];
+
+			if (maxval < minval)
+			{
+				swapvalues (maxval, minval);
+			}
+			ireg[op.Dest] = (*op.Rng)(maxval - minval + 1) + minval;
+			break;
+		}
+
+		case OP_FRANDOM:
+		{
+			int random = (*op.Rng)(0x40000000);
+			freg[op.Dest] = random / double(0x40000000);
+			break;
+		}
+
+		case OP_FRANDOMRANGE:
+		{
+			double minval = freg[op.A];
+			double maxval = freg[op.B];
+
+			if (maxval < minval)
+			{
+				swapvalues (maxval, minval);
+			}
+			freg[op.Dest] = freg[op.Dest] * (maxval - minval) + minval;
+			break;
+		}
+
+		case OP_RANDOM2:
+			ireg[op.Dest] = op.Rng->Random2(ireg[op.A]);
+			break;
+
+		case OP_JMP:
+			pc = code + op.Arg;
+			break;
+
+		case OP_JZ:
+			if (ireg[op.A] == 0) pc = code + op.Arg;
+			break;
+
+		case OP_JNZ:
+			if (ireg[op.A] != 0) pc = code + op.Arg;
+			break;
+		}
+	}
+
+	ExpVal ret;
+	if (Result.RegType == REGT_INT)
+	{
+		ret.Type = VAL_Int;
+		ret.Int = ireg[Result.RegNum];
+	}
+	else
+	{
+		ret.Type = VAL_Float;
+		ret.Float = freg[Result.RegNum];
+	}
+	return ret;
+}
+
+//==========================================================================
+//
+// Emit
+//
+// Each node emits the same evaluations, in the same order, as its
+// EvalExpression, so that random numbers are drawn identically. The
+// result has the type that EvalExpression's ExpVal would have.
+//
+//==========================================================================
+
+ExpEmit FxExpression::Emit (FxBytecode &build)
+{
+	return build.EmitEval(this);
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+ExpEmit FxConstant::Emit (FxBytecode &build)
+{
+	ExpEmit dest;
+
+	switch (value.Type)
+	{
+	case VAL_Int:
+		dest = build.NewReg(REGT_INT);
+		build.Emit(OP_LI, dest.RegNum).Arg = value.Int;
+		return dest;
+
+	case VAL_Float:
+		dest = build.NewReg(REGT_FLOAT);
+		build.Emit(OP_LF, dest.RegNum).Float = value.Float;
+		return dest;
+
+	default:
+		return build.EmitEval(this);
+	}
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+ExpEmit FxIntCast::Emit (FxBytecode &build)
+{
+	return build.ToInt(basex->Emit(build));
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+ExpEmit FxMinusSign::Emit (FxBytecode &build)
+{
+	ExpEmit op = Operand->Emit(build);
+	ExpEmit dest;
+
+	if (ValueType == VAL_Int)
+	{
+		op = build.ToInt(op);
+		dest = build.NewReg(REGT_INT);
+		build.Emit(OP_NEGI, dest.RegNum, op.RegNum);
+	}
+	else
+	{
+		op = build.ToFloat(op);
+		dest = build.NewReg(REGT_FLOAT);
+		build.Emit(OP_NEGF, dest.RegNum, op.RegNum);
+	}
+	return dest;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+ExpEmit FxUnaryNotBitwise::Emit (FxBytecode &build)
+{
+	ExpEmit op = build.ToInt(Operand->Emit(build));
+	ExpEmit dest = build.NewReg(REGT_INT);
+
+	build.Emit(OP_NOTI, dest.RegNum, op.RegNum);
+	return dest;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+ExpEmit FxUnaryNotBoolean::Emit (FxBytecode &build)
+{
+	ExpEmit op = build.ToBool(Operand->Emit(build));
+	ExpEmit dest = build.NewReg(REGT_INT);
+
+	build.Emit(OP_LNOTI, dest.RegNum, op.RegNum);
+	return dest;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+ExpEmit FxAddSub::Emit (FxBytecode &build)
+{
+	ExpEmit op1 = left->Emit(build);
+	ExpEmit op2 = right->Emit(build);
+	ExpEmit dest;
+
+	if (ValueType == VAL_Float)
+	{
+		op1 = build.ToFloat(op1);
+		op2 = build.ToFloat(op2);
+		dest = build.NewReg(REGT_FLOAT);
+		if (Operator == '+' || Operator == '-')
+		{
+			build.Emit(Operator == '+' ? OP_ADDF : OP_SUBF, dest.RegNum, op1.RegNum, op2.RegNum);
+		}
+		else
+		{
+			build.Emit(OP_LF, dest.RegNum);
+		}
+	}
+	else
+	{
+		op1 = build.ToInt(op1);
+		op2 = build.ToInt(op2);
+		dest = build.NewReg(REGT_INT);
+		if (Operator == '+' || Operator == '-')
+		{
+			build.Emit(Operator == '+' ? OP_ADDI : OP_SUBI, dest.RegNum, op1.RegNum, op2.RegNum);
+		}
+		else
+		{
+			build.Emit(OP_LI, dest.RegNum);
+		}
+	}
+	return dest;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+ExpEmit FxMulDiv::Emit (FxBytecode &build)
+{
+	FxBytecode::FMark mark = build.GetMark();
+	ExpEmit op1 = left->Emit(build);
+	ExpEmit op2 = right->Emit(build);
+	ExpEmit dest;
+	int op;
+
+	if (ValueType == VAL_Float)
+	{
+		op = Operator == '*' ? OP_MULF : Operator == '/' ? OP_DIVF : Operator == '%' ? OP_MODF : -1;
+		op1 = build.ToFloat(op1);
+		op2 = build.ToFloat(op2);
+		dest = build.NewReg(REGT_FLOAT);
+	}
+	else
+	{
+		op = Operator == '*' ? OP_MULI : Operator == '/' ? OP_DIVI : Operator == '%' ? OP_MODI : -1;
+		op1 = build.ToInt(op1);
+		op2 = build.ToInt(op2);
+		dest = build.NewReg(REGT_INT);
+	}
+	if (op < 0)
+	{
+		// The tree still checks for division by 0 here.
+		build.Rewind(mark);
+		return build.EmitEval(this);
+	}
+	build.Emit(op, dest.RegNum, op1.RegNum, op2.RegNum);
+	return dest;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+ExpEmit FxCompareRel::Emit (FxBytecode &build)
+{
+	ExpEmit op1 = left->Emit(build);
+	ExpEmit op2 = right->Emit(build);
+	ExpEmit dest;
+	int op;
+
+	if (left->ValueType == VAL_Float || right->ValueType == VAL_Float)
+	{
+		op1 = build.ToFloat(op1);
+		op2 = build.ToFloat(op2);
+		op = Operator == '<' ? OP_LTF : Operator == '>' ? OP_GTF :
+			 Operator == TK_Geq ? OP_GEF : Operator == TK_Leq ? OP_LEF : -1;
+	}
+	else
+	{
+		op1 = build.ToInt(op1);
+		op2 = build.ToInt(op2);
+		op = Operator == '<' ? OP_LTI : Operator == '>' ? OP_GTI :
+			 Operator == TK_Geq ? OP_GEI : Operator == TK_Leq ? OP_LEI : -1;
+	}
+	dest = build.NewReg(REGT_INT);
+	if (op < 0)
+	{
+		build.Emit(OP_LI, dest.RegNum);
+	}
+	else
+	{
+		build.Emit(op, dest.RegNum, op1.RegNum, op2.RegNum);
+	}
+	return dest;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+ExpEmit FxCompareEq::Emit (FxBytecode &build)
+{
+	ExpEmit dest;
+
+	if (left->ValueType == VAL_Float || right->ValueType == VAL_Float)
+	{
+		ExpEmit op1 = build.ToFloat(left->Emit(build));
+		ExpEmit op2 = build.ToFloat(right->Emit(build));
+		dest = build.NewReg(REGT_INT);
+		build.Emit(Operator == TK_Eq ? OP_EQF : OP_NEF, dest.RegNum, op1.RegNum, op2.RegNum);
+	}
+	else if (ValueType == VAL_Int)
+	{
+		ExpEmit op1 = build.ToInt(left->Emit(build));
+		ExpEmit op2 = build.ToInt(right->Emit(build));
+		dest = build.NewReg(REGT_INT);
+		build.Emit(Operator == TK_Eq ? OP_EQI : OP_NEI, dest.RegNum, op1.RegNum, op2.RegNum);
+	}
+	else
+	{
+		// Pointer comparison is not implemented by the tree either.
+		dest = build.NewReg(REGT_INT);
+		build.Emit(OP_LI, dest.RegNum);
+	}
+	return dest;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+ExpEmit FxBinaryInt::Emit (FxBytecode &build)
+{
+	ExpEmit op1 = build.ToInt(left->Emit(build));
+	ExpEmit op2 = build.ToInt(right->Emit(build));
+	ExpEmit dest = build.NewReg(REGT_INT);
+	int op =
+		Operator == TK_LShift ? OP_SHLI :
+		Operator == TK_RShift ? OP_SHRI :
+		Operator == TK_URShift ? OP_USHRI :
+		Operator == '&' ? OP_ANDI :
+		Operator == '|' ? OP_ORI :
+		Operator == '^' ? OP_XORI : -1;
+
+	if (op < 0)
+	{
+		build.Emit(OP_LI, dest.RegNum);
+	}
+	else
+	{
+		build.Emit(op, dest.RegNum, op1.RegNum, op2.RegNum);
+	}
+	return dest;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+ExpEmit FxBinaryLogical::Emit (FxBytecode &build)
+{
+	ExpEmit op1 = build.ToBool(left->Emit(build));
+	ExpEmit dest = build.NewReg(REGT_INT);
+
+	if (Operator != TK_AndAnd && Operator != TK_OrOr)
+	{
+		build.Emit(OP_LI, dest.RegNum);
+		return dest;
+	}
+
+	build.Move(dest, op1);
+	unsigned jump = build.GetAddress();
+	build.Emit(Operator == TK_AndAnd ? OP_JZ : OP_JNZ, 0, dest.RegNum);
+	build.Move(dest, build.ToBool(right->Emit(build)));
+	build.Backpatch(jump, build.GetAddress());
+	return dest;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+ExpEmit FxConditional::Emit (FxBytecode &build)
+{
+	FxBytecode::FMark mark = build.GetMark();
+	ExpEmit cond = build.ToBool(condition->Emit(build));
+	unsigned jumpfalse = build.GetAddress();
+	build.Emit(OP_JZ, 0, cond.RegNum);
+
+	ExpEmit truereg = truex->Emit(build);
+	if (truereg.RegType != REGT_INT && truereg.RegType != REGT_FLOAT)
+	{
+		build.Rewind(mark);
+		return build.EmitEval(this);
+	}
+	ExpEmit dest = build.Move(build.NewReg(truereg.RegType), truereg);
+	unsigned jumpend = build.GetAddress();
+	build.Emit(OP_JMP);
+
+	build.Backpatch(jumpfalse, build.GetAddress());
+	ExpEmit falsereg = falsex->Emit(build);
+	if (falsereg.RegType != truereg.RegType)
+	{
+		// The result's type would depend on the condition.
+		build.Rewind(mark);
+		return build.EmitEval(this);
+	}
+	build.Move(dest, falsereg);
+	build.Backpatch(jumpend, build.GetAddress());
+	return dest;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+ExpEmit FxAbs::Emit (FxBytecode &build)
+{
+	FxBytecode::FMark mark = build.GetMark();
+	ExpEmit op = val->Emit(build);
+	ExpEmit dest;
+
+	switch (op.RegType)
+	{
+	case REGT_INT:
+		dest = build.NewReg(REGT_INT);
+		build.Emit(OP_ABSI, dest.RegNum, op.RegNum);
+		return dest;
+
+	case REGT_FLOAT:
+		dest = build.NewReg(REGT_FLOAT);
+		build.Emit(OP_ABSF, dest.RegNum, op.RegNum);
+		return dest;
+
+	default:
+		build.Rewind(mark);
+		return build.EmitEval(this);
+	}
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+ExpEmit FxRandom::Emit (FxBytecode &build)
+{
+	if (min != NULL && max != NULL)
+	{
+		ExpEmit minreg = build.ToInt(min->Emit(build));
+		ExpEmit maxreg = build.ToInt(max->Emit(build));
+		return build.EmitRandom(OP_RANDOMRANGE, rng, build.NewReg(REGT_INT).RegNum, minreg.RegNum, maxreg.RegNum);
+	}
+	return build.EmitRandom(OP_RANDOM, rng, build.NewReg(REGT_INT).RegNum);
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+ExpEmit FxFRandom::Emit (FxBytecode &build)
+{
+	// The random number is drawn before the range is evaluated.
+	ExpEmit dest = build.EmitRandom(OP_FRANDOM, rng, build.NewReg(REGT_FLOAT).RegNum);
+
+	if (min != NULL && max != NULL)
+	{
+		ExpEmit minreg = build.ToFloat(min->Emit(build));
+		ExpEmit maxreg = build.ToFloat(max->Emit(build));
+		build.EmitRandom(OP_FRANDOMRANGE, rng, dest.RegNum, minreg.RegNum, maxreg.RegNum);
+	}
+	return dest;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+ExpEmit FxRandom2::Emit (FxBytecode &build)
+{
+	ExpEmit maskreg = build.ToInt(mask->Emit(build));
+	return build.EmitRandom(OP_RANDOM2, rng, build.NewReg(REGT_INT).RegNum, maskreg.RegNum);
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+ExpEmit FxGlobalVariable::Emit (FxBytecode &build)
+{
+	if (!AddressRequested)
+	{
+		ExpEmit dest = build.EmitLoad(var->ValueType, (void*)var->offset, false);
+		if (dest.RegType != REGT_NIL)
+		{
+			return dest;
+		}
+	}
+	return build.EmitEval(this);
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+ExpEmit FxClassMember::Emit (FxBytecode &build)
+{
+	FxBytecode::FMark mark = build.GetMark();
+
+	if (!AddressRequested && classx->ValueType != VAL_Class &&
+		classx->Emit(build).RegType == REGT_SELF)
+	{
+		ExpEmit dest = build.EmitLoad(membervar->ValueType, (void*)membervar->offset, true);
+		if (dest.RegType != REGT_NIL)
+		{
+			return dest;
+		}
+	}
+	build.Rewind(mark);
+	return build.EmitEval(this);
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+ExpEmit FxSelf::Emit (FxBytecode &build)
+{
+	return ExpEmit(0, REGT_SELF);
+}
+
+//==========================================================================
+//
+// FStateExpressions :: Benchmark
+//
+// Evaluates every parameter that has been turned into a constant or
+// into bytecode both through the tree and the way action functions now
+// do, with the owning class's defaults as the caller. Parameters whose
+// bytecode still calls into the tree are skipped, because those calls
+// might have side effects. Random numbers are drawn, so this is refused
+// during a game, and the results of parameters that use them are not
+// compared.
+//
+//==========================================================================
+
+static bool SameValue(const ExpVal &a, const ExpVal &b)
+{
+	if (a.Type != b.Type) return false;
+	switch (a.Type)
+	{
+	case VAL_Float:
+		return a.Float == b.Float;
+
+	case VAL_Int:
+	case VAL_Sound:
+	case VAL_Name:
+	case VAL_Color:
+		return a.Int == b.Int;
+
+	default:
+		return a.pointer == b.pointer;
+	}
+}
+
+void FStateExpressions::Benchmark()
+{
+	cycle_t treetime, fasttime;
+	int numconst = 0, numcode = 0, skipped = 0, mismatches = 0;
+
+	if (gamestate == GS_LEVEL || netgame || demoplayback || demorecording)
+	{
+		Printf ("decoratebench cannot be used during a game.\n");
+		return;
+	}
+
+	treetime.Reset();
+	fasttime.Reset();
+	for (unsigned i = 0; i < Size(); i++)
+	{
+		FStateExpression &exp = expressions[i];
+
+		if (exp.expr == NULL || exp.cloned)
+		{
+			continue;
+		}
+		if (exp.hasvalue)
+		{
+			numconst++;
+		}
+		else if (exp.code != NULL && !exp.code->HasEvals())
+		{
+			numcode++;
+		}
+		else
+		{
+			skipped++;
+			continue;
+		}
+
+		AActor *self = GetDefaultByType(exp.owner);
+		ExpVal treeval, fastval;
+
+		treetime.Clock();
+		for (int j = 0; j < BENCHMARK_REPEATS; j++)
+		{
+			treeval = exp.expr->EvalExpression(self);
+		}
+		treetime.Unclock();
+
+		fasttime.Clock();
+		for (int j = 0; j < BENCHMARK_REPEATS; j++)
+		{
+			Eval(i, self, fastval);
+		}
+		fasttime.Unclock();
+
+		if ((exp.code == NULL || !exp.code->HasRandoms()) && !SameValue(treeval, fastval))
+		{
+			mismatches++;
+		}
+	}
+
+	int calls = (numconst + numcode) * BENCHMARK_REPEATS;
+	Printf ("%d constant and %d compiled parameters, %d left to the tree\n", numconst, numcode, skipped);
+	if (calls > 0)
+	{
+		Printf ("Tree: %.3f ms (%.1f ns per call), now: %.3f ms (%.1f ns per call), %d mismatches\n",
+			treetime.TimeMS(), treetime.TimeMS() * 1e6 / calls,
+			fasttime.TimeMS(), fasttime.TimeMS() * 1e6 / calls, mismatches);
+	}
+}
+
+CCMD (decoratebench)
+{
+	StateParams.Benchmark();
+}
@@ -1091,6 +1091,7 @@ DEFINE_ACTION_FUNCTION_PARAMS(AActor, A_CustomBulletAttack)
 		if (!(Flags & CBAF_NOPITCH)) bslope = P_AimLineAttack (self, bangle, MISSILERANGE);
 
 		S_Sound (self, CHAN_WEAPON, self->AttackSound, 1, ATTN_NORM);
+		P_BeginTraceBatch ();
 		for (i=0 ; i<NumBullets ; i++)
 		{
 			int angle = bangle;
@@ -1114,6 +1115,7 @@ DEFINE_ACTION_FUNCTION_PARAMS(AActor, A_CustomBulletAttack)
 
 			P_LineAttack(self, angle, Range, slope, damage, NAME_Hitscan, pufftype, laflags);
 		}
+		P_EndTraceBatch ();
     }
 }
 
@@ -1282,6 +1284,7 @@ DEFINE_ACTION_FUNCTION_PARAMS(AActor, A_FireBullets)
 	else 
 	{
 		if (NumberOfBullets == -1) NumberOfBullets = 1;
+		P_BeginTraceBatch ();
 		for (i=0 ; i<NumberOfBullets ; i++)
 		{
 			int angle = bangle;
@@ -1305,6 +1308,7 @@ DEFINE_ACTION_FUNCTION_PARAMS(AActor, A_FireBullets)
 
 			P_LineAttack(self, angle, Range, slope, damage, NAME_Hitscan, PuffType, laflags);
 		}
+		P_EndTraceBatch ();
 	}
 }
 
@@ -81,68 +81,31 @@ struct FCompileContext
 
 //==========================================================================
 //
-//
+// Where the bytecode for an expression leaves its result
 //
 //==========================================================================
 
-struct ExpVal
-{
-	ExpValType Type;
-	union
-	{
-		int Int;
-		double Float;
-		void *pointer;
-	};
-
-	int GetInt() const
-	{
-		return Type == VAL_Int? Int : Type == VAL_Float? int(Float) : 0;
-	}
-
-	double GetFloat() const
-	{
-		return Type == VAL_Int? double(Int) : Type == VAL_Float? Float : 0;
-	}
-
-	bool GetBool() const
-	{
-		return (Type == VAL_Int || Type == VAL_Sound) ? !!Int : Type == VAL_Float? Float!=0. : false;
-	}
-	
-	template<class T> T *GetPointer() const
-	{
-		return Type == VAL_Object || Type == VAL_Pointer? (T*)pointer : NULL;
-	}
-
-	FSoundID GetSoundID() const
-	{
-		return Type == VAL_Sound? Int : 0;
-	}
-
-	int GetColor() const
-	{
-		return Type == VAL_Color? Int : 0;
-	}
+class FxBytecode;
 
-	FName GetName() const
-	{
-		return Type == VAL_Name? ENamedName(Int) : NAME_None;
-	}
-	
-	FState *GetState() const
-	{
-		return Type == VAL_State? (FState*)pointer : NULL;
-	}
+enum
+{
+	REGT_NIL,
+	REGT_INT,
+	REGT_FLOAT,
+	REGT_VAL,		// ExpVal of an expression that is evaluated through the tree
+	REGT_SELF,		// the calling actor, which does not need a register
+	NUM_REGT
+};
 
-	const PClass *GetClass() const
-	{
-		return Type == VAL_Class? (const PClass *)pointer : NULL;
-	}
+struct ExpEmit
+{
+	ExpEmit() : RegNum(0), RegType(REGT_NIL) {}
+	ExpEmit(int reg, int type) : RegNum(BYTE(reg)), RegType(BYTE(type)) {}
 
+	BYTE RegNum;
+	BYTE RegType;
 };
 
-
 //==========================================================================
 //
 //
@@ -163,6 +126,7 @@ public:
 	FxExpression *ResolveAsBoolean(FCompileContext &ctx);
 	
 	virtual ExpVal EvalExpression (AActor *self);
+	virtual ExpEmit Emit (FxBytecode &build);
 	virtual bool isConstant() const;
 	virtual void RequestAddress();
 
@@ -290,6 +254,7 @@ public:
 		return true;
 	}
 	ExpVal EvalExpression (AActor *self);
+	ExpEmit Emit (FxBytecode &build);
 };
 
 
@@ -310,6 +275,7 @@ public:
 	FxExpression *Resolve(FCompileContext&);
 
 	ExpVal EvalExpression (AActor *self);
+	ExpEmit Emit (FxBytecode &build);
 };
 
 
@@ -344,6 +310,7 @@ public:
 	~FxMinusSign();
 	FxExpression *Resolve(FCompileContext&);
 	ExpVal EvalExpression (AActor *self);
+	ExpEmit Emit (FxBytecode &build);
 };
 
 //==========================================================================
@@ -361,6 +328,7 @@ public:
 	~FxUnaryNotBitwise();
 	FxExpression *Resolve(FCompileContext&);
 	ExpVal EvalExpression (AActor *self);
+	ExpEmit Emit (FxBytecode &build);
 };
 
 //==========================================================================
@@ -378,6 +346,7 @@ public:
 	~FxUnaryNotBoolean();
 	FxExpression *Resolve(FCompileContext&);
 	ExpVal EvalExpression (AActor *self);
+	ExpEmit Emit (FxBytecode &build);
 };
 
 //==========================================================================
@@ -411,6 +380,7 @@ public:
 	FxAddSub(int, FxExpression*, FxExpression*);
 	FxExpression *Resolve(FCompileContext&);
 	ExpVal EvalExpression (AActor *self);
+	ExpEmit Emit (FxBytecode &build);
 };
 
 //==========================================================================
@@ -426,6 +396,7 @@ public:
 	FxMulDiv(int, FxExpression*, FxExpression*);
 	FxExpression *Resolve(FCompileContext&);
 	ExpVal EvalExpression (AActor *self);
+	ExpEmit Emit (FxBytecode &build);
 };
 
 //==========================================================================
@@ -441,6 +412,7 @@ public:
 	FxCompareRel(int, FxExpression*, FxExpression*);
 	FxExpression *Resolve(FCompileContext&);
 	ExpVal EvalExpression (AActor *self);
+	ExpEmit Emit (FxBytecode &build);
 };
 
 //==========================================================================
@@ -456,6 +428,7 @@ public:
 	FxCompareEq(int, FxExpression*, FxExpression*);
 	FxExpression *Resolve(FCompileContext&);
 	ExpVal EvalExpression (AActor *self);
+	ExpEmit Emit (FxBytecode &build);
 };
 
 //==========================================================================
@@ -471,6 +444,7 @@ public:
 	FxBinaryInt(int, FxExpression*, FxExpression*);
 	FxExpression *Resolve(FCompileContext&);
 	ExpVal EvalExpression (AActor *self);
+	ExpEmit Emit (FxBytecode &build);
 };
 
 //==========================================================================
@@ -491,6 +465,7 @@ public:
 	FxExpression *Resolve(FCompileContext&);
 
 	ExpVal EvalExpression (AActor *self);
+	ExpEmit Emit (FxBytecode &build);
 };
 
 //==========================================================================
@@ -511,6 +486,7 @@ public:
 	FxExpression *Resolve(FCompileContext&);
 
 	ExpVal EvalExpression (AActor *self);
+	ExpEmit Emit (FxBytecode &build);
 };
 
 //==========================================================================
@@ -530,6 +506,7 @@ public:
 	FxExpression *Resolve(FCompileContext&);
 
 	ExpVal EvalExpression (AActor *self);
+	ExpEmit Emit (FxBytecode &build);
 };
 
 //==========================================================================
@@ -551,6 +528,7 @@ public:
 	FxExpression *Resolve(FCompileContext&);
 
 	ExpVal EvalExpression (AActor *self);
+	ExpEmit Emit (FxBytecode &build);
 };
 
 //==========================================================================
@@ -585,6 +563,7 @@ class FxFRandom : public FxRandom
 public:
 	FxFRandom(FRandom *, FxExpression *mi, FxExpression *ma, const FScriptPosition &pos);
 	ExpVal EvalExpression (AActor *self);
+	ExpEmit Emit (FxBytecode &build);
 };
 
 //==========================================================================
@@ -605,6 +584,7 @@ public:
 	FxExpression *Resolve(FCompileContext&);
 
 	ExpVal EvalExpression (AActor *self);
+	ExpEmit Emit (FxBytecode &build);
 };
 
 
@@ -624,6 +604,7 @@ public:
 	FxExpression *Resolve(FCompileContext&);
 	void RequestAddress();
 	ExpVal EvalExpression (AActor *self);
+	ExpEmit Emit (FxBytecode &build);
 };
 
 //==========================================================================
@@ -644,6 +625,7 @@ public:
 	FxExpression *Resolve(FCompileContext&);
 	void RequestAddress();
 	ExpVal EvalExpression (AActor *self);
+	ExpEmit Emit (FxBytecode &build);
 };
 
 //==========================================================================
@@ -658,6 +640,7 @@ public:
 	FxSelf(const FScriptPosition&);
 	FxExpression *Resolve(FCompileContext&);
 	ExpVal EvalExpression (AActor *self);
+	ExpEmit Emit (FxBytecode &build);
 };
 
 //==========================================================================
@@ -823,6 +806,76 @@ public:
 };
 
 
+//==========================================================================
+//
+// FxBytecode
+//
+// A resolved parameter expression compiled for a small register machine.
+// Every node writes to registers of its own, so no allocation is needed.
+// Whatever cannot be compiled is handed back to the expression tree by an
+// OP_EVAL instruction.
+//
+//==========================================================================
+
+enum { MAX_EXP_REGS = 32 };
+
+struct FExpOp
+{
+	BYTE Op;
+	BYTE Dest;
+	BYTE A;
+	BYTE B;
+	int Arg;			// immediate value, jump target or member offset
+	union
+	{
+		double Float;
+		FRandom *Rng;
+		FxExpression *Expr;
+		void *Address;
+	};
+};
+
+class FxBytecode
+{
+public:
+	struct FMark
+	{
+		unsigned CodeSize;
+		int NumRegs[NUM_REGT];
+		int NumEvals;
+		int NumRandoms;
+	};
+
+	FxBytecode();
+
+	static FxBytecode *Compile(FxExpression *x);
+	ExpVal Run(AActor *self) const;
+	bool HasEvals() const { return NumEvals > 0; }
+	bool HasRandoms() const { return NumRandoms > 0; }
+
+	ExpEmit NewReg(int regtype);
+	FExpOp &Emit(int op, int dest = 0, int a = 0, int b = 0);
+	ExpEmit EmitEval(FxExpression *x);
+	ExpEmit EmitLoad(const FExpressionType &type, void *address, bool selfrelative);
+	ExpEmit EmitRandom(int op, FRandom *rng, int dest = 0, int a = 0, int b = 0);
+	ExpEmit ToInt(ExpEmit e);
+	ExpEmit ToFloat(ExpEmit e);
+	ExpEmit ToBool(ExpEmit e);
+	ExpEmit Move(ExpEmit dest, ExpEmit src);
+	unsigned GetAddress() const { return Code.Size(); }
+	void Backpatch(unsigned op, unsigned target) { Code[op].Arg = target; }
+	FMark GetMark() const;
+	void Rewind(const FMark &mark);
+
+private:
+	TArray<FExpOp> Code;
+	int NumRegs[NUM_REGT];
+	int NumEvals;
+	int NumRandoms;
+	bool Failed;
+	ExpEmit Result;
+};
+
 
 FxExpression *ParseExpression (FScanner &sc, PClass *cls);
 
@@ -101,42 +101,40 @@ DEFINE_MEMBER_VARIABLE(Speed, AActor)
 
 int EvalExpressionI (DWORD xi, AActor *self)
 {
-	FxExpression *x = StateParams.Get(xi);
-	if (x == NULL) return 0;
+	ExpVal val;
+	if (!StateParams.Eval(xi, self, val)) return 0;
 
-	return x->EvalExpression (self).GetInt();
+	return val.GetInt();
 }
 
 int EvalExpressionCol (DWORD xi, AActor *self)
 {
-	FxExpression *x = StateParams.Get(xi);
-	if (x == NULL) return 0;
+	ExpVal val;
+	if (!StateParams.Eval(xi, self, val)) return 0;
 
-	return x->EvalExpression (self).GetColor();
+	return val.GetColor();
 }
 
 FSoundID EvalExpressionSnd (DWORD xi, AActor *self)
 {
-	FxExpression *x = StateParams.Get(xi);
-	if (x == NULL) return 0;
+	ExpVal val;
+	if (!StateParams.Eval(xi, self, val)) return 0;
 
-	return x->EvalExpression (self).GetSoundID();
+	return val.GetSoundID();
 }
 
 double EvalExpressionF (DWORD xi, AActor *self)
 {
-	FxExpression *x = StateParams.Get(xi);
-	if (x == NULL) return 0;
+	ExpVal val;
+	if (!StateParams.Eval(xi, self, val)) return 0;
 
-	return x->EvalExpression (self).GetFloat();
+	return val.GetFloat();
 }
 
 fixed_t EvalExpressionFix (DWORD xi, AActor *self)
 {
-	FxExpression *x = StateParams.Get(xi);
-	if (x == NULL) return 0;
-
-	ExpVal val = x->EvalExpression (self);
+	ExpVal val;
+	if (!StateParams.Eval(xi, self, val)) return 0;
 
 	switch (val.Type)
 	{
@@ -151,26 +149,26 @@ fixed_t EvalExpressionFix (DWORD xi, AActor *self)
 
 FName EvalExpressionName (DWORD xi, AActor *self)
 {
-	FxExpression *x = StateParams.Get(xi);
-	if (x == NULL) return 0;
+	ExpVal val;
+	if (!StateParams.Eval(xi, self, val)) return 0;
 
-	return x->EvalExpression (self).GetName();
+	return val.GetName();
 }
 
 const PClass * EvalExpressionClass (DWORD xi, AActor *self)
 {
-	FxExpression *x = StateParams.Get(xi);
-	if (x == NULL) return 0;
+	ExpVal val;
+	if (!StateParams.Eval(xi, self, val)) return 0;
 
-	return x->EvalExpression (self).GetClass();
+	return val.GetClass();
 }
 
 FState *EvalExpressionState (DWORD xi, AActor *self)
 {
-	FxExpression *x = StateParams.Get(xi);
-	if (x == NULL) return 0;
+	ExpVal val;
+	if (!StateParams.Eval(xi, self, val)) return 0;
 
-	return x->EvalExpression (self).GetState();
+	return val.GetState();
 }
 
 
@@ -2822,6 +2820,10 @@ void FStateExpressions::Clear()
 		{
 			delete expressions[i].expr;
 		}
+		if (expressions[i].code != NULL)
+		{
+			delete expressions[i].code;
+		}
 	}
 	expressions.Clear();
 }
@@ -2840,6 +2842,8 @@ int FStateExpressions::Add(FxExpression *x, const PClass *o, bool c)
 	exp.owner = o;
 	exp.constant = c;
 	exp.cloned = false;
+	exp.hasvalue = false;
+	exp.code = NULL;
 	return idx;
 }
 
@@ -2859,6 +2863,8 @@ int FStateExpressions::Reserve(int num, const PClass *cls)
 		exp[i].owner = cls;
 		exp[i].constant = false;
 		exp[i].cloned = false;
+		exp[i].hasvalue = false;
+		exp[i].code = NULL;
 	}
 	return idx;
 }
@@ -2876,6 +2882,7 @@ void FStateExpressions::Set(int num, FxExpression *x, bool cloned)
 		assert(expressions[num].expr == NULL || expressions[num].cloned);
 		expressions[num].expr = x;
 		expressions[num].cloned = cloned;
+		Prepare(num);
 	}
 }
 
@@ -2944,9 +2951,88 @@ int FStateExpressions::ResolveAll()
 		}
 	}
 
+	if (errorcount == 0)
+	{
+		for(unsigned i=0; i<Size(); i++)
+		{
+			Prepare(i);
+		}
+	}
 	return errorcount;
 }
 
+//==========================================================================
+//
+// FStateExpressions :: Prepare
+//
+// Stores the value of a constant expression, or compiles the expression
+// to bytecode, so that it doesn't have to be evaluated through the tree
+// each time its action function is called.
+//
+//==========================================================================
+
+void FStateExpressions::Prepare(int num)
+{
+	FStateExpression &exp = expressions[num];
+
+	if (exp.code != NULL)
+	{
+		delete exp.code;
+		exp.code = NULL;
+	}
+	exp.hasvalue = false;
+
+	if (exp.expr == NULL)
+	{
+		return;
+	}
+	if (exp.expr->isConstant())
+	{
+		exp.value = exp.expr->EvalExpression(NULL);
+		exp.hasvalue = true;
+	}
+	else if (exp.expr->isresolved)
+	{
+		exp.code = FxBytecode::Compile(exp.expr);
+	}
+}
+
+//==========================================================================
+//
+// FStateExpressions :: Eval
+//
+// Returns false if there is no expression at this index.
+//
+//==========================================================================
+
+bool FStateExpressions::Eval(int num, AActor *self, ExpVal &val)
+{
+	if (num < 0 || num >= int(Size()))
+	{
+		return false;
+	}
+
+	FStateExpression &exp = expressions[num];
+
+	if (exp.hasvalue)
+	{
+		val = exp.value;
+	}
+	else if (exp.code != NULL)
+	{
+		val = exp.code->Run(self);
+	}
+	else if (exp.expr != NULL)
+	{
+		val = exp.expr->EvalExpression(self);
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
 //==========================================================================
 //
 //
@@ -57,6 +57,7 @@
 
 #include "i_system.h"
 #include "i_video.h"
+#include "r_drawbgra.h"
 #include "templates.h"
 #include "d_net.h"
 #include "colormatcher.h"
@@ -154,7 +155,7 @@ void STACK_ARGS DCanvas::DrawTextureV(FTexture *img, double x, double y, uint32
 		// Note that this overrides DTA_Translation in software, but not in hardware.
 		FDynamicColormap *colormap = GetSpecialLights(MAKERGB(255,255,255),
 			parms.colorOverlay & MAKEARGB(0,255,255,255), 0);
-		parms.translation = &colormap->Maps[(APART(parms.colorOverlay)*NUMCOLORMAPS/255)*256];
+		parms.translation = &colormap->GetMaps()[(APART(parms.colorOverlay)*NUMCOLORMAPS/255)*256];
 	}
 
 	if (parms.translation != NULL)
@@ -888,6 +889,7 @@ void DCanvas::PUTTRANSDOT (int xx, int yy, int basecolor, int level)
 	}
 
 	BYTE *spot = GetBuffer() + oldyyshifted + xx;
+	R_ReleaseTrueColorRect (spot, 1, 1);
 	DWORD *bg2rgb = Col2RGB8[1+level];
 	DWORD *fg2rgb = Col2RGB8[63-level];
 	DWORD fg = fg2rgb[basecolor];
@@ -938,11 +940,13 @@ void DCanvas::DrawLine(int x0, int y0, int x1, int y1, int palColor, uint32 real
 			swapvalues (x0, x1);
 		}
 		memset (GetBuffer() + y0*GetPitch() + x0, palColor, deltaX+1);
+		R_ReleaseTrueColorRect (GetBuffer() + y0*GetPitch() + x0, deltaX+1, 1);
 	}
 	else if (deltaX == 0)
 	{ // vertical line
 		BYTE *spot = GetBuffer() + y0*GetPitch() + x0;
 		int pitch = GetPitch ();
+		R_ReleaseTrueColorColumn (spot, deltaY);
 		do
 		{
 			*spot = palColor;
@@ -956,6 +960,7 @@ void DCanvas::DrawLine(int x0, int y0, int x1, int y1, int palColor, uint32 real
 		do
 		{
 			*spot = palColor;
+			R_ReleaseTrueColorRect (spot, 1, 1);
 			spot += advance;
 		} while (--deltaY != 0);
 	}
@@ -1064,6 +1069,7 @@ void DCanvas::DrawPixel(int x, int y, int palColor, uint32 realcolor)
 	}
 
 	Buffer[Pitch * y + x] = (BYTE)palColor;
+	R_ReleaseTrueColorRect (Buffer + Pitch * y + x, 1, 1);
 }
 
 //==========================================================================
@@ -1109,6 +1115,7 @@ void DCanvas::Clear (int left, int top, int right, int bottom, int palcolor, uin
 
 	dest = Buffer + top * Pitch + left;
 	x = right - left;
+	R_ReleaseTrueColorRect (dest, x, bottom - top);
 	for (y = top; y < bottom; y++)
 	{
 		memset(dest, palcolor, x);
@@ -1190,7 +1197,7 @@ void DCanvas::FillSimplePoly(FTexture *tex, FVector2 *points, int npoints,
 
 	// Setup constant texture mapping parameters.
 	R_SetupSpanBits(tex);
-	R_SetSpanColormap(colormap != NULL ? &colormap->Maps[clamp(shade >> FRACBITS, 0, NUMCOLORMAPS-1) * 256] : identitymap);
+	R_SetSpanColormap(colormap != NULL ? &colormap->GetMaps()[clamp(shade >> FRACBITS, 0, NUMCOLORMAPS-1) * 256] : identitymap);
 	R_SetSpanSource(tex->GetPixels());
 	scalex = double(1u << (32 - ds_xbits)) / scalex;
 	scaley = double(1u << (32 - ds_ybits)) / scaley;
@@ -1262,6 +1269,7 @@ void DCanvas::FillSimplePoly(FTexture *tex, FVector2 *points, int npoints,
 					ds_y = y;
 					ds_x1 = x1;
 					ds_x2 = x2 - 1;
+					R_ReleaseTrueColorRect (Buffer + y * Pitch + x1, x2 - x1, 1);
 
 					TVector2<double> tex(x1 - originx, y - originy);
 					if (dorotate)
@@ -1311,6 +1319,7 @@ void DCanvas::DrawBlock (int x, int y, int _width, int _height, const BYTE *src)
 
 	destpitch = Pitch;
 	dest = Buffer + y*Pitch + x;
+	R_ReleaseTrueColorRect (dest, _width, _height);
 
 	do
 	{
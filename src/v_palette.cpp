@@ -283,16 +283,25 @@ void FPalette::MakeRemap (const DWORD *colors, BYTE *remap, const BYTE *useful,
 		}
 	}
 
-	// Find near matches
+	// Find near matches. The color matcher gives the same result as
+	// BestColor for the game palette without searching all of it.
 	if (k > 0)
 	{
 		for (i = 0; i <= j; ++i)
 		{
 			if (workspace[i].Foreign == 1)
 			{
-				remap[workspace[i].PalEntry] = BestColor ((DWORD *)BaseColors,
-					RPART(workspace[i].Color), GPART(workspace[i].Color), BPART(workspace[i].Color),
-					1, 255);
+				if (this == &GPalette)
+				{
+					remap[workspace[i].PalEntry] = ColorMatcher.Pick (
+						RPART(workspace[i].Color), GPART(workspace[i].Color), BPART(workspace[i].Color));
+				}
+				else
+				{
+					remap[workspace[i].PalEntry] = BestColor ((DWORD *)BaseColors,
+						RPART(workspace[i].Color), GPART(workspace[i].Color), BPART(workspace[i].Color),
+						1, 255);
+				}
 			}
 		}
 	}
@@ -64,6 +64,7 @@
 #include "r_renderer.h"
 #include "menu/menu.h"
 #include "r_data/voxels.h"
+#include "r_drawbgra.h"
 
 
 FRenderer *Renderer;
@@ -107,6 +108,116 @@ public:
 };
 IMPLEMENT_ABSTRACT_CLASS (DDummyFrameBuffer)
 
+//==========================================================================
+//
+// Null video device
+//
+// Used for headless runs (-benchmark). It never opens a window or talks
+// to the display; its frame buffer is plain memory that is never shown.
+//
+//==========================================================================
+
+class DNullFrameBuffer : public DFrameBuffer
+{
+	DECLARE_CLASS (DNullFrameBuffer, DFrameBuffer);
+public:
+	DNullFrameBuffer (int width, int height)
+		: DFrameBuffer (width, height)
+	{
+		memcpy (SourcePalette, GPalette.BaseColors, sizeof(SourcePalette));
+		Flash = 0;
+		FlashAmount = 0;
+	}
+	bool Lock(bool buffered) { return DSimpleCanvas::Lock (); }
+	void Update() { Unlock (); }
+	PalEntry *GetPalette() { return SourcePalette; }
+	void GetFlashedPalette(PalEntry palette[256])
+	{
+		memcpy (palette, SourcePalette, sizeof(SourcePalette));
+		if (FlashAmount)
+		{
+			DoBlending (palette, palette, 256, Flash.r, Flash.g, Flash.b, FlashAmount);
+		}
+	}
+	void UpdatePalette() {}
+	bool SetGamma(float gamma) { return true; }
+	bool SetFlash(PalEntry rgb, int amount) { Flash = rgb; FlashAmount = amount; return true; }
+	void GetFlash(PalEntry &rgb, int &amount) { rgb = Flash; amount = FlashAmount; }
+	int GetPageCount() { return 1; }
+	bool IsFullscreen() { return false; }
+#ifdef _WIN32
+	void PaletteChanged() {}
+	int QueryNewPalette() { return 0; }
+	bool Is8BitMode() { return false; }
+#endif
+
+private:
+	PalEntry SourcePalette[256];
+	PalEntry Flash;
+	int FlashAmount;
+};
+IMPLEMENT_ABSTRACT_CLASS (DNullFrameBuffer)
+
+class FNullVideo : public IVideo
+{
+public:
+	EDisplayType GetDisplayType () { return DISPLAY_WindowOnly; }
+	void SetWindowedScale (float scale) {}
+
+	DFrameBuffer *CreateFrameBuffer (int width, int height, bool fs, DFrameBuffer *old)
+	{
+		if (old != NULL)
+		{
+			if (old->GetWidth() == width && old->GetHeight() == height)
+			{
+				return old;
+			}
+			old->ObjectFlags |= OF_YesReallyDelete;
+			if (screen == old) screen = NULL;
+			delete old;
+		}
+		return new DNullFrameBuffer (width, height);
+	}
+
+	void StartModeIterator (int bits, bool fs)
+	{
+		IteratorMode = 0;
+		IteratorBits = bits;
+	}
+
+	bool NextMode (int *width, int *height, bool *letterbox)
+	{
+		static const struct { int Width, Height; } NullModes[] =
+		{
+			{ 320, 200 },
+			{ 640, 400 },
+			{ 640, 480 },
+			{ 800, 600 },
+			{ 1024, 768 },
+			{ 1280, 720 },
+			{ 1920, 1080 },
+		};
+
+		if (IteratorBits != 8 || (unsigned)IteratorMode >= sizeof(NullModes)/sizeof(NullModes[0]))
+		{
+			return false;
+		}
+		*width = NullModes[IteratorMode].Width;
+		*height = NullModes[IteratorMode].Height;
+		++IteratorMode;
+		return true;
+	}
+
+private:
+	int IteratorMode;
+	int IteratorBits;
+};
+
+IVideo *V_CreateNullVideo ()
+{
+	return new FNullVideo;
+}
+
 // SimpleCanvas is not really abstract, but this macro does not
 // try to generate a CreateNew() function.
 IMPLEMENT_ABSTRACT_CLASS (DSimpleCanvas)
@@ -379,6 +490,7 @@ void DCanvas::Dim (PalEntry color, float damount, int x1, int y1, int w, int h)
 
 	spot = Buffer + x1 + y1*Pitch;
 	gap = Pitch - w;
+	R_ReleaseTrueColorRect (spot, w, h);
 	for (y = h; y != 0; y--)
 	{
 		for (x = w; x != 0; x--)
@@ -1071,6 +1183,19 @@ void DFrameBuffer::SetVSync (bool vsync)
 {
 }
 
+//==========================================================================
+//
+// DFrameBuffer :: CanPresentTrueColor
+//
+// Only framebuffers that composite the BGRA view in Update override this.
+//
+//==========================================================================
+
+bool DFrameBuffer::CanPresentTrueColor ()
+{
+	return false;
+}
+
 //==========================================================================
 //
 // DFrameBuffer :: NewRefreshRate
@@ -1176,6 +1301,8 @@ bool DFrameBuffer::WipeStartScreen(int type)
 
 void DFrameBuffer::WipeEndScreen()
 {
+	// The wipe replaces the view it was rendered with.
+	R_ReleaseTrueColorView();
 	wipe_EndScreen();
 	Unlock();
 }
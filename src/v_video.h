@@ -366,6 +366,10 @@ public:
 	// Set the rect defining the area affected by blending.
 	virtual void SetBlendingRect (int x1, int y1, int x2, int y2);
 
+	// Returns true if Update shows the true color copy of the 3D view that
+	// the software renderer makes with r_swtruecolor.
+	virtual bool CanPresentTrueColor ();
+
 	bool Accel2D;	// If true, 2D drawing can be accelerated.
 
 	// Begin 2D drawing operations. This is like Update, but it doesn't end
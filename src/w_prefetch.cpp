@@ -0,0 +1,493 @@
+/*
+** w_prefetch.cpp
+** Decompresses lumps on other threads before they are needed
+**
+** When loading a large mod, a lot of time goes into inflating lumps from
+** Zips one after the other as the texture manager or the level setup asks
+** for them. Often, though, it is known beforehand which lumps are going to
+** be read, and in what order. Given such a list, the compressed data is
+** read here on the main thread, since the resource files are not safe to
+** use from several threads, and handed to the prefetch threads to unpack.
+** When CacheLump then asks for one of them, it takes the finished data
+** instead of decompressing the lump itself, and only has to wait if it is
+** still being worked on.
+**
+** To keep memory in check, only PREFETCH_BUDGET bytes of lumps are in
+** flight at a time. Lumps on the list before the one being claimed are
+** assumed to be no longer needed and are thrown away.
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 The GZ3Doom developers
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+
+#include "workerthreads.h"
+#include "doomtype.h"
+#include "c_cvars.h"
+#include "i_system.h"
+#include "stats.h"
+#include "w_wad.h"
+#include "w_prefetch.h"
+#include "resourcefiles/resourcefile.h"
+
+// MACROS ------------------------------------------------------------------
+
+#define MAX_PREFETCH_THREADS	16
+#define PREFETCH_BUDGET			(64*1024*1024)
+
+// TYPES -------------------------------------------------------------------
+
+enum EPrefetchState
+{
+	PF_Waiting,		// not read yet
+	PF_Queued,		// compressed data read, waiting for a thread
+	PF_Busy,		// being decompressed
+	PF_Done,		// decompressed, waiting to be claimed
+	PF_Finished,	// claimed, dropped, or could not be prefetched
+};
+
+struct FPrefetchJob
+{
+	FResourceLump *Lump;
+	BYTE *Compressed;
+	char *Data;
+	int State;
+};
+
+// PUBLIC DATA DEFINITIONS -------------------------------------------------
+
+CUSTOM_CVAR (Int, w_prefetchthreads, 2, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+{
+	if (self < 0)
+	{
+		self = 0;
+	}
+	else if (self > MAX_PREFETCH_THREADS)
+	{
+		self = MAX_PREFETCH_THREADS;
+	}
+}
+
+// PRIVATE DATA DEFINITIONS ------------------------------------------------
+
+static TArray<FPrefetchJob> Jobs;
+static TMap<FResourceLump *, unsigned> JobIndex;
+static unsigned NextToQueue;	// next job to read the compressed data for
+static unsigned NextToRun;		// first job the threads might find queued
+static unsigned NextToDrop;		// first job that might still hold memory
+static size_t PendingBytes;
+static int BusyJobs;
+static bool PrefetchActive;
+
+static FWorkerLock *Lock;
+static FWorkerSemaphore *WorkReady, *WorkDone;
+static FWorkerThread Threads[MAX_PREFETCH_THREADS];
+static int NumThreads;
+static int ThreadsRequested;
+static bool QuitThreads;
+
+static int PrefetchClaimed, PrefetchWaited, PrefetchDropped;
+
+// CODE --------------------------------------------------------------------
+
+//==========================================================================
+//
+// RunJob
+//
+// Decompresses a job that has been marked busy. The lock must not be held.
+//
+//==========================================================================
+
+static void RunJob (FPrefetchJob *job)
+{
+	FResourceLump *lump = job->Lump;
+	char *data = new char[lump->LumpSize];
+	bool ok;
+
+	try
+	{
+		ok = lump->DecompressData (job->Compressed, data);
+	}
+	catch (...)
+	{
+		// Leave it to CacheLump to report the error on the main thread.
+		ok = false;
+	}
+
+	Lock->Enter();
+	delete[] job->Compressed;
+	job->Compressed = NULL;
+	if (ok)
+	{
+		job->Data = data;
+		job->State = PF_Done;
+	}
+	else
+	{
+		delete[] data;
+		job->State = PF_Finished;
+		PendingBytes -= lump->LumpSize;
+	}
+	BusyJobs--;
+	Lock->Leave();
+	WorkDone->Post();
+}
+
+//==========================================================================
+//
+// PrefetchThreadLoop
+//
+//==========================================================================
+
+static void PrefetchThreadLoop (void *)
+{
+	for (;;)
+	{
+		FPrefetchJob *job = NULL;
+
+		WorkReady->Wait();
+		if (QuitThreads)
+		{
+			break;
+		}
+		Lock->Enter();
+		while (NextToRun < NextToQueue && Jobs[NextToRun].State != PF_Queued)
+		{
+			NextToRun++;
+		}
+		if (NextToRun < NextToQueue)
+		{
+			job = &Jobs[NextToRun++];
+			job->State = PF_Busy;
+			BusyJobs++;
+		}
+		Lock->Leave();
+		if (job != NULL)
+		{
+			RunJob (job);
+		}
+	}
+}
+
+//==========================================================================
+//
+// W_ShutdownPrefetch
+//
+//==========================================================================
+
+void W_ShutdownPrefetch ()
+{
+	int i;
+
+	W_StopPrefetch ();
+	QuitThreads = true;
+	for (i = 0; i < NumThreads; ++i)
+	{
+		WorkReady->Post();
+	}
+	for (i = 0; i < NumThreads; ++i)
+	{
+		Threads[i].Join();
+	}
+	NumThreads = 0;
+	ThreadsRequested = 0;
+	QuitThreads = false;
+	if (Lock != NULL)
+	{
+		delete Lock;
+		delete WorkReady;
+		delete WorkDone;
+		Lock = NULL;
+		WorkReady = WorkDone = NULL;
+	}
+}
+
+//==========================================================================
+//
+// StartPrefetchThreads
+//
+// Returns the number of threads that could be started.
+//
+//==========================================================================
+
+static int StartPrefetchThreads (int count)
+{
+	static bool setatterm;
+
+	if (count == ThreadsRequested)
+	{
+		return NumThreads;
+	}
+	W_ShutdownPrefetch ();
+	ThreadsRequested = count;
+	if (count <= 0)
+	{
+		return 0;
+	}
+	if (!setatterm)
+	{
+		setatterm = true;
+		atterm (W_ShutdownPrefetch);
+	}
+
+	Lock = new FWorkerLock;
+	WorkReady = new FWorkerSemaphore;
+	WorkDone = new FWorkerSemaphore;
+	for (NumThreads = 0; NumThreads < count; ++NumThreads)
+	{
+		if (!Threads[NumThreads].Start (PrefetchThreadLoop, NULL))
+		{
+			break;
+		}
+	}
+	return NumThreads;
+}
+
+//==========================================================================
+//
+// QueueJobs
+//
+// Reads the compressed data for as many jobs as fit in the budget.
+//
+//==========================================================================
+
+static void QueueJobs ()
+{
+	while (NextToQueue < Jobs.Size() && PendingBytes < PREFETCH_BUDGET)
+	{
+		FPrefetchJob *job = &Jobs[NextToQueue];
+		BYTE *compressed = NULL;
+
+		if (job->State == PF_Waiting)
+		{
+			compressed = job->Lump->ReadCompressed();
+		}
+
+		Lock->Enter();
+		if (compressed != NULL)
+		{
+			job->Compressed = compressed;
+			job->State = PF_Queued;
+			PendingBytes += job->Lump->LumpSize;
+		}
+		else
+		{
+			job->State = PF_Finished;
+		}
+		NextToQueue++;
+		Lock->Leave();
+
+		if (compressed != NULL)
+		{
+			WorkReady->Post();
+		}
+	}
+}
+
+//==========================================================================
+//
+// DropJob
+//
+// Frees a job's memory. The lock must be held and the job must not be busy.
+//
+//==========================================================================
+
+static void DropJob (FPrefetchJob *job)
+{
+	if (job->State == PF_Queued || job->State == PF_Done)
+	{
+		delete[] job->Compressed;
+		delete[] job->Data;
+		job->Compressed = NULL;
+		job->Data = NULL;
+		PendingBytes -= job->Lump->LumpSize;
+		PrefetchDropped++;
+	}
+	job->State = PF_Finished;
+}
+
+//==========================================================================
+//
+// W_PrefetchLumps
+//
+//==========================================================================
+
+void W_PrefetchLumps (const TArray<int> &lumps)
+{
+	W_StopPrefetch ();
+	if (StartPrefetchThreads (w_prefetchthreads) == 0)
+	{
+		return;
+	}
+
+	for (unsigned i = 0; i < lumps.Size(); ++i)
+	{
+		FResourceLump *lump = Wads.GetResourceLump (lumps[i]);
+
+		if (lump != NULL && lump->Cache == NULL && lump->LumpSize > 0 && JobIndex.CheckKey (lump) == NULL)
+		{
+			FPrefetchJob job = { lump, NULL, NULL, PF_Waiting };
+
+			JobIndex[lump] = Jobs.Push (job);
+		}
+	}
+	if (Jobs.Size() > 0)
+	{
+		PrefetchActive = true;
+		QueueJobs ();
+	}
+}
+
+//==========================================================================
+//
+// W_StopPrefetch
+//
+//==========================================================================
+
+void W_StopPrefetch ()
+{
+	if (!PrefetchActive)
+	{
+		return;
+	}
+
+	Lock->Enter();
+	for (unsigned i = 0; i < Jobs.Size(); ++i)
+	{
+		if (Jobs[i].State != PF_Busy)
+		{
+			DropJob (&Jobs[i]);
+		}
+	}
+	while (BusyJobs > 0)
+	{
+		Lock->Leave();
+		WorkDone->Wait();
+		Lock->Enter();
+	}
+	for (unsigned i = 0; i < Jobs.Size(); ++i)
+	{
+		DropJob (&Jobs[i]);
+	}
+	Jobs.Clear();
+	JobIndex.Clear();
+	NextToQueue = NextToRun = NextToDrop = 0;
+	PendingBytes = 0;
+	PrefetchActive = false;
+	Lock->Leave();
+}
+
+//==========================================================================
+//
+// W_ClaimPrefetchedLump
+//
+//==========================================================================
+
+char *W_ClaimPrefetchedLump (FResourceLump *lump)
+{
+	if (!PrefetchActive)
+	{
+		return NULL;
+	}
+
+	unsigned *pindex = JobIndex.CheckKey (lump);
+	if (pindex == NULL)
+	{
+		return NULL;
+	}
+
+	unsigned index = *pindex;
+	FPrefetchJob *job = &Jobs[index];
+	char *data = NULL;
+
+	Lock->Enter();
+	if (job->State == PF_Queued)
+	{
+		// No thread has got to it yet, so don't wait for one.
+		job->State = PF_Busy;
+		BusyJobs++;
+		Lock->Leave();
+		RunJob (job);
+		Lock->Enter();
+	}
+	else if (job->State == PF_Busy)
+	{
+		PrefetchWaited++;
+		while (job->State == PF_Busy)
+		{
+			Lock->Leave();
+			WorkDone->Wait();
+			Lock->Enter();
+		}
+	}
+	if (job->State == PF_Done)
+	{
+		data = job->Data;
+		job->Data = NULL;
+		PendingBytes -= lump->LumpSize;
+		PrefetchClaimed++;
+	}
+	job->State = PF_Finished;
+
+	// Anything earlier in the list was passed over and is not needed anymore.
+	bool skippedbusy = false;
+	for (unsigned i = NextToDrop; i < index; ++i)
+	{
+		if (Jobs[i].State == PF_Busy)
+		{
+			skippedbusy = true;
+		}
+		else
+		{
+			DropJob (&Jobs[i]);
+			if (!skippedbusy)
+			{
+				NextToDrop = i + 1;
+			}
+		}
+	}
+	Lock->Leave();
+
+	QueueJobs ();
+	return data;
+}
+
+//==========================================================================
+//
+// STAT prefetch
+//
+//==========================================================================
+
+ADD_STAT (prefetch)
+{
+	FString out;
+	out.Format ("%d threads, %u of %u lumps read, %u KB pending, %d claimed, %d waited for, %d dropped",
+		NumThreads, NextToQueue, Jobs.Size(), unsigned(PendingBytes >> 10),
+		PrefetchClaimed, PrefetchWaited, PrefetchDropped);
+	return out;
+}
@@ -56,6 +56,8 @@
 #include "doomerrors.h"
 #include "resourcefiles/resourcefile.h"
 #include "md5.h"
+#include "w_prefetch.h"
+#include "stats.h"
 
 // MACROS ------------------------------------------------------------------
 
@@ -70,6 +72,20 @@ struct FWadCollection::LumpRecord
 	FResourceLump *lump;
 };
 
+// A name table slot holds a copy of everything CheckNumForName needs to
+// know about a lump, so that a probe never has to look at the lump itself.
+struct FWadCollection::LumpNameSlot
+{
+	QWORD		Name;
+	int			Namespace;
+	DWORD		Lump;		// NULL_INDEX if the slot is empty
+};
+
+// Set in LumpNameSlot::Lump for lumps in the global namespace that do not
+// come from a Zip. These are also found when looking in a namespace that
+// is exclusive to Zips.
+#define SLOT_NOTZIP		(0x80000000)
+
 // EXTERNAL FUNCTION PROTOTYPES --------------------------------------------
 extern bool nospriterename;
 
@@ -105,7 +121,7 @@ void uppercopy (char *to, const char *from)
 }
 
 FWadCollection::FWadCollection ()
-: FirstLumpIndex(NULL), NextLumpIndex(NULL),
+: NameTable(NULL), NameTableMask(0),
   FirstLumpIndex_FullName(NULL), NextLumpIndex_FullName(NULL), 
   NumLumps(0)
 {
@@ -118,15 +134,12 @@ FWadCollection::~FWadCollection ()
 
 void FWadCollection::DeleteAll ()
 {
-	if (FirstLumpIndex != NULL)
-	{
-		delete[] FirstLumpIndex;
-		FirstLumpIndex = NULL;
-	}
-	if (NextLumpIndex != NULL)
+	W_StopPrefetch ();
+	if (NameTable != NULL)
 	{
-		delete[] NextLumpIndex;
-		NextLumpIndex = NULL;
+		delete[] NameTable;
+		NameTable = NULL;
+		NameTableMask = 0;
 	}
 	if (FirstLumpIndex_FullName != NULL)
 	{
@@ -185,8 +198,6 @@ void FWadCollection::InitMultipleFiles (TArray<FString> &filenames)
 	RenameSprites();
 
 	// [RH] Set up hash table
-	FirstLumpIndex = new DWORD[NumLumps];
-	NextLumpIndex = new DWORD[NumLumps];
 	FirstLumpIndex_FullName = new DWORD[NumLumps];
 	NextLumpIndex_FullName = new DWORD[NumLumps];
 	InitHashChains ();
@@ -243,7 +254,16 @@ void FWadCollection::AddFile (const char *filename, FileReader *wadinfo)
 		{
 			try
 			{
-				wadinfo = new FileReader(filename);
+				// With -mmap, uncompressed lumps are used straight from
+				// the mapped file instead of being read into memory.
+				if (Args->CheckParm("-mmap"))
+				{
+					wadinfo = new MappedFileReader(filename);
+				}
+				else
+				{
+					wadinfo = new FileReader(filename);
+				}
 			}
 			catch (CRecoverableError &err)
 			{ // Didn't find file
@@ -364,6 +384,21 @@ int FWadCollection::GetNumWads () const
 	return Files.Size();
 }
 
+//==========================================================================
+//
+// NameSlotHash
+//
+// Hash for the name table. Works on the name as a whole, which must
+// already be uppercase and padded with zeros.
+//
+//==========================================================================
+
+static inline DWORD NameSlotHash (QWORD qname)
+{
+	DWORD hash = DWORD(qname) * 0x9E3779B1u ^ DWORD(qname >> 32) * 0x85EBCA77u;
+	return hash ^ (hash >> 16);
+}
+
 //==========================================================================
 //
 // W_CheckNumForName
@@ -397,32 +432,35 @@ int FWadCollection::CheckNumForName (const char *name, int space)
 	}
 
 	uppercopy (uname, name);
-	i = FirstLumpIndex[LumpNameHash (uname) % NumLumps];
+	if (qname == 0)
+	{
+		return ScanForName (qname, space, -1, false);
+	}
 
-	while (i != NULL_INDEX)
+	for (i = NameSlotHash (qname) & NameTableMask; ; i = (i + 1) & NameTableMask)
 	{
-		FResourceLump *lump = LumpInfo[i].lump;
+		const LumpNameSlot *slot = &NameTable[i];
 
-		if (lump->qwName == qname)
+		if (slot->Lump == NULL_INDEX)
 		{
-			if (lump->Namespace == space) break;
+			return -1;
+		}
+		if (slot->Name == qname)
+		{
+			if (slot->Namespace == space) break;
 			// If the lump is from one of the special namespaces exclusive to Zips
 			// the check has to be done differently:
 			// If we find a lump with this name in the global namespace that does not come
 			// from a Zip return that. WADs don't know these namespaces and single lumps must
 			// work as well.
-			if (space > ns_specialzipdirectory && lump->Namespace == ns_global && 
-				!(lump->Flags & LUMPF_ZIPFILE)) break;
+			if (space > ns_specialzipdirectory && (slot->Lump & SLOT_NOTZIP)) break;
 		}
-		i = NextLumpIndex[i];
 	}
-
-	return i != NULL_INDEX ? i : -1;
+	return NameTable[i].Lump & ~SLOT_NOTZIP;
 }
 
 int FWadCollection::CheckNumForName (const char *name, int space, int wadnum, bool exact)
 {
-	FResourceLump *lump;
 	union
 	{
 		char uname[8];
@@ -436,20 +474,63 @@ int FWadCollection::CheckNumForName (const char *name, int space, int wadnum, bo
 	}
 
 	uppercopy (uname, name);
-	i = FirstLumpIndex[LumpNameHash (uname) % NumLumps];
+	if (qname == 0)
+	{
+		return ScanForName (qname, space, wadnum, exact);
+	}
 
 	// If exact is true if will only find lumps in the same WAD, otherwise
 	// also those in earlier WADs.
 
-	while (i != NULL_INDEX &&
-		(lump = LumpInfo[i].lump, lump->qwName != qname ||
-		lump->Namespace != space ||
-		 (exact? (LumpInfo[i].wadnum != wadnum) : (LumpInfo[i].wadnum > wadnum)) ))
+	for (i = NameSlotHash (qname) & NameTableMask; NameTable[i].Lump != NULL_INDEX; i = (i + 1) & NameTableMask)
 	{
-		i = NextLumpIndex[i];
+		const LumpNameSlot *slot = &NameTable[i];
+
+		if (slot->Name == qname && slot->Namespace == space)
+		{
+			DWORD lump = slot->Lump & ~SLOT_NOTZIP;
+			if (exact? (LumpInfo[lump].wadnum == wadnum) : (LumpInfo[lump].wadnum <= wadnum))
+			{
+				return lump;
+			}
+		}
 	}
+	return -1;
+}
 
-	return i != NULL_INDEX ? i : -1;
+//==========================================================================
+//
+// ScanForName
+//
+// Looks through all lumps from last to first, with the same rules as
+// CheckNumForName. Used for lumps without a name, which are not in the
+// name table, and by lumplookupbench to check the table.
+//
+//==========================================================================
+
+int FWadCollection::ScanForName (QWORD qname, int space, int wadnum, bool exact)
+{
+	for (int i = NumLumps - 1; i >= 0; --i)
+	{
+		FResourceLump *lump = LumpInfo[i].lump;
+
+		if (lump->qwName != qname)
+		{
+			continue;
+		}
+		if (wadnum < 0)
+		{
+			if (lump->Namespace == space) return i;
+			if (space > ns_specialzipdirectory && lump->Namespace == ns_global &&
+				!(lump->Flags & LUMPF_ZIPFILE)) return i;
+		}
+		else if (lump->Namespace == space &&
+			(exact? (LumpInfo[i].wadnum == wadnum) : (LumpInfo[i].wadnum <= wadnum)))
+		{
+			return i;
+		}
+	}
+	return -1;
 }
 
 //==========================================================================
@@ -579,6 +660,21 @@ FTexture *FWadCollection::GetLinkedTexture(int lump)
 	return NULL;
 }
 
+//==========================================================================
+//
+// GetResourceLump
+//
+//==========================================================================
+
+FResourceLump *FWadCollection::GetResourceLump(int lump) const
+{
+	if ((size_t)lump < NumLumps)
+	{
+		return LumpInfo[lump].lump;
+	}
+	return NULL;
+}
+
 //==========================================================================
 //
 // W_LumpLength
@@ -668,24 +764,52 @@ DWORD FWadCollection::LumpNameHash (const char *s)
 
 void FWadCollection::InitHashChains (void)
 {
-	char name[8];
 	unsigned int i, j;
+	DWORD size;
+
+	// Keep the name table at most half full so that probes stay short.
+	for (size = 16; size < NumLumps * 2; size <<= 1)
+	{
+	}
+	NameTable = new LumpNameSlot[size];
+	NameTableMask = size - 1;
+	for (j = 0; j < size; j++)
+	{
+		NameTable[j].Name = 0;
+		NameTable[j].Namespace = 0;
+		NameTable[j].Lump = NULL_INDEX;
+	}
+
+	// Insert the lumps from last to first, so that a probe meets lumps
+	// of the same name in the order CheckNumForName must return them.
+	// Lumps without a name are left to ScanForName.
+	for (i = NumLumps; i-- > 0; )
+	{
+		FResourceLump *lump = LumpInfo[i].lump;
+
+		if (lump->qwName == 0)
+		{
+			continue;
+		}
+		for (j = NameSlotHash (lump->qwName) & NameTableMask; NameTable[j].Lump != NULL_INDEX; j = (j + 1) & NameTableMask)
+		{
+		}
+		NameTable[j].Name = lump->qwName;
+		NameTable[j].Namespace = lump->Namespace;
+		NameTable[j].Lump = i;
+		if (lump->Namespace == ns_global && !(lump->Flags & LUMPF_ZIPFILE))
+		{
+			NameTable[j].Lump |= SLOT_NOTZIP;
+		}
+	}
 
 	// Mark all buckets as empty
-	memset (FirstLumpIndex, 255, NumLumps*sizeof(FirstLumpIndex[0]));
-	memset (NextLumpIndex, 255, NumLumps*sizeof(NextLumpIndex[0]));
 	memset (FirstLumpIndex_FullName, 255, NumLumps*sizeof(FirstLumpIndex_FullName[0]));
 	memset (NextLumpIndex_FullName, 255, NumLumps*sizeof(NextLumpIndex_FullName[0]));
 
-	// Now set up the chains
+	// Now set up the chains for the full paths
 	for (i = 0; i < (unsigned)NumLumps; i++)
 	{
-		uppercopy (name, LumpInfo[i].lump->Name);
-		j = LumpNameHash (name) % NumLumps;
-		NextLumpIndex[i] = FirstLumpIndex[j];
-		FirstLumpIndex[j] = i;
-
-		// Do the same for the full paths
 		if (LumpInfo[i].lump->FullName!=NULL)
 		{
 			j = MakeKey(LumpInfo[i].lump->FullName) % NumLumps;
@@ -1311,6 +1435,171 @@ bool FWadCollection::IsEncryptedFile(int lump) const
 	return !!(LumpInfo[lump].lump->Flags & LUMPF_BLOODCRYPT);
 }
 
+//==========================================================================
+//
+// SaveDirectoryCaches
+//
+// Lets the resource files store their directories for the next start,
+// then removes the ones left over from archives that have changed.
+//
+//==========================================================================
+
+void FWadCollection::SaveDirectoryCaches()
+{
+	for (unsigned i = 0; i < Files.Size(); ++i)
+	{
+		Files[i]->SaveDirectoryCache();
+	}
+	Zip_PruneDirectoryCache();
+}
+
+//==========================================================================
+//
+// PrintCacheStats
+//
+// Lists how much of each file's cached lump data is used in place from
+// a mapped or in-memory file and how much had to be copied.
+//
+//==========================================================================
+
+void FWadCollection::PrintCacheStats() const
+{
+	size_t resident = 0, copied = 0;
+
+	for (unsigned i = 0; i < Files.Size(); ++i)
+	{
+		const FResourceFile *file = Files[i];
+		bool mapped = file->Reader != NULL && file->Reader->GetBuffer() != NULL;
+
+		Printf ("%3u %c %8u KB resident %8u KB copied  %s\n", i, mapped ? '*' : ' ',
+			unsigned(file->ResidentBytes >> 10), unsigned(file->CopiedBytes >> 10), file->Filename);
+		resident += file->ResidentBytes;
+		copied += file->CopiedBytes;
+	}
+	Printf ("Total: %u KB resident, %u KB copied\n", unsigned(resident >> 10), unsigned(copied >> 10));
+}
+
+CCMD (lumpcachestats)
+{
+	Wads.PrintCacheStats();
+}
+
+//==========================================================================
+//
+// BenchmarkLookups
+//
+// Looks up the name of every lump that has one, in its own namespace,
+// in a Zip-only namespace and with a name that is not there, both with
+// the name table and with the CRC hash chains it replaced, which are
+// rebuilt here for comparison.
+//
+//==========================================================================
+
+void FWadCollection::BenchmarkLookups()
+{
+	TArray<QWORD> names;
+	TArray<int> spaces;
+	unsigned i, j;
+
+	for (i = 0; i < NumLumps; i++)
+	{
+		FResourceLump *lump = LumpInfo[i].lump;
+		if (lump->qwName != 0)
+		{
+			union
+			{
+				char miss[8];
+				QWORD qmiss;
+			};
+
+			qmiss = lump->qwName;
+			miss[0] = '\x7f';
+			names.Push(lump->qwName);
+			spaces.Push(lump->Namespace);
+			names.Push(lump->qwName);
+			spaces.Push(ns_graphics);
+			names.Push(qmiss);
+			spaces.Push(lump->Namespace);
+		}
+	}
+	if (names.Size() == 0)
+	{
+		return;
+	}
+
+	DWORD *first = new DWORD[NumLumps];
+	DWORD *next = new DWORD[NumLumps];
+	memset (first, 255, NumLumps*sizeof(first[0]));
+	for (i = 0; i < NumLumps; i++)
+	{
+		j = LumpNameHash (LumpInfo[i].lump->Name) % NumLumps;
+		next[i] = first[j];
+		first[j] = i;
+	}
+
+	TArray<int> chained;
+	cycle_t chaintime, tabletime;
+	char name[9];
+	int mismatches = 0;
+
+	chained.Resize(names.Size());
+	name[8] = 0;
+	chaintime.Reset();
+	chaintime.Clock();
+	for (i = 0; i < names.Size(); i++)
+	{
+		memcpy (name, &names[i], 8);
+		for (j = first[LumpNameHash (name) % NumLumps]; j != NULL_INDEX; j = next[j])
+		{
+			FResourceLump *lump = LumpInfo[j].lump;
+
+			if (lump->qwName == names[i])
+			{
+				if (lump->Namespace == spaces[i]) break;
+				if (spaces[i] > ns_specialzipdirectory && lump->Namespace == ns_global &&
+					!(lump->Flags & LUMPF_ZIPFILE)) break;
+			}
+		}
+		chained[i] = j != NULL_INDEX ? j : -1;
+	}
+	chaintime.Unclock();
+
+	tabletime.Reset();
+	tabletime.Clock();
+	for (i = 0; i < names.Size(); i++)
+	{
+		memcpy (name, &names[i], 8);
+		mismatches += CheckNumForName (name, spaces[i]) != chained[i];
+	}
+	tabletime.Unclock();
+
+	delete[] first;
+	delete[] next;
+
+	unsigned used = 0, probes = 0;
+	for (i = 0; i <= NameTableMask; i++)
+	{
+		if (NameTable[i].Lump != NULL_INDEX)
+		{
+			used++;
+			for (j = NameSlotHash (NameTable[i].Name) & NameTableMask; j != i; j = (j + 1) & NameTableMask)
+			{
+				probes++;
+			}
+		}
+	}
+
+	Printf ("%u lookups over %u lumps: %.3f ms hash chains, %.3f ms name table, %d mismatches\n",
+		names.Size(), NumLumps, chaintime.TimeMS(), tabletime.TimeMS(), mismatches);
+	Printf ("Name table: %u of %u slots used, %.2f extra probes per name\n",
+		used, NameTableMask + 1, used > 0 ? double(probes) / used : 0.);
+}
+
+CCMD (lumplookupbench)
+{
+	Wads.BenchmarkLookups();
+}
+
 
 // FWadLump -----------------------------------------------------------------
 
@@ -1351,9 +1640,9 @@ FWadLump::FWadLump(FResourceLump *lump, bool alwayscache)
 {
 	FileReader *f = lump->GetReader();
 
-	if (f != NULL && f->GetFile() != NULL && !alwayscache)
+	if (f != NULL && f->GetFile() != NULL && f->GetBuffer() == NULL && !alwayscache)
 	{
-		// Uncompressed lump in a file
+		// Uncompressed lump in a file that is not mapped
 		File = f->GetFile();
 		Length = lump->LumpSize;
 		StartPos = FilePos = lump->GetFileOffset();
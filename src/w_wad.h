@@ -174,6 +174,7 @@ public:
 
 	void SetLinkedTexture(int lump, FTexture *tex);
 	FTexture *GetLinkedTexture(int lump);
+	FResourceLump *GetResourceLump(int lump) const;
 
 
 	void ReadLump (int lump, void *dest);
@@ -206,6 +207,9 @@ public:
 
 	bool IsUncompressedFile(int lump) const;
 	bool IsEncryptedFile(int lump) const;
+	void PrintCacheStats() const;
+	void BenchmarkLookups();
+	void SaveDirectoryCaches();
 
 	int GetNumLumps () const;
 	int GetNumWads () const;
@@ -215,12 +219,13 @@ public:
 protected:
 
 	struct LumpRecord;
+	struct LumpNameSlot;
 
 	TArray<FResourceFile *> Files;
 	TArray<LumpRecord> LumpInfo;
 
-	DWORD *FirstLumpIndex;	// [RH] Hashing stuff moved out of lumpinfo structure
-	DWORD *NextLumpIndex;
+	LumpNameSlot *NameTable;	// Open-addressed table of the 8-character names
+	DWORD NameTableMask;
 
 	DWORD *FirstLumpIndex_FullName;	// The same information for fully qualified paths from .zips
 	DWORD *NextLumpIndex_FullName;
@@ -230,6 +235,7 @@ protected:
 
 	void SkinHack (int baselump);
 	void InitHashChains ();								// [RH] Set up the lumpinfo hashing
+	int ScanForName (QWORD qname, int space, int wadnum, bool exact);
 
 private:
 	void RenameSprites();
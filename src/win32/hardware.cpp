@@ -65,6 +65,8 @@ IVideo *Video;
 // do not include GL headers here, only declare the necessary functions.
 IVideo *gl_CreateVideo();
 FRenderer *gl_CreateInterface();
+IVideo *V_CreateNullVideo();
+FRenderer *G_CreateNullRenderer();
 
 void I_RestartRenderer();
 int currentrenderer = -1;
@@ -137,7 +139,8 @@ void I_InitGraphics ()
 	ticker.SetGenericRepDefault (val, CVAR_Bool);
 
 	//currentrenderer = vid_renderer;
-	if (currentrenderer==1) Video = gl_CreateVideo();
+	if (Args->CheckParm ("-benchmark")) Video = V_CreateNullVideo();
+	else if (currentrenderer==1) Video = gl_CreateVideo();
 	else Video = new Win32Video (0);
 
 	if (Video == NULL)
@@ -158,7 +161,8 @@ void I_CreateRenderer()
 	currentrenderer = vid_renderer;
 	if (Renderer == NULL)
 	{
-		if (currentrenderer==1) Renderer = gl_CreateInterface();
+		if (Args->CheckParm ("-benchmark")) Renderer = G_CreateNullRenderer();
+		else if (currentrenderer==1) Renderer = gl_CreateInterface();
 		else Renderer = new FSoftwareRenderer;
 		atterm(I_DeleteRenderer);
 	}
@@ -0,0 +1,240 @@
+/*
+** workerthreads.cpp
+** Locks, semaphores and threads for the engine's helper threads
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 The GZ3Doom developers
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+
+#include <limits.h>
+
+#include "workerthreads.h"
+#include "doomtype.h"
+#include "i_system.h"
+
+// CODE --------------------------------------------------------------------
+
+#ifdef _WIN32
+
+//==========================================================================
+//
+// FWorkerLock
+//
+//==========================================================================
+
+FWorkerLock::FWorkerLock()
+{
+	InitializeCriticalSection (&Section);
+}
+
+FWorkerLock::~FWorkerLock()
+{
+	DeleteCriticalSection (&Section);
+}
+
+void FWorkerLock::Enter()
+{
+	EnterCriticalSection (&Section);
+}
+
+void FWorkerLock::Leave()
+{
+	LeaveCriticalSection (&Section);
+}
+
+//==========================================================================
+//
+// FWorkerSemaphore
+//
+//==========================================================================
+
+FWorkerSemaphore::FWorkerSemaphore()
+{
+	Sem = CreateSemaphore (NULL, 0, INT_MAX, NULL);
+	if (Sem == NULL)
+	{
+		I_FatalError ("Failed to create a semaphore for the worker threads.");
+	}
+}
+
+FWorkerSemaphore::~FWorkerSemaphore()
+{
+	CloseHandle (Sem);
+}
+
+void FWorkerSemaphore::Post()
+{
+	ReleaseSemaphore (Sem, 1, NULL);
+}
+
+void FWorkerSemaphore::Wait()
+{
+	WaitForSingleObject (Sem, INFINITE);
+}
+
+//==========================================================================
+//
+// FWorkerThread
+//
+//==========================================================================
+
+FWorkerThread::FWorkerThread()
+: Func(NULL), Param(NULL), Running(false), Handle(NULL)
+{
+}
+
+DWORD WINAPI FWorkerThread::ThreadFunc (LPVOID param)
+{
+	FWorkerThread *self = (FWorkerThread *)param;
+	self->Func (self->Param);
+	return 0;
+}
+
+bool FWorkerThread::Start (void (*func)(void *), void *param)
+{
+	Func = func;
+	Param = param;
+	Handle = CreateThread (NULL, 0, ThreadFunc, this, 0, NULL);
+	Running = Handle != NULL;
+	return Running;
+}
+
+void FWorkerThread::Join ()
+{
+	if (Running)
+	{
+		WaitForSingleObject (Handle, INFINITE);
+		CloseHandle (Handle);
+		Handle = NULL;
+		Running = false;
+	}
+}
+
+#else
+
+//==========================================================================
+//
+// FWorkerLock
+//
+//==========================================================================
+
+FWorkerLock::FWorkerLock()
+{
+	pthread_mutex_init (&Mutex, NULL);
+}
+
+FWorkerLock::~FWorkerLock()
+{
+	pthread_mutex_destroy (&Mutex);
+}
+
+void FWorkerLock::Enter()
+{
+	pthread_mutex_lock (&Mutex);
+}
+
+void FWorkerLock::Leave()
+{
+	pthread_mutex_unlock (&Mutex);
+}
+
+//==========================================================================
+//
+// FWorkerSemaphore
+//
+//==========================================================================
+
+FWorkerSemaphore::FWorkerSemaphore()
+{
+	pthread_mutex_init (&Mutex, NULL);
+	pthread_cond_init (&Cond, NULL);
+	Value = 0;
+}
+
+FWorkerSemaphore::~FWorkerSemaphore()
+{
+	pthread_cond_destroy (&Cond);
+	pthread_mutex_destroy (&Mutex);
+}
+
+void FWorkerSemaphore::Post()
+{
+	pthread_mutex_lock (&Mutex);
+	Value++;
+	pthread_cond_signal (&Cond);
+	pthread_mutex_unlock (&Mutex);
+}
+
+void FWorkerSemaphore::Wait()
+{
+	pthread_mutex_lock (&Mutex);
+	while (Value == 0)
+	{
+		pthread_cond_wait (&Cond, &Mutex);
+	}
+	Value--;
+	pthread_mutex_unlock (&Mutex);
+}
+
+//==========================================================================
+//
+// FWorkerThread
+//
+//==========================================================================
+
+FWorkerThread::FWorkerThread()
+: Func(NULL), Param(NULL), Running(false)
+{
+}
+
+void *FWorkerThread::ThreadFunc (void *param)
+{
+	FWorkerThread *self = (FWorkerThread *)param;
+	self->Func (self->Param);
+	return NULL;
+}
+
+bool FWorkerThread::Start (void (*func)(void *), void *param)
+{
+	Func = func;
+	Param = param;
+	Running = pthread_create (&Handle, NULL, ThreadFunc, this) == 0;
+	return Running;
+}
+
+void FWorkerThread::Join ()
+{
+	if (Running)
+	{
+		pthread_join (Handle, NULL);
+		Running = false;
+	}
+}
+
+#endif
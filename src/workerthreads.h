@@ -0,0 +1,110 @@
+/*
+** workerthreads.h
+** Locks, semaphores and threads for the engine's helper threads
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 The GZ3Doom developers
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+
+#ifndef __WORKERTHREADS_H__
+#define __WORKERTHREADS_H__
+
+#ifdef _WIN32
+#ifndef _WINNT_
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#define USE_WINDOWS_DWORD
+#endif
+#else
+#include <pthread.h>
+#endif
+
+// Unlike FCriticalSection, these do not depend on the system layer, so
+// they can be used by code that is shared by all platforms.
+
+class FWorkerLock
+{
+public:
+	FWorkerLock();
+	~FWorkerLock();
+	void Enter();
+	void Leave();
+
+private:
+#ifdef _WIN32
+	CRITICAL_SECTION Section;
+#else
+	pthread_mutex_t Mutex;
+#endif
+};
+
+class FWorkerSemaphore
+{
+public:
+	FWorkerSemaphore();
+	~FWorkerSemaphore();
+	void Post();
+	void Wait();
+
+private:
+#ifdef _WIN32
+	HANDLE Sem;
+#else
+	pthread_mutex_t Mutex;
+	pthread_cond_t Cond;
+	int Value;
+#endif
+};
+
+class FWorkerThread
+{
+public:
+	FWorkerThread();
+
+	// Runs func(param) on a new thread. Returns false if it could not be
+	// started.
+	bool Start(void (*func)(void *), void *param);
+
+	// Waits for the thread to return, if it was started.
+	void Join();
+
+private:
+	void (*Func)(void *);
+	void *Param;
+	bool Running;
+#ifdef _WIN32
+	HANDLE Handle;
+	static DWORD WINAPI ThreadFunc(LPVOID param);
+#else
+	pthread_t Handle;
+	static void *ThreadFunc(void *param);
+#endif
+};
+
+#endif
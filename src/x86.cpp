@@ -38,13 +38,29 @@ void DumpCPUInfo(const CPUInfo *cpu)
 #else
 #define __cpuid(output, func) __asm__ __volatile__("cpuid" : "=a" ((output)[0]),\
 	"=b" ((output)[1]), "=c" ((output)[2]), "=d" ((output)[3]) : "a" (func));
+#define __cpuidex(output, func, subfunc) __asm__ __volatile__("cpuid" : "=a" ((output)[0]),\
+	"=b" ((output)[1]), "=c" ((output)[2]), "=d" ((output)[3]) : "a" (func), "c" (subfunc));
 #endif
 #endif
 
+#if defined(_M_X64) || defined(__amd64__)
+// Returns the low half of XCR0, which tells which registers the OS saves.
+static unsigned int GetXCR0()
+{
+#ifdef _MSC_VER
+	return (unsigned int)_xgetbv(0);
+#else
+	unsigned int eax, edx;
+	__asm__ __volatile__("xgetbv" : "=a" (eax), "=d" (edx) : "c" (0));
+	return eax;
+#endif
+}
+#endif
+
 void CheckCPUID(CPUInfo *cpu)
 {
 	int foo[4];
-	unsigned int maxext;
+	unsigned int maxbasic, maxext;
 
 	memset(cpu, 0, sizeof(*cpu));
 
@@ -96,6 +112,7 @@ haveid:
 
 	// Get vendor ID
 	__cpuid(foo, 0);
+	maxbasic = (unsigned int)foo[0];
 	cpu->dwVendorID[0] = foo[1];
 	cpu->dwVendorID[1] = foo[3];
 	cpu->dwVendorID[2] = foo[2];
@@ -132,6 +149,16 @@ haveid:
 		cpu->Model |= (foo[0] >> 12) & 0xF0;
 	}
 
+#if defined(_M_X64) || defined(__amd64__)
+	// AVX2 also needs the OS to save the YMM registers (OSXSAVE and AVX
+	// are set, and XCR0 has the SSE and AVX state bits).
+	if (maxbasic >= 7 && (foo[2] & (1 << 27)) && (foo[2] & (1 << 28)) && (GetXCR0() & 6) == 6)
+	{
+		__cpuidex(foo, 7, 0);
+		cpu->bAVX2 = (foo[1] >> 5) & 1;
+	}
+#endif
+
 	// Check for extended functions.
 	__cpuid(foo, 0x80000000);
 	maxext = (unsigned int)foo[0];
@@ -221,6 +248,7 @@ void DumpCPUInfo(const CPUInfo *cpu)
 		if (cpu->bSSSE3)		Printf(" SSSE3");
 		if (cpu->bSSE41)		Printf(" SSE4.1");
 		if (cpu->bSSE42)		Printf(" SSE4.2");
+		if (cpu->bAVX2)			Printf(" AVX2");
 		if (cpu->b3DNow)		Printf(" 3DNow!");
 		if (cpu->b3DNowPlus)	Printf(" 3DNow!+");
 		Printf ("\n");
@@ -3,7 +3,7 @@
 
 #include "basictypes.h"
 
-struct CPUInfo	// 92 bytes
+struct CPUInfo	// 96 bytes
 {
 	union
 	{
@@ -97,6 +97,8 @@ struct CPUInfo	// 92 bytes
 		};
 		uint32 AMD_DataL1Info;
 	};
+
+	BYTE bAVX2;		// Only checked on x86-64
 };
 
 